@@ -0,0 +1,159 @@
+/*
+    arena.c - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "config.h"
+#include "compat.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena_alloc.h"
+
+#ifdef DMALLOC
+#include <dmalloc.h>
+#endif
+
+/* Memory is taken from large chunks */
+#define ARENA_CHUNK_SIZE 0x10000
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+typedef struct psiconv_arena_chunk_s {
+  struct psiconv_arena_chunk_s *next;
+  size_t size; /* Number of usable bytes after the header */
+  size_t used;
+} *psiconv_arena_chunk;
+
+#define CHUNK_HEADER ARENA_ROUND(sizeof(struct psiconv_arena_chunk_s))
+#define CHUNK_DATA(chunk) ((char *) (chunk) + CHUNK_HEADER)
+
+struct psiconv_arena_s {
+  psiconv_arena_chunk chunks; /* The first one is the one we allocate from */
+};
+
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_THREADS__)
+static _Thread_local psiconv_arena current_arena = NULL;
+#elif defined(__GNUC__)
+static __thread psiconv_arena current_arena = NULL;
+#else
+static psiconv_arena current_arena = NULL;
+#endif
+
+psiconv_arena psiconv_arena_new(void)
+{
+  psiconv_arena arena;
+  if (!(arena = malloc(sizeof(*arena))))
+    return NULL;
+  arena->chunks = NULL;
+  return arena;
+}
+
+void psiconv_arena_free(psiconv_arena arena)
+{
+  psiconv_arena_chunk chunk,next;
+  if (!arena)
+    return;
+  for (chunk = arena->chunks; chunk; chunk = next) {
+    next = chunk->next;
+    free(chunk);
+  }
+  free(arena);
+}
+
+psiconv_arena psiconv_arena_enter(psiconv_arena arena)
+{
+  psiconv_arena old = current_arena;
+  current_arena = arena;
+  return old;
+}
+
+psiconv_arena psiconv_arena_current(void)
+{
+  return current_arena;
+}
+
+void *psiconv_arena_alloc(psiconv_arena arena, size_t size)
+{
+  psiconv_arena_chunk chunk;
+  size_t needed,chunk_size;
+  char *res;
+
+  needed = ARENA_ROUND(size);
+  if (needed < size)
+    return NULL;
+  chunk = arena->chunks;
+  if (!chunk || (chunk->size - chunk->used < needed)) {
+    /* Large allocations get a chunk of their own, behind the current one,
+       so the space left in the current one is not wasted */
+    chunk_size = needed > ARENA_CHUNK_SIZE / 4 ? needed : ARENA_CHUNK_SIZE;
+    if (!(chunk = malloc(CHUNK_HEADER + chunk_size)))
+      return NULL;
+    chunk->size = chunk_size;
+    chunk->used = 0;
+    if (arena->chunks && (chunk_size != ARENA_CHUNK_SIZE)) {
+      chunk->next = arena->chunks->next;
+      arena->chunks->next = chunk;
+    } else {
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    }
+  }
+  res = CHUNK_DATA(chunk) + chunk->used;
+  chunk->used += needed;
+  return res;
+}
+
+void *psiconv_arena_realloc(psiconv_arena arena, void *ptr,
+                            size_t old_size, size_t size)
+{
+  psiconv_arena_chunk chunk;
+  char *res;
+
+  if (!ptr)
+    return psiconv_arena_alloc(arena,size);
+  if (size <= old_size)
+    return ptr;
+  if (ARENA_ROUND(size) < size)
+    return NULL;
+  /* If this was the last allocation, we may be able to grow it in place */
+  chunk = arena->chunks;
+  if ((char *) ptr + ARENA_ROUND(old_size) == CHUNK_DATA(chunk) + chunk->used
+      && (chunk->size - chunk->used >= ARENA_ROUND(size) - ARENA_ROUND(old_size))) {
+    chunk->used += ARENA_ROUND(size) - ARENA_ROUND(old_size);
+    return ptr;
+  }
+  if (!(res = psiconv_arena_alloc(arena,size)))
+    return NULL;
+  memcpy(res,ptr,old_size);
+  return res;
+}
+
+void *psiconv_tree_malloc(size_t size)
+{
+  if (!current_arena)
+    return malloc(size);
+  return psiconv_arena_alloc(current_arena,size);
+}
+
+void psiconv_tree_free(void *ptr)
+{
+  if (!current_arena)
+    free(ptr);
+}
@@ -0,0 +1,58 @@
+/*
+    arena.h - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* A psiconv_arena is a pool of memory a whole parse tree can be allocated
+   from (see psiconv_parse_arena). Everything in it is released at once
+   when the arena is freed, which is much faster than freeing a large
+   tree piece by piece. Only the tree itself lives in the arena; the
+   temporary memory used while parsing is still freed as soon as it is
+   no longer needed.
+
+   A tree in an arena must be treated as read-only: do not add, remove or
+   replace anything in it (the psiconv_list functions that change a list,
+   for example), and never pass it or anything in it to psiconv_free_file
+   or any other psiconv_free_* function. Copy what you want to keep or
+   change before the arena is freed. */
+
+#ifndef PSICONV_ARENA_H
+#define PSICONV_ARENA_H
+
+#include <psiconv/general.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Always use psiconv_arena, never struct psiconv_arena_s */
+/* No need to export the actual internal format */
+typedef struct psiconv_arena_s *psiconv_arena;
+
+/* Allocate a new, empty arena. Returns NULL when not enough memory is
+   available. */
+extern psiconv_arena psiconv_arena_new(void);
+
+/* Free an arena and everything that was allocated from it. Never use
+   anything allocated from it afterwards. */
+extern void psiconv_arena_free(psiconv_arena arena);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* def PSICONV_ARENA_H */
@@ -0,0 +1,71 @@
+/*
+    arena_alloc.h - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* This file is used internally by the library sources that build the
+   data structures of data.h (the parse tree). Memory for those structures
+   is taken with psiconv_tree_malloc and psiconv_tree_list_new, which use
+   the arena the current thread parses into (see psiconv_parse_arena), if
+   there is one, and the heap otherwise. Everything else, like the
+   temporary buffers used while parsing, always uses the plain heap. */
+
+#ifndef PSICONV_ARENA_ALLOC_H
+#define PSICONV_ARENA_ALLOC_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Make arena the current arena of this thread, and return the previous
+   one. Pass NULL to go back to allocating the tree from the heap. */
+extern psiconv_arena psiconv_arena_enter(psiconv_arena arena);
+
+/* The current arena of this thread, or NULL if there is none */
+extern psiconv_arena psiconv_arena_current(void);
+
+/* Allocate size bytes from arena. Returns NULL when not enough memory is
+   available. */
+extern void *psiconv_arena_alloc(psiconv_arena arena, size_t size);
+
+/* Grow a block of old_size bytes allocated from arena to size bytes. The
+   block is extended in place if it was the last one allocated, and copied
+   otherwise. Returns NULL when not enough memory is available; the old
+   block is unchanged then. */
+extern void *psiconv_arena_realloc(psiconv_arena arena, void *ptr,
+                                   size_t old_size, size_t size);
+
+/* Allocate size bytes for a part of the parse tree */
+extern void *psiconv_tree_malloc(size_t size);
+
+/* Free a part of the parse tree allocated by psiconv_tree_malloc. This
+   does nothing while an arena is current: the arena releases it. */
+extern void psiconv_tree_free(void *ptr);
+
+/* Create a list that is part of the parse tree. It remembers which arena
+   it was allocated from, so it can grow and be freed safely later. */
+extern psiconv_list psiconv_tree_list_new(size_t element_size);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* def PSICONV_ARENA_ALLOC_H */
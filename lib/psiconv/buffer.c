@@ -22,6 +22,18 @@
 #include "compat.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef _POSIX_MAPPED_FILES
+#include <sys/mman.h>
+#endif
 
 #include "list.h"
 #include "error.h"
@@ -36,106 +48,346 @@ typedef struct psiconv_relocation_s {
   int id;
 } *psiconv_relocation;
 
+/* The actual bytes of a buffer. Several buffers can share the same
+   storage: a subbuffer is just a window on the storage of its parent.
+   The storage is released when the last buffer using it is freed. */
+typedef enum psiconv_buffer_storage_kind_e {
+  psiconv_buffer_storage_malloc, /* data is ours, and can grow */
+  psiconv_buffer_storage_mapped, /* data is an mmap'ed file */
+  psiconv_buffer_storage_borrowed /* data is owned by the caller */
+} psiconv_buffer_storage_kind_t;
+
+typedef struct psiconv_buffer_storage_s {
+  psiconv_u8 *data;
+  psiconv_u32 max_len; /* Number of bytes allocated or mapped */
+  int refcount;
+  psiconv_buffer_storage_kind_t kind;
+} *psiconv_buffer_storage;
+
 struct psiconv_buffer_s {
   psiconv_list reloc_target; /* of struct relocation_s */
   psiconv_list reloc_ref; /* of struct relocation_s */
-  psiconv_list data; /* of psiconv_u8 */
+  psiconv_buffer_storage storage;
+  psiconv_u32 start; /* Offset of our first byte within the storage */
+  psiconv_u32 len; /* Number of bytes in use */
+  psiconv_bool_t read_only; /* Set for subbuffers */
 };
 
+#define BUFFER_DATA(buf) ((buf)->storage->data + (buf)->start)
+
+static psiconv_buffer psiconv_buffer_new_aux(psiconv_buffer_storage storage);
+static void psiconv_buffer_storage_release(psiconv_buffer_storage storage);
+static int psiconv_buffer_resize(psiconv_buffer buf, psiconv_u32 nr);
+
+/* Buffers may be generated by several threads at once, so the counter
+   is updated atomically where the compiler lets us */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+static atomic_uint unique_id = 1;
+#define NEXT_UNIQUE_ID() atomic_fetch_add(&unique_id,1)
+#elif defined(__GNUC__)
+static psiconv_u32 unique_id = 1;
+#define NEXT_UNIQUE_ID() __sync_fetch_and_add(&unique_id,1)
+#else
 static psiconv_u32 unique_id = 1;
+#define NEXT_UNIQUE_ID() (unique_id ++)
+#endif
 
 psiconv_u32 psiconv_buffer_unique_id(void)
 {
-  return unique_id ++;
+  return NEXT_UNIQUE_ID();
 }
 
 psiconv_buffer psiconv_buffer_new(void)
+{
+  psiconv_buffer_storage storage;
+  psiconv_buffer buf;
+
+  if (!(storage = malloc(sizeof(*storage))))
+    return NULL;
+  storage->data = NULL;
+  storage->max_len = 0;
+  storage->refcount = 0;
+  storage->kind = psiconv_buffer_storage_malloc;
+  if (!(buf = psiconv_buffer_new_aux(storage)))
+    free(storage);
+  return buf;
+}
+
+psiconv_buffer psiconv_buffer_borrow(const psiconv_u8 *data, psiconv_u32 len)
+{
+  psiconv_buffer_storage storage;
+  psiconv_buffer buf;
+
+  if (!(storage = malloc(sizeof(*storage))))
+    return NULL;
+  /* Never written through: the buffer is read-only */
+  storage->data = (psiconv_u8 *) data;
+  storage->max_len = len;
+  storage->refcount = 0;
+  storage->kind = psiconv_buffer_storage_borrowed;
+  if (!(buf = psiconv_buffer_new_aux(storage))) {
+    free(storage);
+    return NULL;
+  }
+  buf->len = len;
+  buf->read_only = psiconv_bool_true;
+  return buf;
+}
+
+/* Create a buffer on top of storage. The reference count of the storage
+   is only incremented if this succeeds. */
+psiconv_buffer psiconv_buffer_new_aux(psiconv_buffer_storage storage)
 {
   psiconv_buffer buf;
   if (!(buf = malloc(sizeof(*buf))))
     goto ERROR1;
-  if (!(buf->data = psiconv_list_new(sizeof(psiconv_u8)))) 
-    goto ERROR2;
+  buf->storage = storage;
+  buf->start = 0;
+  buf->len = 0;
+  buf->read_only = psiconv_bool_false;
   if (!(buf->reloc_target = psiconv_list_new(
                                    sizeof(struct psiconv_relocation_s)))) 
-    goto ERROR3;
+    goto ERROR2;
   if (!(buf->reloc_ref = psiconv_list_new(
                                    sizeof(struct psiconv_relocation_s)))) 
-    goto ERROR4;
+    goto ERROR3;
+  storage->refcount ++;
   return buf;
-ERROR4:
-  psiconv_list_free(buf->reloc_target);
 ERROR3:
-  psiconv_list_free(buf->data);
+  psiconv_list_free(buf->reloc_target);
 ERROR2:
   free(buf);
 ERROR1:
   return NULL;
 }
 
+void psiconv_buffer_storage_release(psiconv_buffer_storage storage)
+{
+  if (--storage->refcount)
+    return;
+  switch(storage->kind) {
+    case psiconv_buffer_storage_malloc:
+      free(storage->data);
+      break;
+#ifdef _POSIX_MAPPED_FILES
+    case psiconv_buffer_storage_mapped:
+      munmap(storage->data,storage->max_len);
+      break;
+#endif
+    default:
+      break;
+  }
+  free(storage);
+}
+
 void psiconv_buffer_free(psiconv_buffer buf)
 {
   psiconv_list_free(buf->reloc_ref);
   psiconv_list_free(buf->reloc_target);
-  psiconv_list_free(buf->data);
+  psiconv_buffer_storage_release(buf->storage);
   free(buf);
 }
 
+/* Make sure at least nr bytes are allocated. The allocation is doubled
+   each time, so appending byte by byte stays cheap. Subbuffers can not
+   be resized. */
+int psiconv_buffer_resize(psiconv_buffer buf, psiconv_u32 nr)
+{
+  psiconv_buffer_storage storage = buf->storage;
+  psiconv_u32 new_len;
+  psiconv_u8 *temp;
+
+  if (buf->read_only)
+    return -PSICONV_E_OTHER;
+  if (nr <= storage->max_len)
+    return -PSICONV_E_OK;
+  new_len = storage->max_len < 256?256:storage->max_len;
+  while (new_len < nr) {
+    if (new_len > 0x7fffffff) {
+      new_len = nr;
+      break;
+    }
+    new_len *= 2;
+  }
+  if (!(temp = realloc(storage->data,new_len)))
+    return -PSICONV_E_NOMEM;
+  storage->data = temp;
+  storage->max_len = new_len;
+  return -PSICONV_E_OK;
+}
+
 psiconv_u32 psiconv_buffer_length(const psiconv_buffer buf)
 {
-  return psiconv_list_length(buf->data);
+  return buf->len;
+}
+
+const psiconv_u8 *psiconv_buffer_span(const psiconv_buffer buf,
+                                      psiconv_u32 off, psiconv_u32 len)
+{
+  if ((off > buf->len) || (len > buf->len - off))
+    return NULL;
+  return BUFFER_DATA(buf) + off;
+}
+
+psiconv_u8 *psiconv_buffer_writable_span(psiconv_buffer buf,
+                                        psiconv_u32 off, psiconv_u32 len)
+{
+  if (buf->read_only || (buf->storage->kind != psiconv_buffer_storage_malloc)
+      || (buf->storage->refcount != 1))
+    return NULL;
+  if ((off > buf->len) || (len > buf->len - off))
+    return NULL;
+  return BUFFER_DATA(buf) + off;
 }
 
 psiconv_u8 *psiconv_buffer_get(const psiconv_buffer buf, psiconv_u32 off)
 {
-  return psiconv_list_get(buf->data,off);
+  if (off >= buf->len)
+    return NULL;
+  return BUFFER_DATA(buf) + off;
 }
 
 int psiconv_buffer_add(psiconv_buffer buf,psiconv_u8 data)
 {
-  return psiconv_list_add(buf->data,&data);
+  int res;
+  if ((res = psiconv_buffer_resize(buf,buf->len + 1)))
+    return res;
+  BUFFER_DATA(buf)[buf->len++] = data;
+  return -PSICONV_E_OK;
+}
+
+int psiconv_buffer_add_n(psiconv_buffer buf,const psiconv_u8 *data,
+                         psiconv_u32 len)
+{
+  int res;
+  if (len > 0xffffffff - buf->len)
+    return -PSICONV_E_NOMEM;
+  if ((res = psiconv_buffer_resize(buf,buf->len + len)))
+    return res;
+  if (len)
+    memcpy(BUFFER_DATA(buf) + buf->len,data,len);
+  buf->len += len;
+  return -PSICONV_E_OK;
 }
 
 size_t psiconv_buffer_fread(psiconv_buffer buf, size_t size, FILE *f)
 {
-  return psiconv_list_fread(buf->data,size,f);
+  size_t res;
+  if (psiconv_buffer_resize(buf,buf->len + size))
+    return 0;
+  res = fread(BUFFER_DATA(buf) + buf->len,1,size,f);
+  buf->len += res;
+  return res;
 }
 
 int psiconv_buffer_fread_all(psiconv_buffer buf, FILE *f)
 {
-  return psiconv_list_fread_all(buf->data,f);
+  while (!feof(f)) {
+    if (!psiconv_buffer_fread(buf,4096,f) && !feof(f)) 
+      return -PSICONV_E_NOMEM;
+  }
+  return -PSICONV_E_OK;
 }
 
-int psiconv_buffer_fwrite_all(const psiconv_buffer buf, FILE *f)
+#ifdef _POSIX_MAPPED_FILES
+/* Map the open file fd of size bytes into a new read-only buffer.
+   Returns NULL if this is not possible for any reason. */
+static psiconv_buffer psiconv_buffer_map_fd(int fd, psiconv_u32 size)
 {
-  return psiconv_list_fwrite_all(buf->data,f);
+  psiconv_buffer_storage storage;
+  psiconv_buffer buf;
+  void *data;
+
+  if ((data = mmap(NULL,size,PROT_READ,MAP_PRIVATE,fd,0)) == MAP_FAILED)
+    goto ERROR1;
+#ifdef MADV_SEQUENTIAL
+  madvise(data,size,MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+  madvise(data,size,MADV_WILLNEED);
+#endif
+  if (!(storage = malloc(sizeof(*storage))))
+    goto ERROR2;
+  storage->data = data;
+  storage->max_len = size;
+  storage->refcount = 0;
+  storage->kind = psiconv_buffer_storage_mapped;
+  if (!(buf = psiconv_buffer_new_aux(storage)))
+    goto ERROR3;
+  buf->len = size;
+  buf->read_only = psiconv_bool_true;
+  return buf;
+
+ERROR3:
+  free(storage);
+ERROR2:
+  munmap(data,size);
+ERROR1:
+  return NULL;
 }
+#endif /* _POSIX_MAPPED_FILES */
 
-int psiconv_buffer_subbuffer(psiconv_buffer *buf, const psiconv_buffer org,
-                             psiconv_u32 offset, psiconv_u32 length)
+psiconv_buffer psiconv_buffer_map_file(const char *path)
 {
-  int i;
-  int res;
-  psiconv_u8 *data;
-  if (! (*buf = psiconv_buffer_new())) {
-    res = PSICONV_E_NOMEM;
-    goto ERROR1;
+  psiconv_buffer buf;
+  struct stat st;
+  FILE *f;
+  int fd;
+
+  if ((fd = open(path,O_RDONLY)) < 0)
+    return NULL;
+  if (fstat(fd,&st) < 0) {
+    close(fd);
+    return NULL;
   }
-  for (i = 0; i < length; i++) {
-    if (!(data = psiconv_buffer_get(org,offset+i))) {
-      res = PSICONV_E_OTHER;
-      goto ERROR2;
-    }
-    if ((res = psiconv_buffer_add(*buf,*data))) {
-      goto ERROR2;
+#ifdef _POSIX_MAPPED_FILES
+  if (S_ISREG(st.st_mode) && (st.st_size > 0) &&
+      (st.st_size <= 0xffffffffUL)) {
+    buf = psiconv_buffer_map_fd(fd,st.st_size);
+    if (buf) {
+      close(fd);
+      return buf;
     }
   }
-  return 0;
+#endif
+  /* Not a regular file (or mapping failed): read it the normal way */
+  if (!(f = fdopen(fd,"r"))) {
+    close(fd);
+    return NULL;
+  }
+  if ((buf = psiconv_buffer_new()) && psiconv_buffer_fread_all(buf,f)) {
+    psiconv_buffer_free(buf);
+    buf = NULL;
+  }
+  fclose(f);
+  return buf;
+}
 
-ERROR2:
-	psiconv_buffer_free(*buf);
-ERROR1:
-	return res;
+int psiconv_buffer_fwrite_all(const psiconv_buffer buf, FILE *f)
+{
+  psiconv_u32 pos = 0;
+  psiconv_u32 written;
+  while (pos < buf->len) {
+    if (!(written = fwrite(BUFFER_DATA(buf) + pos,1,buf->len - pos,f)))
+      return -PSICONV_E_OTHER;
+    pos += written;
+  }
+  return -PSICONV_E_OK;
+}
+
+int psiconv_buffer_subbuffer(psiconv_buffer *buf, const psiconv_buffer org,
+                             psiconv_u32 offset, psiconv_u32 length)
+{
+  if (!psiconv_buffer_span(org,offset,length))
+    return PSICONV_E_OTHER;
+  if (! (*buf = psiconv_buffer_new_aux(org->storage)))
+    return PSICONV_E_NOMEM;
+  (*buf)->start = org->start + offset;
+  (*buf)->len = length;
+  (*buf)->read_only = psiconv_bool_true;
+  return 0;
 }
 
 int psiconv_buffer_concat(psiconv_buffer buf, const psiconv_buffer extra)
@@ -144,74 +396,109 @@ int psiconv_buffer_concat(psiconv_buffer buf, const psiconv_buffer extra)
   psiconv_u32 i;
   psiconv_relocation reloc;
 
-
+  if ((res = psiconv_buffer_resize(buf,buf->len + extra->len)))
+    return res;
   for (i = 0; i < psiconv_list_length(extra->reloc_target); i++) {
     if (!(reloc = psiconv_list_get(extra->reloc_target,i))) 
       return -PSICONV_E_OTHER;
-    reloc->offset += psiconv_list_length(buf->data);
+    reloc->offset += buf->len;
     if ((res=psiconv_list_add(buf->reloc_target,reloc)))
       return res;
   }
   for (i = 0; i < psiconv_list_length(extra->reloc_ref); i++) {
     if (!(reloc = psiconv_list_get(extra->reloc_ref,i))) 
       return -PSICONV_E_OTHER;
-    reloc->offset += psiconv_list_length(buf->data);
+    reloc->offset += buf->len;
     if ((res = psiconv_list_add(buf->reloc_ref,reloc)))
       return res;
   }
-  return psiconv_list_concat(buf->data,extra->data);
+  if (extra->len)
+    memcpy(BUFFER_DATA(buf) + buf->len,BUFFER_DATA(extra),extra->len);
+  buf->len += extra->len;
+  return -PSICONV_E_OK;
+}
+
+/* Order relocations by id; equal ids (which should not happen) by offset,
+   so the target with the lowest offset wins */
+static int psiconv_relocation_compare(const void *a, const void *b)
+{
+  const struct psiconv_relocation_s *ra = a, *rb = b;
+  if (ra->id != rb->id)
+    return ra->id < rb->id ? -1 : 1;
+  if (ra->offset != rb->offset)
+    return ra->offset < rb->offset ? -1 : 1;
+  return 0;
 }
 
 int psiconv_buffer_resolve(psiconv_buffer buf)
 {
-  int res;
-  psiconv_u32 i,j,temp;
-  psiconv_relocation target,ref;
+  psiconv_u32 lo,mid,hi,nr_targets;
+  psiconv_relocation targets,target,ref;
+  psiconv_u8 *dest;
+  int res = -PSICONV_E_OK;
 
-  for (i = 0; i < psiconv_list_length(buf->reloc_ref);i++) {
-    if (!(ref = psiconv_list_get(buf->reloc_ref,i))) 
-      return -PSICONV_E_OTHER;
-    for (j = 0;  j < psiconv_list_length(buf->reloc_target);j++) {
-      if (!(target = psiconv_list_get(buf->reloc_target,j))) 
-        return -PSICONV_E_OTHER;
-      if (ref->id == target->id) {
-        temp = target->offset & 0xff;
-        if ((res = psiconv_list_replace(buf->data,ref->offset,&temp)))
-          return -PSICONV_E_OTHER;
-        temp = (target->offset >> 8) & 0xff;
-        if ((res = psiconv_list_replace(buf->data,ref->offset + 1,&temp)))
-          return -PSICONV_E_OTHER;
-        temp = (target->offset >> 16) & 0xff;
-        if ((res = psiconv_list_replace(buf->data,ref->offset + 2,&temp)))
-          return -PSICONV_E_OTHER;
-        temp = (target->offset >> 24) & 0xff;
-        if ((res = psiconv_list_replace(buf->data,ref->offset + 3,&temp)))
-          return -PSICONV_E_OTHER;
-        break;
-      }
+  nr_targets = psiconv_list_length(buf->reloc_target);
+  if (!psiconv_list_length(buf->reloc_ref))
+    goto DONE;
+  if (!nr_targets)
+    return -PSICONV_E_OTHER;
+
+  /* Sort a copy of the targets once, so each reference is found by a
+     binary search instead of by walking all targets */
+  if (!(targets = malloc(nr_targets * sizeof(*targets))))
+    return -PSICONV_E_NOMEM;
+  memcpy(targets,psiconv_list_data(buf->reloc_target),
+         nr_targets * sizeof(*targets));
+  qsort(targets,nr_targets,sizeof(*targets),psiconv_relocation_compare);
+
+  PSICONV_LIST_FOREACH(struct psiconv_relocation_s,ref,buf->reloc_ref) {
+    /* Find the first target with this id */
+    lo = 0;
+    hi = nr_targets;
+    while (lo < hi) {
+      mid = lo + (hi - lo) / 2;
+      if (targets[mid].id < ref->id)
+        lo = mid + 1;
+      else
+        hi = mid;
     }
-    if (j == psiconv_list_length(buf->reloc_target)) 
-      return -PSICONV_E_OTHER;
+    target = targets + lo;
+    if ((target == targets + nr_targets) || (target->id != ref->id) ||
+        !(dest = psiconv_buffer_writable_span(buf,ref->offset,4))) {
+      res = -PSICONV_E_OTHER;
+      goto ERROR1;
+    }
+    dest[0] = target->offset & 0xff;
+    dest[1] = (target->offset >> 8) & 0xff;
+    dest[2] = (target->offset >> 16) & 0xff;
+    dest[3] = (target->offset >> 24) & 0xff;
   }
+  free(targets);
+DONE:
   psiconv_list_empty(buf->reloc_target);
   psiconv_list_empty(buf->reloc_ref);
-  return -PSICONV_E_OK;
+  return res;
+
+ERROR1:
+  free(targets);
+  return res;
 }
 
 int psiconv_buffer_add_reference(psiconv_buffer buf,int id)
 {
   struct psiconv_relocation_s reloc;
-  int res,i;
-  psiconv_u8 data;
+  int res;
 
-  reloc.offset = psiconv_list_length(buf->data);
+  if (buf->read_only)
+    return -PSICONV_E_OTHER;
+  reloc.offset = buf->len;
   reloc.id = id;
   if ((res = psiconv_list_add(buf->reloc_ref,&reloc)))
     return res;
-  data = 0x00;
-  for (i = 0; i < 4; i++) 
-    if ((res = psiconv_list_add(buf->data,&data)))
-      return res;
+  if ((res = psiconv_buffer_resize(buf,buf->len + 4)))
+    return res;
+  memset(BUFFER_DATA(buf) + buf->len,0,4);
+  buf->len += 4;
   return -PSICONV_E_OK;
 }
 
@@ -219,7 +506,9 @@ int psiconv_buffer_add_target(psiconv_buffer buf, int id)
 {
   struct psiconv_relocation_s reloc;
 
-  reloc.offset = psiconv_list_length(buf->data);
+  if (buf->read_only)
+    return -PSICONV_E_OTHER;
+  reloc.offset = buf->len;
   reloc.id = id;
   return psiconv_list_add(buf->reloc_target,&reloc);
 }
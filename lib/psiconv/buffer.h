@@ -21,8 +21,8 @@
 #define PSICONV_BUFFER_H
 
 /* A psiconv_buffer is a buffer of raw byte data. It is used when parsing
-   or generating a Psion file. You can use references within it that
-   are resolved at a later time. */
+   or generating a Psion file. The bytes are kept in one contiguous block.
+   You can use references within it that are resolved at a later time. */
 
 #include <psiconv/general.h>
 
@@ -39,6 +39,14 @@ typedef struct psiconv_buffer_s *psiconv_buffer;
    All other functions assume you have called this function first! */
 extern psiconv_buffer psiconv_buffer_new(void);
 
+/* Allocate a new read-only buffer on top of len bytes of caller-owned
+   memory at data. Nothing is copied; the memory must stay valid and
+   unchanged until the buffer (and any subbuffers of it) are freed, but
+   is never freed by psiconv itself. Returns NULL when not enough memory
+   is available. */
+extern psiconv_buffer psiconv_buffer_borrow(const psiconv_u8 *data,
+                                            psiconv_u32 len);
+
 /* Free a buffer and reclaim its memory. Never use a buffer again after
    calling this (unless you do a psiconv_buffer_new on it first) */
 extern void psiconv_buffer_free(psiconv_buffer buf);
@@ -49,14 +57,33 @@ extern psiconv_u32 psiconv_buffer_length(const psiconv_buffer buf);
 /* Get one byte of data. Returns NULL if you are trying to read past
    the end of the buffer. Do not use this; instead use psiconv_read_u8
    and friends */
-extern psiconv_u8 *psiconv_buffer_get(const psiconv_buffer buf, 
+extern psiconv_u8 *psiconv_buffer_get(const psiconv_buffer buf,
                                       psiconv_u32 off);
 
+/* Get len contiguous bytes of data, starting at off. Returns NULL if
+   any of them lies past the end of the buffer. The pointer is only valid
+   until the buffer is changed or freed. */
+extern const psiconv_u8 *psiconv_buffer_span(const psiconv_buffer buf,
+                                             psiconv_u32 off,
+                                             psiconv_u32 len);
+
+/* Like psiconv_buffer_span, but the bytes may be changed. Returns NULL
+   as well if the buffer is read-only, or if its bytes are shared with
+   another buffer or owned by someone else. */
+extern psiconv_u8 *psiconv_buffer_writable_span(psiconv_buffer buf,
+                                                psiconv_u32 off,
+                                                psiconv_u32 len);
+
 /* Add one byte of data to the end. Returns 0 on success, and an error
    code on failure. Do not use this; instead use psiconv_write_u8 and
    friends */
 extern int psiconv_buffer_add(psiconv_buffer buf,psiconv_u8 data);
 
+/* Add len bytes of data to the end. Returns 0 on success, and an error
+   code on failure. */
+extern int psiconv_buffer_add_n(psiconv_buffer buf,const psiconv_u8 *data,
+                                psiconv_u32 len);
+
 /* Do an fread to the buffer. Returns the number of read bytes. See
    fread(3) for more information. */
 extern size_t psiconv_buffer_fread(psiconv_buffer buf,size_t size, FILE *f);
@@ -65,6 +92,13 @@ extern size_t psiconv_buffer_fread(psiconv_buffer buf,size_t size, FILE *f);
    error code on failure. */
 extern int psiconv_buffer_fread_all(psiconv_buffer buf, FILE *f);
 
+/* Allocate a new buffer holding the complete contents of the file path.
+   Regular files are mapped into memory instead of copied, where the
+   system supports it; the resulting buffer is read-only and the file
+   should not be truncated while it is in use. Other files, like pipes,
+   are simply read. Returns NULL on failure, with errno set. */
+extern psiconv_buffer psiconv_buffer_map_file(const char *path);
+
 /* Write a complete buffer to file. Returns 0 on success, and an
    error code on failure. */
 extern int psiconv_buffer_fwrite_all(const psiconv_buffer buf, FILE *f);
@@ -90,11 +124,15 @@ extern int psiconv_buffer_add_reference(psiconv_buffer buf,int id);
 /* Resolve all references and empty the reference list. */
 extern int psiconv_buffer_resolve(psiconv_buffer buf);
 
-/* Get a unique reference id */
+/* Get a unique reference id. This may be called from several threads at
+   once. */
 extern psiconv_u32 psiconv_buffer_unique_id(void);
 
-/* Extract part of a buffer and put it into a new buffer. Note that 
-   references and targets are not copied; you will have to resolve them 
+/* Extract part of a buffer and put it into a new buffer. The data is not
+   copied: the new buffer is a read-only view that shares the storage of
+   the original, which stays valid until both are freed. You can not add
+   data, references or targets to it. Note that references and targets
+   of the original are not copied; you will have to resolve them
    beforehand (but as this function is meant for reading buffers, they
    will usually not be used). */
 extern int psiconv_buffer_subbuffer(psiconv_buffer *buf, 
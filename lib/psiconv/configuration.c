@@ -41,7 +41,8 @@
 #define CONFIGURATION_SEARCH_PATH PSICONVETCDIR "/psiconv.conf:~/.psiconv.conf"
 #endif
 static struct psiconv_config_s default_config = 
-    { PSICONV_VERB_WARN, 2, 0,0,0,psiconv_bool_false,NULL,'?','?',{ 0 },psiconv_bool_false };
+    { PSICONV_VERB_WARN, 2, 0,0,0,psiconv_bool_false,NULL,'?','?',{ 0 },psiconv_bool_false,
+      NULL, { 5, 5 }, NULL, psiconv_bool_false, psiconv_bool_false };
 
 static void psiconv_config_parse_statement(const char *filename,
                                     int linenr,
@@ -65,6 +66,7 @@ psiconv_config psiconv_config_default(void)
 
 void psiconv_config_free(psiconv_config config)
 {
+  psiconv_unicode_free_inverse(config);
   free(config);
 }
 
@@ -132,6 +134,30 @@ void psiconv_config_parse_statement(const char *filename,
       psiconv_error(*config,0,0,"Configuration file %s, line %d: "
 	            "UnknownEPOCChar should be between 1 and 255",
 		    filename,linenr);
+  } else if (!(strcasecmp(var,"pixelwarnings"))) {
+    if (value >= 0)
+      (*config)->repeat_limit[PSICONV_REPEAT_PIXEL] = value;
+    else
+      psiconv_error(*config,0,0,"Configuration file %s, line %d: "
+	            "PixelWarnings should be 0 or more",filename,linenr);
+  } else if (!(strcasecmp(var,"cellwarnings"))) {
+    if (value >= 0)
+      (*config)->repeat_limit[PSICONV_REPEAT_CELL] = value;
+    else
+      psiconv_error(*config,0,0,"Configuration file %s, line %d: "
+	            "CellWarnings should be 0 or more",filename,linenr);
+  } else if (!(strcasecmp(var,"packedpixels"))) {
+    if ((value == 0) || (value == 1))
+      (*config)->packed_pixels = value;
+    else
+      psiconv_error(*config,0,0,"Configuration file %s, line %d: "
+	            "PackedPixels should be 0 or 1",filename,linenr);
+  } else if (!(strcasecmp(var,"dither"))) {
+    if ((value == 0) || (value == 1))
+      (*config)->dither = value;
+    else
+      psiconv_error(*config,0,0,"Configuration file %s, line %d: "
+	            "Dither should be 0 or 1",filename,linenr);
   } else if (sscanf(var,"char%d",&charnr) == strlen(var)) {
     if ((charnr < 0) || (charnr > 255))
       psiconv_error(*config,0,0,"Configuration file %s, line %d: "
@@ -361,4 +387,6 @@ void psiconv_config_read(const char *extra_config_files,
     free(filename);
   }
   free(path);
+  /* Char statements may have changed the character set */
+  psiconv_unicode_build_inverse(*config);
 }
@@ -30,6 +30,18 @@ extern "C" {
 typedef void psiconv_error_handler_t (int kind, psiconv_u32 off,
                                       const char *message);
 
+/* Classes of warnings that can be given once for every pixel or cell;
+   see psiconv_warn_repeated in error.h */
+#define PSICONV_REPEAT_PIXEL 0
+#define PSICONV_REPEAT_CELL 1
+#define PSICONV_REPEAT_CLASSES 2
+
+/* The library only reads the configuration while parsing or generating
+   files, so one configuration may be used by several threads at once, as
+   long as nobody changes it (or calls psiconv_config_read or
+   psiconv_unicode_select_characterset on it) in the meantime. The trace
+   ring is the exception: a configuration with a trace ring may only be
+   used by one thread at a time. */
 typedef struct psiconv_config_s
 {
   int verbosity;
@@ -43,6 +55,16 @@ typedef struct psiconv_config_s
   psiconv_ucs2 unknown_unicode_char;
   psiconv_ucs2 unicode_table[0x100];
   psiconv_bool_t unicode;
+  struct psiconv_trace_s *trace; /* If set, progress and debug messages are
+                                    recorded here instead; see error.h */
+  psiconv_u32 repeat_limit[PSICONV_REPEAT_CLASSES]; /* How many repeated
+                                    warnings of each class are reported */
+  struct psiconv_unicode_inverse_s *unicode_inverse; /* unicode_table
+                                    the other way around; see unicode.h */
+  psiconv_bool_t packed_pixels; /* Parse pictures into three bytes per
+                                   pixel instead of floats; see data.h */
+  psiconv_bool_t dither; /* Dither pictures when generating them with a
+                            palet */
 } *psiconv_config;
 
 extern psiconv_config psiconv_config_default(void);
@@ -30,6 +30,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 static psiconv_color clone_color(psiconv_color color);
 static psiconv_font clone_font(psiconv_font font);
 static psiconv_border clone_border(psiconv_border border);
@@ -150,7 +152,8 @@ psiconv_paragraph_layout psiconv_basic_paragraph_layout(void)
     &black,                /* color               */
     &font,                 /* font                */
   };
-  static struct psiconv_all_tabs_s tabs = 
+  /* Not static: its extras list is filled in below */
+  struct psiconv_all_tabs_s tabs = 
   {
     0.64,                  /* normal              */
     NULL                   /* kind                */
@@ -182,7 +185,7 @@ psiconv_paragraph_layout psiconv_basic_paragraph_layout(void)
   };
   psiconv_paragraph_layout res;
   
-  if (!(pl.tabs->extras = psiconv_list_new(sizeof(struct psiconv_tab_s))))
+  if (!(pl.tabs->extras = psiconv_tree_list_new(sizeof(struct psiconv_tab_s))))
     return NULL;
   res = psiconv_clone_paragraph_layout(&pl);
   psiconv_list_free(pl.tabs->extras);
@@ -192,7 +195,7 @@ psiconv_paragraph_layout psiconv_basic_paragraph_layout(void)
 psiconv_color clone_color(psiconv_color color)
 {
   psiconv_color result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     return NULL;
   *result = *color;
   return result;
@@ -201,14 +204,14 @@ psiconv_color clone_color(psiconv_color color)
 psiconv_font clone_font(psiconv_font font)
 {
   psiconv_font result;
-  if(!(result = malloc(sizeof(*result))))
+  if(!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   *result = *font;
   if (!(result->name = psiconv_unicode_strdup(result->name)))
     goto ERROR2;
   return result;
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -216,14 +219,14 @@ ERROR1:
 psiconv_border clone_border(psiconv_border border)
 {
   psiconv_border result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   *result = *border;
   if(!(result->color = clone_color(result->color)))
     goto ERROR2;
   return result;
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -231,7 +234,7 @@ ERROR1:
 psiconv_bullet clone_bullet(psiconv_bullet bullet)
 {
   psiconv_bullet result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   *result = *bullet;
   if (!(result->font = clone_font(result->font)))
@@ -242,7 +245,7 @@ psiconv_bullet clone_bullet(psiconv_bullet bullet)
 ERROR3:
   psiconv_free_font(result->font);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -250,14 +253,19 @@ ERROR1:
 psiconv_all_tabs clone_all_tabs(psiconv_all_tabs all_tabs)
 {
   psiconv_all_tabs result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   *result = *all_tabs;
-  if (!(result->extras = psiconv_list_clone(result->extras)))
+  if (!(result->extras = psiconv_tree_list_new(sizeof(struct psiconv_tab_s))))
     goto ERROR2;
+  if (psiconv_list_add_n(result->extras,psiconv_list_data(all_tabs->extras),
+                         psiconv_list_length(all_tabs->extras)))
+    goto ERROR3;
   return result;
+ERROR3:
+  psiconv_list_free(result->extras);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -267,7 +275,7 @@ psiconv_character_layout psiconv_clone_character_layout
 {
   psiconv_character_layout result;
 
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   *result = *ls;
   if (!(result->color = clone_color(result->color)))
@@ -282,7 +290,7 @@ ERROR4:
 ERROR3:
   psiconv_free_color(result->color);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -292,7 +300,7 @@ psiconv_paragraph_layout psiconv_clone_paragraph_layout
 {
   psiconv_paragraph_layout result;
 
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   *result = *ls;
   if (!(result->back_color = clone_color(result->back_color)))
@@ -323,7 +331,7 @@ ERROR4:
 ERROR3:
   psiconv_free_color(result->back_color);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -342,7 +350,6 @@ int psiconv_find_style(const psiconv_word_styles_section ss,
 {
   const psiconv_ucs2 value_normal[] = { 'N','o','r','m','a','l',0 };
   psiconv_word_style style;
-  int i;
 
   if (!nr)
     return PSICONV_E_OTHER;
@@ -350,14 +357,11 @@ int psiconv_find_style(const psiconv_word_styles_section ss,
     *nr = 0;
     return 0;
   }
-  for (i = 0; i < psiconv_list_length(ss->styles);i++) {
-    if (!(style = psiconv_list_get(ss->styles,i)))
-      return PSICONV_E_NOMEM;
+  PSICONV_LIST_FOREACH(struct psiconv_word_style_s,style,ss->styles)
     if (!psiconv_unicode_strcmp(style->name,name)) {
-      *nr = 0xff - i;
+      *nr = 0xff - (style - (psiconv_word_style) psiconv_list_data(ss->styles));
       return 0;
     }
-  }
   *nr = 0;
   return PSICONV_E_OTHER;
 }
@@ -375,18 +379,13 @@ psiconv_sheet_cell_layout psiconv_get_default_layout
                                         psiconv_sheet_cell_layout cell_default,
                                         int row,int col)
 {
-  int i;
   psiconv_sheet_line line;
-  for (i = 0;i < psiconv_list_length(row_defaults);i++) {
-    line = psiconv_list_get(row_defaults,i);
+  PSICONV_LIST_FOREACH(struct psiconv_sheet_line_s,line,row_defaults)
     if (line->position == row)
       return line->layout;
-  }
-  for (i = 0;i < psiconv_list_length(col_defaults);i++) {
-    line = psiconv_list_get(col_defaults,i);
+  PSICONV_LIST_FOREACH(struct psiconv_sheet_line_s,line,col_defaults)
     if (line->position == col)
       return line->layout;
-  }
   return cell_default;
 }
 
@@ -394,14 +393,14 @@ psiconv_sheet_cell_layout psiconv_get_default_layout
 void psiconv_free_color (psiconv_color color)
 {
   if (color)
-    free(color);
+    psiconv_tree_free(color);
 }
 
 void psiconv_free_border(psiconv_border border)
 {
   if (border) {
     psiconv_free_color(border->color);
-    free(border);
+    psiconv_tree_free(border);
   }
 }
 
@@ -409,8 +408,8 @@ void psiconv_free_font(psiconv_font font)
 {
   if (font) {
     if (font->name) 
-      free(font->name);
-    free(font);
+      psiconv_tree_free(font->name);
+    psiconv_tree_free(font);
   }
 }
 
@@ -419,7 +418,7 @@ void psiconv_free_bullet(psiconv_bullet bullet)
   if (bullet) {
     psiconv_free_color(bullet->color);
     psiconv_free_font(bullet->font);
-    free(bullet);
+    psiconv_tree_free(bullet);
   }
 }
 
@@ -429,21 +428,21 @@ void psiconv_free_character_layout(psiconv_character_layout layout)
     psiconv_free_color(layout->color);
     psiconv_free_color(layout->back_color);
     psiconv_free_font(layout->font);
-    free(layout);
+    psiconv_tree_free(layout);
   }
 }
 
 void psiconv_free_tab(psiconv_tab tab)
 {
   if (tab)
-    free(tab);
+    psiconv_tree_free(tab);
 }
 
 void psiconv_free_tabs(psiconv_all_tabs tabs)
 {
   if (tabs) {
     psiconv_list_free(tabs->extras);
-    free(tabs);
+    psiconv_tree_free(tabs);
   }
 }
 
@@ -457,14 +456,14 @@ void psiconv_free_paragraph_layout(psiconv_paragraph_layout layout)
     psiconv_free_border(layout->top_border);
     psiconv_free_border(layout->bottom_border);
     psiconv_free_tabs(layout->tabs);
-    free(layout);
+    psiconv_tree_free(layout);
   }
 }
 
 void psiconv_free_style_aux(void *style)
 {
   if(((psiconv_word_style) style)->name)
-    free(((psiconv_word_style) style)->name);
+    psiconv_tree_free(((psiconv_word_style) style)->name);
   psiconv_free_character_layout(((psiconv_word_style) style)->character);
   psiconv_free_paragraph_layout(((psiconv_word_style) style)->paragraph);
 }
@@ -473,7 +472,7 @@ void psiconv_free_word_style(psiconv_word_style style)
 {
   if (style) {
     psiconv_free_style_aux(style);
-    free(style);
+    psiconv_tree_free(style);
   }
 }
 
@@ -488,10 +487,11 @@ void psiconv_free_word_styles_section(psiconv_word_styles_section styles)
   if (styles) {
     psiconv_free_word_style(styles->normal);
     psiconv_free_word_style_list(styles->styles);
-    free(styles);
+    psiconv_tree_free(styles);
   }
 }
 
+/* Header and application id sections always come from the heap */
 void psiconv_free_header_section(psiconv_header_section header)
 {
   if (header)
@@ -501,7 +501,7 @@ void psiconv_free_header_section(psiconv_header_section header)
 void psiconv_free_section_table_entry(psiconv_section_table_entry entry)
 {
   if (entry)
-    free(entry);
+    psiconv_tree_free(entry);
 }
 
 void psiconv_free_section_table_section(psiconv_section_table_section section)
@@ -523,15 +523,15 @@ void psiconv_free_object_icon_section(psiconv_object_icon_section section)
 {
   if (section) {
     if (section->icon_name)
-      free(section->icon_name);
-    free(section);
+      psiconv_tree_free(section->icon_name);
+    psiconv_tree_free(section);
   }
 }
 
 void psiconv_free_object_display_section(psiconv_object_display_section section)
 {
   if (section)
-    free(section);
+    psiconv_tree_free(section);
 }
 
 void psiconv_free_embedded_object_section
@@ -541,7 +541,7 @@ void psiconv_free_embedded_object_section
     psiconv_free_object_icon_section(object->icon);
     psiconv_free_object_display_section(object->display);
     psiconv_free_file(object->object);
-    free(object);
+    psiconv_tree_free(object);
   }
 }
 
@@ -556,7 +556,7 @@ void psiconv_free_in_line_layout(psiconv_in_line_layout layout)
 {
   if (layout) {
     psiconv_free_in_line_layout_aux(layout);
-    free(layout);
+    psiconv_tree_free(layout);
   }
 }
 
@@ -569,7 +569,7 @@ void psiconv_free_in_line_layouts(psiconv_in_line_layouts layouts)
 void psiconv_free_replacement(psiconv_replacement replacement)
 {
   if (replacement) 
-    free(replacement);
+    psiconv_tree_free(replacement);
 }
 
 void psiconv_free_replacements(psiconv_replacements replacements)
@@ -581,7 +581,7 @@ void psiconv_free_replacements(psiconv_replacements replacements)
 void psiconv_free_paragraph_aux(void * paragraph)
 {
   if(((psiconv_paragraph) paragraph)->text)
-    free(((psiconv_paragraph) paragraph)->text);
+    psiconv_tree_free(((psiconv_paragraph) paragraph)->text);
   psiconv_free_character_layout(((psiconv_paragraph) paragraph)
                                                        ->base_character);
   psiconv_free_paragraph_layout(((psiconv_paragraph) paragraph)
@@ -596,7 +596,7 @@ void psiconv_free_paragraph(psiconv_paragraph paragraph)
 {
   if (paragraph) {
     psiconv_free_paragraph_aux(paragraph);
-    free(paragraph);
+    psiconv_tree_free(paragraph);
   }
 }
 
@@ -610,7 +610,7 @@ void psiconv_free_texted_section(psiconv_texted_section section)
 {
   if (section) {
     psiconv_free_text_and_layout(section->paragraphs);
-    free(section);
+    psiconv_tree_free(section);
   }
 }
 
@@ -620,7 +620,7 @@ void psiconv_free_page_header(psiconv_page_header header)
     psiconv_free_character_layout(header->base_character_layout);
     psiconv_free_paragraph_layout(header->base_paragraph_layout);
     psiconv_free_texted_section(header->text);
-    free(header);
+    psiconv_tree_free(header);
   }
 }
 
@@ -629,14 +629,14 @@ void psiconv_free_page_layout_section(psiconv_page_layout_section section)
   if (section) {
     psiconv_free_page_header(section->header);
     psiconv_free_page_header(section->footer);
-    free(section);
+    psiconv_tree_free(section);
   }
 }
 
 void psiconv_free_word_status_section(psiconv_word_status_section section)
 {
   if (section) 
-    free(section);
+    psiconv_tree_free(section);
 }
 
 void psiconv_free_word_f(psiconv_word_f file)
@@ -646,20 +646,20 @@ void psiconv_free_word_f(psiconv_word_f file)
     psiconv_free_text_and_layout(file->paragraphs);
     psiconv_free_word_status_section(file->status_sec);
     psiconv_free_word_styles_section(file->styles_sec);
-    free(file);
+    psiconv_tree_free(file);
   }
 }
 
 void psiconv_free_sheet_status_section(psiconv_sheet_status_section section)
 {
   if (section) 
-    free(section);
+    psiconv_tree_free(section);
 }
 
 void psiconv_free_sheet_numberformat(psiconv_sheet_numberformat numberformat)
 {
   if (numberformat)
-    free(numberformat);
+    psiconv_tree_free(numberformat);
 }
 
 void psiconv_free_sheet_cell_layout(psiconv_sheet_cell_layout layout)
@@ -676,14 +676,14 @@ void psiconv_free_sheet_cell_aux(void *cell)
   psiconv_free_sheet_cell_layout(data->layout);
 
   if ((data->type == psiconv_cell_string) && (data->data.dat_string))
-    free(data->data.dat_string);
+    psiconv_tree_free(data->data.dat_string);
 }
 
 void psiconv_free_sheet_cell(psiconv_sheet_cell cell)
 {
   if (cell) {
     psiconv_free_sheet_cell_aux(cell);
-    free(cell);
+    psiconv_tree_free(cell);
   }
 }
 
@@ -704,7 +704,7 @@ void psiconv_free_sheet_line(psiconv_sheet_line line)
 {
   if (line) {
     psiconv_free_sheet_line_aux(line);
-    free(line);
+    psiconv_tree_free(line);
   }
 }
 
@@ -724,7 +724,7 @@ void psiconv_free_sheet_grid_break_list(psiconv_sheet_grid_break_list list)
 void psiconv_free_sheet_grid_size(psiconv_sheet_grid_size s)
 {
   if (s)
-    free(s);
+    psiconv_tree_free(s);
 }
 
 void psiconv_free_sheet_grid_size_list(psiconv_sheet_grid_size_list list)
@@ -740,7 +740,7 @@ void psiconv_free_sheet_grid_section(psiconv_sheet_grid_section sec)
     psiconv_free_sheet_grid_size_list(sec->column_heights);
     psiconv_free_sheet_grid_break_list(sec->row_page_breaks);
     psiconv_free_sheet_grid_break_list(sec->column_page_breaks);
-    free(sec);
+    psiconv_tree_free(sec);
   }
 }
 
@@ -758,7 +758,7 @@ void psiconv_free_sheet_worksheet(psiconv_sheet_worksheet sheet)
 {
   if (sheet) {
     psiconv_free_sheet_worksheet_aux(sheet);
-    free(sheet);
+    psiconv_tree_free(sheet);
   }
 }
 
@@ -773,7 +773,7 @@ void psiconv_free_formula_aux(void *data)
   psiconv_formula formula;
   formula = data;
   if (formula->type == psiconv_formula_dat_string) 
-    free(formula->data.dat_string);
+    psiconv_tree_free(formula->data.dat_string);
   else if ((formula->type != psiconv_formula_dat_int) &&
            (formula->type != psiconv_formula_dat_var) &&
            (formula->type != psiconv_formula_dat_float) &&
@@ -791,7 +791,7 @@ void psiconv_free_formula(psiconv_formula formula)
 {
   if (formula) {
     psiconv_free_formula_aux(formula);
-    free(formula);
+    psiconv_tree_free(formula);
   }
 }
 
@@ -805,15 +805,15 @@ void psiconv_free_sheet_name_section(psiconv_sheet_name_section section)
 {
   if (section) {
     if(section->name)
-      free(section->name);
-    free(section);
+      psiconv_tree_free(section->name);
+    psiconv_tree_free(section);
   }
 }
 
 void psiconv_free_sheet_info_section(psiconv_sheet_info_section section)
 {
   if (section) {
-    free(section);
+    psiconv_tree_free(section);
   }
 }
 
@@ -821,16 +821,16 @@ void psiconv_free_sheet_variable_aux(void * variable)
 {
   psiconv_sheet_variable var = variable;
   if (var->name)
-    free(var->name);
+    psiconv_tree_free(var->name);
   if (var->type == psiconv_var_string)
-    free(var->data.dat_string);
+    psiconv_tree_free(var->data.dat_string);
 }
 
 void psiconv_free_sheet_variable(psiconv_sheet_variable var)
 {
   if (var) {
     psiconv_free_sheet_variable_aux(var);
-    free(var);
+    psiconv_tree_free(var);
   }
 }
 
@@ -848,7 +848,7 @@ void psiconv_free_sheet_workbook_section(psiconv_sheet_workbook_section section)
     psiconv_free_sheet_name_section(section->name);
     psiconv_free_sheet_info_section(section->info);
     psiconv_free_sheet_variable_list(section->variables);
-    free(section);
+    psiconv_tree_free(section);
   }
 }
 
@@ -858,7 +858,7 @@ void psiconv_free_sheet_f(psiconv_sheet_f file)
     psiconv_free_page_layout_section(file->page_sec);
     psiconv_free_sheet_status_section(file->status_sec);
     psiconv_free_sheet_workbook_section(file->workbook_sec);
-    free(file);
+    psiconv_tree_free(file);
   }
 }
 
@@ -867,25 +867,27 @@ void psiconv_free_texted_f(psiconv_texted_f file)
   if (file) {
     psiconv_free_page_layout_section(file->page_sec);
     psiconv_free_texted_section(file->texted_sec);
-    free(file);
+    psiconv_tree_free(file);
   }
 }
 
 void psiconv_free_paint_data_section_aux(void * section)
 {
   if (((psiconv_paint_data_section) section)->red)
-    free(((psiconv_paint_data_section)section) -> red);
+    psiconv_tree_free(((psiconv_paint_data_section)section) -> red);
   if (((psiconv_paint_data_section) section)->green)
-    free(((psiconv_paint_data_section)section) -> green);
+    psiconv_tree_free(((psiconv_paint_data_section)section) -> green);
   if (((psiconv_paint_data_section) section)->blue)
-    free(((psiconv_paint_data_section)section) -> blue);
+    psiconv_tree_free(((psiconv_paint_data_section)section) -> blue);
+  if (((psiconv_paint_data_section) section)->rgb)
+    psiconv_tree_free(((psiconv_paint_data_section)section) -> rgb);
 }
 
 void psiconv_free_paint_data_section(psiconv_paint_data_section section)
 {
   if (section) {
     psiconv_free_paint_data_section_aux(section);
-    free(section);
+    psiconv_tree_free(section);
   }
 }
 
@@ -905,7 +907,7 @@ void psiconv_free_mbm_f(psiconv_mbm_f file)
 {
   if (file) {
     psiconv_free_pictures(file->sections);
-    free(file);
+    psiconv_tree_free(file);
   }
 }
 
@@ -913,7 +915,7 @@ void psiconv_free_sketch_section(psiconv_sketch_section sec)
 {
   if (sec) {
     psiconv_free_paint_data_section(sec->picture);
-    free(sec);
+    psiconv_tree_free(sec);
   }
 }
 
@@ -921,7 +923,7 @@ void psiconv_free_sketch_f(psiconv_sketch_f file)
 {
   if (file) {
     psiconv_free_sketch_section(file->sketch_sec);
-    free(file);
+    psiconv_tree_free(file);
   }
 }
 
@@ -935,7 +937,7 @@ void psiconv_free_clipart_section(psiconv_clipart_section section)
 {
   if (section) {
     psiconv_free_clipart_section_aux(section);
-    free(section);
+    psiconv_tree_free(section);
   }
 }
 
@@ -949,7 +951,7 @@ void psiconv_free_clipart_f(psiconv_clipart_f file)
 {
   if (file) {
     psiconv_free_cliparts(file->sections);
-    free(file);
+    psiconv_tree_free(file);
   }
 }
 
@@ -968,7 +970,7 @@ void psiconv_free_file(psiconv_file file)
       psiconv_free_clipart_f((psiconv_clipart_f) file->file);
     else if (file->type == psiconv_sheet_file)
       psiconv_free_sheet_f((psiconv_sheet_f) file->file);
-    free(file);
+    psiconv_tree_free(file);
   }
 }
 
@@ -1041,6 +1043,7 @@ int psiconv_compare_all_tabs(const psiconv_all_tabs value1,
                              const psiconv_all_tabs value2)
 {
   int i;
+  psiconv_tab tabs1,tabs2;
 
   if (!value1 || !value2 || !value1->extras || !value2->extras)
     return 1;
@@ -1049,10 +1052,10 @@ int psiconv_compare_all_tabs(const psiconv_all_tabs value1,
       psiconv_list_length(value1->extras) != 
                                         psiconv_list_length(value2->extras))
     return 1;
+  tabs1 = psiconv_list_data(value1->extras);
+  tabs2 = psiconv_list_data(value2->extras);
   for (i = 0; i < psiconv_list_length(value1->extras); i++) 
-    if (psiconv_compare_tab(psiconv_list_get(value1->extras,i),
-                            psiconv_list_get(value2->extras,i)))
-    
+    if (psiconv_compare_tab(tabs1+i,tabs2+i))
       return 1;
   return 0;
 }
@@ -1107,16 +1110,46 @@ int psiconv_compare_character_layout(const psiconv_character_layout value1,
     return 1;
 }
 
+void psiconv_paint_data_get_floats(const psiconv_paint_data_section section,
+                                   psiconv_u32 index,
+                                   float *red, float *green, float *blue)
+{
+  if (section->rgb) {
+    *red = section->rgb[3*index] / 255.0;
+    *green = section->rgb[3*index+1] / 255.0;
+    *blue = section->rgb[3*index+2] / 255.0;
+  } else {
+    *red = section->red[index];
+    *green = section->green[index];
+    *blue = section->blue[index];
+  }
+}
+
+void psiconv_paint_data_get_rgb8(const psiconv_paint_data_section section,
+                                 psiconv_u32 index, psiconv_u8 *red,
+                                 psiconv_u8 *green, psiconv_u8 *blue)
+{
+  if (section->rgb) {
+    *red = section->rgb[3*index];
+    *green = section->rgb[3*index+1];
+    *blue = section->rgb[3*index+2];
+  } else {
+    *red = section->red[index] * 255 + 0.5;
+    *green = section->green[index] * 255 + 0.5;
+    *blue = section->blue[index] * 255 + 0.5;
+  }
+}
+
 
 
 psiconv_word_styles_section psiconv_empty_word_styles_section(void)
 {
   psiconv_word_styles_section result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
-  if (!(result->styles = psiconv_list_new(sizeof(struct psiconv_word_style_s))))
+  if (!(result->styles = psiconv_tree_list_new(sizeof(struct psiconv_word_style_s))))
     goto ERROR2;
-  if (!(result->normal = malloc(sizeof(struct psiconv_word_style_s))))
+  if (!(result->normal = psiconv_tree_malloc(sizeof(struct psiconv_word_style_s))))
     goto ERROR3;
   if (!(result->normal->character = psiconv_basic_character_layout()))
     goto ERROR4;
@@ -1130,30 +1163,30 @@ psiconv_word_styles_section psiconv_empty_word_styles_section(void)
 ERROR5:
   psiconv_free_character_layout(result->normal->character);
 ERROR4:
-  free(result->normal);
+  psiconv_tree_free(result->normal);
 ERROR3:
   psiconv_list_free(result->styles);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
 
 psiconv_text_and_layout psiconv_empty_text_and_layout(void)
 {
-  return psiconv_list_new(sizeof(struct psiconv_paragraph_s));
+  return psiconv_tree_list_new(sizeof(struct psiconv_paragraph_s));
 }
 
 psiconv_texted_section psiconv_empty_texted_section(void)
 {
   psiconv_texted_section result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->paragraphs = psiconv_empty_text_and_layout()))
     goto ERROR2;
   return result;
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1161,7 +1194,7 @@ ERROR1:
 psiconv_page_header psiconv_empty_page_header(void)
 {
   psiconv_page_header result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   result->on_first_page = psiconv_bool_true;
   if (!(result->base_paragraph_layout = psiconv_basic_paragraph_layout()))
@@ -1176,7 +1209,7 @@ ERROR4:
 ERROR3:
   psiconv_free_paragraph_layout(result->base_paragraph_layout);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1184,7 +1217,7 @@ ERROR1:
 psiconv_page_layout_section psiconv_empty_page_layout_section(void)
 {
   psiconv_page_layout_section result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   result->first_page_nr = 1;
   result->header_dist = result->footer_dist = 1.27;
@@ -1201,7 +1234,7 @@ psiconv_page_layout_section psiconv_empty_page_layout_section(void)
 ERROR3:
   psiconv_free_page_header(result->header);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1209,7 +1242,7 @@ ERROR1:
 psiconv_word_status_section psiconv_empty_word_status_section(void)
 {
   psiconv_word_status_section result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     return NULL;
   result->show_tabs = result->show_spaces = result->show_paragraph_ends =
         result->show_hard_minus = result->show_hard_space = 
@@ -1225,7 +1258,7 @@ psiconv_word_status_section psiconv_empty_word_status_section(void)
 psiconv_word_f psiconv_empty_word_f(void)
 {
   psiconv_word_f result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->page_sec = psiconv_empty_page_layout_section()))
     goto ERROR2;
@@ -1243,7 +1276,7 @@ ERROR4:
 ERROR3:
   psiconv_free_page_layout_section(result->page_sec);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1251,7 +1284,7 @@ ERROR1:
 psiconv_sheet_status_section psiconv_empty_sheet_status_section(void)
 {
   psiconv_sheet_status_section result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     return NULL;
   result->show_horizontal_scrollbar = result->show_vertical_scrollbar = 
         psiconv_triple_auto;
@@ -1266,19 +1299,19 @@ psiconv_sheet_status_section psiconv_empty_sheet_status_section(void)
 
 psiconv_formula_list psiconv_empty_formula_list(void)
 {
-  return psiconv_list_new(sizeof(struct psiconv_formula_s));
+  return psiconv_tree_list_new(sizeof(struct psiconv_formula_s));
 }
 
 psiconv_sheet_workbook_section psiconv_empty_sheet_workbook_section(void)
 {
   psiconv_sheet_workbook_section result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->formulas = psiconv_empty_formula_list()))
     goto ERROR2;
   return result;
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1287,7 +1320,7 @@ ERROR1:
 psiconv_sheet_f psiconv_empty_sheet_f(void)
 {
   psiconv_sheet_f result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->page_sec = psiconv_empty_page_layout_section()))
     goto ERROR2;
@@ -1301,7 +1334,7 @@ ERROR4:
 ERROR3:
   psiconv_free_page_layout_section(result->page_sec);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1309,7 +1342,7 @@ ERROR1:
 psiconv_texted_f psiconv_empty_texted_f(void)
 {
   psiconv_texted_f result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->page_sec = psiconv_empty_page_layout_section()))
     goto ERROR2;
@@ -1319,7 +1352,7 @@ psiconv_texted_f psiconv_empty_texted_f(void)
 ERROR3:
   psiconv_free_page_layout_section(result->page_sec);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1327,24 +1360,25 @@ ERROR1:
 psiconv_paint_data_section psiconv_empty_paint_data_section(void)
 {
   psiconv_paint_data_section result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   /* Is this correct? */
   result->xsize = result->ysize = result->pic_xsize = result->pic_ysize = 0;
   /* Probably forbidden... */
-  if (!(result->red = malloc(0)))
+  if (!(result->red = psiconv_tree_malloc(0)))
     goto ERROR2;
-  if (!(result->green = malloc(0)))
+  if (!(result->green = psiconv_tree_malloc(0)))
     goto ERROR3;
-  if (!(result->blue = malloc(0)))
+  if (!(result->blue = psiconv_tree_malloc(0)))
     goto ERROR4;
+  result->rgb = NULL;
   return result;
 ERROR4:
-  free(result->green);
+  psiconv_tree_free(result->green);
 ERROR3:
-  free(result->red);
+  psiconv_tree_free(result->red);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1354,13 +1388,13 @@ psiconv_pictures psiconv_empty_pictures(void)
 {
   psiconv_pictures result;
   psiconv_paint_data_section pds;
-  if (!(result = psiconv_list_new(sizeof(struct psiconv_paint_data_section_s))))
+  if (!(result = psiconv_tree_list_new(sizeof(struct psiconv_paint_data_section_s))))
     goto ERROR1;
   if (!(pds = psiconv_empty_paint_data_section()))
     goto ERROR2;
   if (psiconv_list_add(result,pds))
     goto ERROR3;
-  free(pds);
+  psiconv_tree_free(pds);
   return result;
 ERROR3:
   psiconv_free_paint_data_section(pds);
@@ -1373,13 +1407,13 @@ ERROR1:
 psiconv_mbm_f psiconv_empty_mbm_f(void)
 {
   psiconv_mbm_f result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->sections = psiconv_empty_pictures()))
     goto ERROR2;
   return result;
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1387,7 +1421,7 @@ ERROR1:
 psiconv_sketch_section psiconv_empty_sketch_section(void)
 {
   psiconv_sketch_section result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   result->displayed_xsize = 320;
   result->displayed_ysize = 200;
@@ -1401,7 +1435,7 @@ psiconv_sketch_section psiconv_empty_sketch_section(void)
     goto ERROR2;
   return result;
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1409,13 +1443,13 @@ ERROR1:
 psiconv_sketch_f psiconv_empty_sketch_f(void)
 {
   psiconv_sketch_f result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->sketch_sec = psiconv_empty_sketch_section()))
     goto ERROR2;
   return result;
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1423,19 +1457,19 @@ ERROR1:
 psiconv_cliparts psiconv_empty_cliparts(void)
 {
   /* Is this correct? */
-  return psiconv_list_new(sizeof(struct psiconv_clipart_section_s));
+  return psiconv_tree_list_new(sizeof(struct psiconv_clipart_section_s));
 }
 
 psiconv_clipart_f psiconv_empty_clipart_f(void)
 {
   psiconv_clipart_f result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->sections = psiconv_empty_cliparts()))
     goto ERROR2;
   return result;
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -1443,7 +1477,7 @@ ERROR1:
 psiconv_file psiconv_empty_file(psiconv_file_type_t type)
 {
   psiconv_file result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     return NULL;
   result->type = type;
   if (type == psiconv_word_file) {
@@ -1468,6 +1502,6 @@ psiconv_file psiconv_empty_file(psiconv_file_type_t type)
     goto ERROR;
   return result;
 ERROR:
-  free(result);
+  psiconv_tree_free(result);
   return NULL;
 }
@@ -543,7 +543,12 @@ typedef psiconv_list psiconv_jumptable_section; /* of psiconv_u32 */
 /* A Paint Data Section
    A collection of pixels.
    Normalized values [0..1] for each color component.
-   Origin is (x,y)=(0,0), to get pixel at (X,Y) use index [Y*xsize+X] */
+   Origin is (x,y)=(0,0), to get pixel at (X,Y) use index [Y*xsize+X]
+   If the configuration asks for packed pixels when parsing, the pixels are
+   stored in rgb instead, as three bytes (red, green, blue) per pixel, and
+   red, green and blue are NULL. Generating works from either form; use
+   psiconv_paint_data_get_floats or psiconv_paint_data_get_rgb8 to read
+   pixels without caring which one is used. */
 typedef struct psiconv_paint_data_section_s
 {
   psiconv_u32 xsize;          /* Number of pixels in a row */
@@ -553,6 +558,7 @@ typedef struct psiconv_paint_data_section_s
   float *red;                 
   float *green;
   float *blue;
+  psiconv_u8 *rgb;            /* NULL unless pixels are packed */
 } *psiconv_paint_data_section;
 
 /* A collection of Paint Data Sections */
@@ -1180,6 +1186,17 @@ extern int psiconv_compare_character_layout
                                (const psiconv_character_layout value1,
                                 const psiconv_character_layout value2);
 
+/* Get the color of the pixel at index [Y*xsize+X] of a Paint Data
+   Section, either as normalized values or as values between 0 and 255 */
+extern void psiconv_paint_data_get_floats
+                               (const psiconv_paint_data_section section,
+                                psiconv_u32 index,
+                                float *red, float *green, float *blue);
+extern void psiconv_paint_data_get_rgb8
+                               (const psiconv_paint_data_section section,
+                                psiconv_u32 index, psiconv_u8 *red,
+                                psiconv_u8 *green, psiconv_u8 *blue);
+
 /* Get a newly allocated file with sensible defaults, ready to generate. */
 extern psiconv_file psiconv_empty_file(psiconv_file_type_t type);
 
@@ -38,6 +38,63 @@ static void psiconv_default_error_handler(int kind, psiconv_u32 off,
 
 #define MAX_MESSAGE 1024
 
+/* Conversion specifications longer than this are not recorded */
+#define TRACE_SPEC_MAX 16
+
+/* The number of format strings whose event number a ring remembers.
+   Must be a power of two, and well above psiconv_trace_nr_events. */
+#define TRACE_CACHE_SIZE 2048
+
+#define TRACE_MAGIC "PSITRACE"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 20
+#define TRACE_RECORD_SIZE 11 /* Without the arguments */
+
+struct psiconv_trace_s {
+  psiconv_u32 size;
+  psiconv_u32 next;   /* The slot the next record goes into */
+  psiconv_u32 length; /* The number of valid records */
+  psiconv_trace_record *records;
+  /* Maps the address of a format string to its event number */
+  const char **cache_formats;
+  psiconv_u32 *cache_events;
+};
+
+typedef enum psiconv_trace_conv_e {
+  psiconv_trace_conv_end,     /* No more conversions */
+  psiconv_trace_conv_percent, /* A literal %% */
+  psiconv_trace_conv_int,
+  psiconv_trace_conv_uint,
+  psiconv_trace_conv_long,
+  psiconv_trace_conv_ulong,
+  psiconv_trace_conv_double,
+  psiconv_trace_conv_string,
+  psiconv_trace_conv_unknown  /* Anything we can not record */
+} psiconv_trace_conv;
+
+static psiconv_trace_conv psiconv_trace_next_conv(const char *format,
+                                                  const char **start,
+                                                  const char **end);
+static void psiconv_trace_add(psiconv_trace trace, int kind, int level,
+                              psiconv_u32 off, const char *format,
+                              va_list ap);
+static void psiconv_vwarn(psiconv_config config, psiconv_u32 off,
+                          const char *format, va_list ap);
+static size_t psiconv_trace_append(char *buffer, size_t len, size_t pos,
+                                   const char *text, size_t text_len);
+static psiconv_u32 psiconv_trace_event(psiconv_trace trace,
+                                       const char *format);
+static const char *psiconv_trace_format(psiconv_u32 event);
+static psiconv_u32 psiconv_trace_checksum(void);
+static int psiconv_trace_little_endian(void);
+static int psiconv_trace_put_u32(psiconv_buffer buf, psiconv_u32 value);
+static psiconv_u32 psiconv_trace_get_u32(const psiconv_u8 *data);
+static int psiconv_trace_put_arg(psiconv_buffer buf, psiconv_trace_conv conv,
+                                 const psiconv_trace_arg *arg);
+static void psiconv_trace_get_arg(const psiconv_u8 *data,
+                                  psiconv_trace_conv conv,
+                                  psiconv_trace_arg *arg);
+
 void psiconv_fatal(psiconv_config config, int level, psiconv_u32 off,
                    const char *format,...)
 {
@@ -55,11 +112,9 @@ void psiconv_fatal(psiconv_config config, int level, psiconv_u32 off,
   else
     psiconv_default_error_handler(PSICONV_VERB_FATAL,off,buffer);
   va_end(ap);
-
-  exit(1);
 }
 
-void psiconv_error(psiconv_config config, int level, psiconv_u32 off,
+void (psiconv_error)(psiconv_config config, int level, psiconv_u32 off,
                   const char *format,...)
 {
   char buffer[MAX_MESSAGE];
@@ -81,14 +136,21 @@ void psiconv_error(psiconv_config config, int level, psiconv_u32 off,
   va_end(ap);
 }
 
-void psiconv_warn(psiconv_config config, int level, psiconv_u32 off,
+void (psiconv_warn)(psiconv_config config, int level, psiconv_u32 off,
                   const char *format,...)
 {
-  char buffer[MAX_MESSAGE];
   va_list ap;
-  size_t curlen;
 
   va_start(ap,format);
+  psiconv_vwarn(config,off,format,ap);
+  va_end(ap);
+}
+
+void psiconv_vwarn(psiconv_config config, psiconv_u32 off,
+                   const char *format, va_list ap)
+{
+  char buffer[MAX_MESSAGE];
+  size_t curlen;
 
   if (config->verbosity >= PSICONV_VERB_WARN) {
     snprintf(buffer,MAX_MESSAGE,"WARNING (offset %08x): ",off);
@@ -100,10 +162,38 @@ void psiconv_warn(psiconv_config config, int level, psiconv_u32 off,
     else
       psiconv_default_error_handler(PSICONV_VERB_WARN,off,buffer);
   }
+}
+
+void (psiconv_warn_repeated)(psiconv_config config, psiconv_repeat *repeat,
+                             int level, psiconv_u32 off,
+                             const char *format,...)
+{
+  va_list ap;
+
+  repeat->count++;
+  repeat->level = level;
+  repeat->off = off;
+  repeat->format = format;
+  if (repeat->count > config->repeat_limit[repeat->msg_class])
+    return;
+
+  va_start(ap,format);
+  psiconv_vwarn(config,off,format,ap);
   va_end(ap);
 }
 
-void psiconv_progress(psiconv_config config,int level, psiconv_u32 off,
+void psiconv_repeat_summary(psiconv_config config, psiconv_repeat *repeat)
+{
+  psiconv_u32 limit = config->repeat_limit[repeat->msg_class];
+
+  if (repeat->count > limit)
+    psiconv_warn(config,repeat->level,repeat->off,
+                 "%s (repeated %u more times)",repeat->format,
+                 repeat->count - limit);
+  repeat->count = 0;
+}
+
+void (psiconv_progress)(psiconv_config config,int level, psiconv_u32 off,
                       const char *format,...)
 {
   char buffer[MAX_MESSAGE];
@@ -112,7 +202,9 @@ void psiconv_progress(psiconv_config config,int level, psiconv_u32 off,
   int i;
 
   va_start(ap,format);
-  if (config->verbosity >= PSICONV_VERB_PROGRESS) {
+  if ((config->verbosity >= PSICONV_VERB_PROGRESS) && config->trace)
+    psiconv_trace_add(config->trace,PSICONV_VERB_PROGRESS,level,off,format,ap);
+  else if (config->verbosity >= PSICONV_VERB_PROGRESS) {
     snprintf(buffer,MAX_MESSAGE,"%08x ",off);
     curlen = strlen(buffer);
 
@@ -137,7 +229,7 @@ void psiconv_progress(psiconv_config config,int level, psiconv_u32 off,
 }
 
 
-void psiconv_debug(psiconv_config config, int level, psiconv_u32 off,
+void (psiconv_debug)(psiconv_config config, int level, psiconv_u32 off,
                    const char *format,...)
 {
   char buffer[MAX_MESSAGE];
@@ -146,7 +238,9 @@ void psiconv_debug(psiconv_config config, int level, psiconv_u32 off,
   int i;
 
   va_start(ap,format);
-  if (config->verbosity >= PSICONV_VERB_DEBUG) {
+  if ((config->verbosity >= PSICONV_VERB_DEBUG) && config->trace)
+    psiconv_trace_add(config->trace,PSICONV_VERB_DEBUG,level,off,format,ap);
+  else if (config->verbosity >= PSICONV_VERB_DEBUG) {
     snprintf(buffer,MAX_MESSAGE,"%08x ",off);
     curlen = strlen(buffer);
 
@@ -168,3 +262,473 @@ void psiconv_debug(psiconv_config config, int level, psiconv_u32 off,
   }
   va_end(ap);
 }
+
+psiconv_trace psiconv_trace_new(psiconv_u32 nr_records)
+{
+  psiconv_trace trace;
+  if (!(trace = malloc(sizeof(*trace))))
+    goto ERROR1;
+  if (!(trace->records = malloc(nr_records * sizeof(*trace->records))))
+    goto ERROR2;
+  if (!(trace->cache_formats = calloc(TRACE_CACHE_SIZE,
+                                      sizeof(*trace->cache_formats))))
+    goto ERROR3;
+  if (!(trace->cache_events = malloc(TRACE_CACHE_SIZE *
+                                     sizeof(*trace->cache_events))))
+    goto ERROR4;
+  trace->size = nr_records;
+  trace->next = 0;
+  trace->length = 0;
+  return trace;
+
+ERROR4:
+  free(trace->cache_formats);
+ERROR3:
+  free(trace->records);
+ERROR2:
+  free(trace);
+ERROR1:
+  return NULL;
+}
+
+void psiconv_trace_free(psiconv_trace trace)
+{
+  if (trace) {
+    free(trace->cache_events);
+    free(trace->cache_formats);
+    free(trace->records);
+    free(trace);
+  }
+}
+
+void psiconv_trace_clear(psiconv_trace trace)
+{
+  trace->next = 0;
+  trace->length = 0;
+}
+
+psiconv_u32 psiconv_trace_length(const psiconv_trace trace)
+{
+  return trace->length;
+}
+
+const psiconv_trace_record *psiconv_trace_get(const psiconv_trace trace,
+                                              psiconv_u32 nr)
+{
+  psiconv_u32 slot;
+  if (nr >= trace->length)
+    return NULL;
+  slot = trace->next + trace->size - trace->length + nr;
+  if (slot >= trace->size)
+    slot -= trace->size;
+  return trace->records + slot;
+}
+
+/* Find the event number of format. Each format string is looked up in the
+   table only once; after that, its address is enough. */
+psiconv_u32 psiconv_trace_event(psiconv_trace trace, const char *format)
+{
+  psiconv_u32 slot,event,i;
+
+  slot = ((unsigned long) format >> 2) & (TRACE_CACHE_SIZE - 1);
+  for (i = 0; i < TRACE_CACHE_SIZE; i++) {
+    if (trace->cache_formats[slot] == format)
+      return trace->cache_events[slot];
+    if (!trace->cache_formats[slot])
+      break;
+    slot = (slot + 1) & (TRACE_CACHE_SIZE - 1);
+  }
+
+  for (event = psiconv_trace_nr_events - 1; event > 0; event--)
+    if (!strcmp(psiconv_trace_events[event],format))
+      break;
+  if (i < TRACE_CACHE_SIZE) {
+    trace->cache_formats[slot] = format;
+    trace->cache_events[slot] = event;
+  }
+  return event;
+}
+
+/* The format string of event, or NULL if it is unknown */
+const char *psiconv_trace_format(psiconv_u32 event)
+{
+  if (event >= psiconv_trace_nr_events)
+    return NULL;
+  return psiconv_trace_events[event];
+}
+
+/* Find the next conversion in format. *start is set to its '%' (or to the
+   terminating zero if there is none), *end to just past it. */
+psiconv_trace_conv psiconv_trace_next_conv(const char *format,
+                                           const char **start,
+                                           const char **end)
+{
+  const char *p;
+  int longs = 0;
+
+  while (*format && (*format != '%'))
+    format++;
+  *start = *end = format;
+  if (!*format)
+    return psiconv_trace_conv_end;
+  p = format + 1;
+  if (*p == '%') {
+    *end = p + 1;
+    return psiconv_trace_conv_percent;
+  }
+  while (*p && strchr("-+ #0123456789.",*p))
+    p++;
+  while (*p == 'h')
+    p++;
+  while (*p == 'l') {
+    longs++;
+    p++;
+  }
+  *end = *p ? p + 1 : p;
+  if ((longs > 1) || (*end - *start >= TRACE_SPEC_MAX))
+    return psiconv_trace_conv_unknown;
+  switch (*p) {
+    case 'd': case 'i':
+      return longs ? psiconv_trace_conv_long : psiconv_trace_conv_int;
+    case 'u': case 'x': case 'X': case 'o':
+      return longs ? psiconv_trace_conv_ulong : psiconv_trace_conv_uint;
+    case 'c':
+      return longs ? psiconv_trace_conv_unknown : psiconv_trace_conv_int;
+    case 'f': case 'e': case 'E': case 'g': case 'G':
+      return psiconv_trace_conv_double;
+    case 's':
+      return longs ? psiconv_trace_conv_unknown : psiconv_trace_conv_string;
+    default:
+      return psiconv_trace_conv_unknown;
+  }
+}
+
+void psiconv_trace_add(psiconv_trace trace, int kind, int level,
+                       psiconv_u32 off, const char *format, va_list ap)
+{
+  psiconv_trace_record *record;
+  const char *start,*end;
+  int nr = 0,done = 0;
+
+  if (!trace->size)
+    return;
+  record = trace->records + trace->next;
+  if (++trace->next == trace->size)
+    trace->next = 0;
+  if (trace->length < trace->size)
+    trace->length++;
+
+  record->event = psiconv_trace_event(trace,format);
+  record->off = off;
+  record->kind = kind;
+  record->level = level < 0 ? 0 : level > 0xff ? 0xff : level;
+
+  /* We stop at the first argument we can not record; it and everything
+     after it are decoded as they appear in the format */
+  if (!record->event)
+    done = 1;
+  while (!done && (nr < PSICONV_TRACE_ARGS)) {
+    switch (psiconv_trace_next_conv(format,&start,&end)) {
+      case psiconv_trace_conv_percent:
+        break;
+      case psiconv_trace_conv_int:
+        record->args[nr++].i = va_arg(ap,int);
+        break;
+      case psiconv_trace_conv_uint:
+        record->args[nr++].i = va_arg(ap,unsigned int);
+        break;
+      case psiconv_trace_conv_long:
+        record->args[nr++].i = va_arg(ap,long);
+        break;
+      case psiconv_trace_conv_ulong:
+        record->args[nr++].i = (long) va_arg(ap,unsigned long);
+        break;
+      case psiconv_trace_conv_double:
+        record->args[nr++].f = va_arg(ap,double);
+        break;
+      case psiconv_trace_conv_string:
+        (void) va_arg(ap,const char *);
+        record->args[nr++].i = 0;
+        break;
+      default:
+        done = 1;
+    }
+    format = end;
+  }
+  record->nr_args = nr;
+}
+
+size_t psiconv_trace_append(char *buffer, size_t len, size_t pos,
+                            const char *text, size_t text_len)
+{
+  if (text_len > len - pos - 1)
+    text_len = len - pos - 1;
+  memcpy(buffer + pos,text,text_len);
+  buffer[pos + text_len] = '\0';
+  return pos + text_len;
+}
+
+void psiconv_trace_decode(const psiconv_trace_record *record,
+                          char *buffer, size_t len)
+{
+  char spec[TRACE_SPEC_MAX];
+  const char *format,*start,*end;
+  const psiconv_trace_arg *arg;
+  psiconv_trace_conv conv;
+  size_t pos;
+  int i,res,nr = 0;
+
+  if (!len)
+    return;
+  snprintf(spec,TRACE_SPEC_MAX,"%08x ",record->off);
+  pos = psiconv_trace_append(buffer,len,0,spec,strlen(spec));
+  for (i = 0; i < record->level; i++)
+    pos = psiconv_trace_append(buffer,len,pos,
+                           record->kind == PSICONV_VERB_DEBUG ? "-" : "=",1);
+  pos = psiconv_trace_append(buffer,len,pos,"> ",2);
+
+  if (!(format = psiconv_trace_format(record->event)))
+    format = "(unknown trace event)";
+  for (;;) {
+    conv = psiconv_trace_next_conv(format,&start,&end);
+    pos = psiconv_trace_append(buffer,len,pos,format,start - format);
+    if (conv == psiconv_trace_conv_end)
+      break;
+    if (conv == psiconv_trace_conv_percent) {
+      pos = psiconv_trace_append(buffer,len,pos,"%",1);
+      format = end;
+      continue;
+    }
+    if ((conv == psiconv_trace_conv_unknown) || (nr >= record->nr_args)) {
+      pos = psiconv_trace_append(buffer,len,pos,start,strlen(start));
+      break;
+    }
+    memcpy(spec,start,end - start);
+    spec[end - start] = '\0';
+    arg = record->args + nr++;
+    switch (conv) {
+      case psiconv_trace_conv_int:
+        res = snprintf(buffer + pos,len - pos,spec,(int) arg->i);
+        break;
+      case psiconv_trace_conv_uint:
+        res = snprintf(buffer + pos,len - pos,spec,(unsigned int) arg->i);
+        break;
+      case psiconv_trace_conv_long:
+        res = snprintf(buffer + pos,len - pos,spec,arg->i);
+        break;
+      case psiconv_trace_conv_ulong:
+        res = snprintf(buffer + pos,len - pos,spec,(unsigned long) arg->i);
+        break;
+      case psiconv_trace_conv_double:
+        res = snprintf(buffer + pos,len - pos,spec,arg->f);
+        break;
+      default:
+        res = snprintf(buffer + pos,len - pos,spec,"...");
+    }
+    if (res > 0)
+      pos = (pos + res >= len) ? len - 1 : pos + res;
+    format = end;
+  }
+}
+
+void psiconv_trace_print(const psiconv_config config,
+                         const psiconv_trace trace)
+{
+  char buffer[MAX_MESSAGE];
+  const psiconv_trace_record *record;
+  psiconv_u32 i;
+
+  for (i = 0; i < psiconv_trace_length(trace); i++) {
+    record = psiconv_trace_get(trace,i);
+    psiconv_trace_decode(record,buffer,MAX_MESSAGE);
+    if (config->error_handler)
+      config->error_handler(record->kind,record->off,buffer);
+    else
+      psiconv_default_error_handler(record->kind,record->off,buffer);
+  }
+}
+
+/* FNV-1a hash over all event format strings, so a dump is never decoded
+   with the wrong table */
+psiconv_u32 psiconv_trace_checksum(void)
+{
+  psiconv_u32 hash = 0x811c9dc5,event;
+  const char *p;
+
+  for (event = 1; event < psiconv_trace_nr_events; event++) {
+    p = psiconv_trace_events[event];
+    do {
+      hash ^= (psiconv_u8) *p;
+      hash *= 0x01000193;
+    } while (*p++);
+  }
+  return hash;
+}
+
+/* Doubles are assumed to be IEEE 754, in the same byte order as integers */
+int psiconv_trace_little_endian(void)
+{
+  double one = 1.0;
+  psiconv_u8 bytes[sizeof(double)];
+
+  memcpy(bytes,&one,sizeof(double));
+  return bytes[sizeof(double) - 1] == 0x3f;
+}
+
+int psiconv_trace_put_u32(psiconv_buffer buf, psiconv_u32 value)
+{
+  psiconv_u8 data[4];
+
+  data[0] = value & 0xff;
+  data[1] = (value >> 8) & 0xff;
+  data[2] = (value >> 16) & 0xff;
+  data[3] = (value >> 24) & 0xff;
+  return psiconv_buffer_add_n(buf,data,4);
+}
+
+psiconv_u32 psiconv_trace_get_u32(const psiconv_u8 *data)
+{
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         ((psiconv_u32) data[3] << 24);
+}
+
+/* Each argument takes 8 bytes: integers are stored as 64 bit two's
+   complement numbers, doubles as their IEEE 754 bits */
+int psiconv_trace_put_arg(psiconv_buffer buf, psiconv_trace_conv conv,
+                          const psiconv_trace_arg *arg)
+{
+  psiconv_u8 bytes[8],data[8];
+  int i,res;
+
+  if (conv == psiconv_trace_conv_double) {
+    memcpy(bytes,&arg->f,8);
+    for (i = 0; i < 8; i++)
+      data[i] = bytes[psiconv_trace_little_endian() ? i : 7-i];
+    return psiconv_buffer_add_n(buf,data,8);
+  }
+  /* Shifting twice keeps this valid where a long has 32 bits */
+  if ((res = psiconv_trace_put_u32(buf,(psiconv_u32) arg->i)))
+    return res;
+  return psiconv_trace_put_u32(buf,(psiconv_u32) ((arg->i >> 16) >> 16));
+}
+
+void psiconv_trace_get_arg(const psiconv_u8 *data, psiconv_trace_conv conv,
+                           psiconv_trace_arg *arg)
+{
+  psiconv_u8 bytes[8];
+  unsigned long value;
+  int i;
+
+  if (conv == psiconv_trace_conv_double) {
+    for (i = 0; i < 8; i++)
+      bytes[i] = data[psiconv_trace_little_endian() ? i : 7-i];
+    memcpy(&arg->f,bytes,8);
+  } else {
+    value = psiconv_trace_get_u32(data + 4);
+    value = ((value << 16) << 16) | psiconv_trace_get_u32(data);
+    arg->i = (long) value;
+  }
+}
+
+int psiconv_trace_dump(const psiconv_trace trace, psiconv_buffer buf)
+{
+  const psiconv_trace_record *record;
+  const char *format,*start,*end;
+  psiconv_trace_conv conv;
+  psiconv_u32 i;
+  int res,nr;
+
+  if ((res = psiconv_buffer_add_n(buf,(const psiconv_u8 *) TRACE_MAGIC,8)))
+    return res;
+  if ((res = psiconv_trace_put_u32(buf,TRACE_VERSION)))
+    return res;
+  if ((res = psiconv_trace_put_u32(buf,psiconv_trace_checksum())))
+    return res;
+  if ((res = psiconv_trace_put_u32(buf,psiconv_trace_length(trace))))
+    return res;
+
+  for (i = 0; i < psiconv_trace_length(trace); i++) {
+    record = psiconv_trace_get(trace,i);
+    if ((res = psiconv_trace_put_u32(buf,record->event)))
+      return res;
+    if ((res = psiconv_trace_put_u32(buf,record->off)))
+      return res;
+    if ((res = psiconv_buffer_add(buf,record->kind)))
+      return res;
+    if ((res = psiconv_buffer_add(buf,record->level)))
+      return res;
+    if ((res = psiconv_buffer_add(buf,record->nr_args)))
+      return res;
+    /* The format tells how each argument was recorded */
+    format = psiconv_trace_format(record->event);
+    for (nr = 0; nr < record->nr_args; format = end) {
+      conv = psiconv_trace_next_conv(format,&start,&end);
+      if (conv == psiconv_trace_conv_percent)
+        continue;
+      if ((res = psiconv_trace_put_arg(buf,conv,record->args + nr++)))
+        return res;
+    }
+  }
+  return 0;
+}
+
+int psiconv_trace_load(const psiconv_buffer buf, psiconv_trace *trace)
+{
+  const psiconv_u8 *data;
+  const char *format,*start,*end;
+  psiconv_trace_conv conv;
+  psiconv_trace_record *record;
+  psiconv_u32 off,count,i;
+  int nr,res;
+
+  if (!(data = psiconv_buffer_span(buf,0,TRACE_HEADER_SIZE)) ||
+      memcmp(data,TRACE_MAGIC,8) ||
+      (psiconv_trace_get_u32(data + 8) != TRACE_VERSION) ||
+      (psiconv_trace_get_u32(data + 12) != psiconv_trace_checksum())) {
+    res = -PSICONV_E_PARSE;
+    goto ERROR1;
+  }
+  count = psiconv_trace_get_u32(data + 16);
+  off = TRACE_HEADER_SIZE;
+
+  if (!(*trace = psiconv_trace_new(count?count:1))) {
+    res = -PSICONV_E_NOMEM;
+    goto ERROR1;
+  }
+  for (i = 0; i < count; i++) {
+    if (!(data = psiconv_buffer_span(buf,off,TRACE_RECORD_SIZE)))
+      goto ERROR2;
+    record = (*trace)->records + i;
+    record->event = psiconv_trace_get_u32(data);
+    record->off = psiconv_trace_get_u32(data + 4);
+    record->kind = data[8];
+    record->level = data[9];
+    record->nr_args = data[10];
+    off += TRACE_RECORD_SIZE;
+    format = psiconv_trace_format(record->event);
+    if ((record->event >= psiconv_trace_nr_events) ||
+        (record->nr_args > (format ? PSICONV_TRACE_ARGS : 0)))
+      goto ERROR2;
+    for (nr = 0; nr < record->nr_args; format = end) {
+      conv = psiconv_trace_next_conv(format,&start,&end);
+      if (conv == psiconv_trace_conv_percent)
+        continue;
+      if ((conv == psiconv_trace_conv_end) ||
+          (conv == psiconv_trace_conv_unknown) ||
+          !(data = psiconv_buffer_span(buf,off,8)))
+        goto ERROR2;
+      psiconv_trace_get_arg(data,conv,record->args + nr++);
+      off += 8;
+    }
+  }
+  (*trace)->length = count;
+  (*trace)->next = count == (*trace)->size ? 0 : count;
+  return 0;
+
+ERROR2:
+  res = -PSICONV_E_PARSE;
+  psiconv_trace_free(*trace);
+ERROR1:
+  *trace = NULL;
+  return res;
+}
@@ -22,13 +22,15 @@
 
 #include <psiconv/general.h>
 #include <psiconv/configuration.h>
+#include <psiconv/buffer.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
 /* These functions print error, warning, progress and debug information to
- *    stderr */
+ *    stderr. psiconv_fatal does not end the program; the caller has to give
+ *    up and return an error code itself. */
 extern void psiconv_fatal(psiconv_config config,int level, psiconv_u32 off, 
                           const char *format,...);
 extern void psiconv_error(psiconv_config config,int level, psiconv_u32 off,
@@ -40,12 +42,162 @@ extern void psiconv_progress(psiconv_config config,int level, psiconv_u32 off,
 extern void psiconv_debug(psiconv_config config,int level, psiconv_u32 off,
                           const char *format,...);
 
+/* Some warnings can be given once for every pixel or cell of a file.
+   Each place that gives such a warning has its own psiconv_repeat,
+   initialized with PSICONV_REPEAT_INIT and the class of the warning (see
+   configuration.h). Only the first repeat_limit warnings of that class are
+   reported; the rest are just counted, until psiconv_repeat_summary is
+   called at the end of the section. It reports the number of warnings
+   left out and resets the count. The summary repeats the format as is,
+   so it should not contain any conversions. */
+typedef struct psiconv_repeat_s {
+  int msg_class;
+  psiconv_u32 count;
+  int level;          /* Level, offset and format of the last warning */
+  psiconv_u32 off;
+  const char *format;
+} psiconv_repeat;
+
+#define PSICONV_REPEAT_INIT(msg_class) { (msg_class), 0, 0, 0, NULL }
+
+extern void psiconv_warn_repeated(psiconv_config config,
+                                  psiconv_repeat *repeat, int level,
+                                  psiconv_u32 off, const char *format,...);
+extern void psiconv_repeat_summary(psiconv_config config,
+                                   psiconv_repeat *repeat);
+
 #define PSICONV_VERB_DEBUG 5
 #define PSICONV_VERB_PROGRESS 4
 #define PSICONV_VERB_WARN 3
 #define PSICONV_VERB_ERROR 2
 #define PSICONV_VERB_FATAL 1
 
+/* The message functions above do nothing if the verbosity of config is
+   too low, but their arguments are still evaluated and the call itself
+   is made. The macros below check the verbosity first, so disabled
+   messages cost next to nothing. If PSICONV_DISABLE_TRACE is defined,
+   progress and debug messages are left out completely. */
+#if (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L)) || \
+    (defined(__cplusplus) && (__cplusplus >= 201103L)) || defined(__GNUC__)
+
+#ifdef PSICONV_DISABLE_TRACE
+#define psiconv_verbose(config,verb) \
+  (((verb) < PSICONV_VERB_PROGRESS) && ((config)->verbosity >= (verb)))
+#else
+#define psiconv_verbose(config,verb) ((config)->verbosity >= (verb))
+#endif
+
+#define PSICONV_GUARDED_MESSAGE(func,verb,config,level,off,...) \
+  do { \
+    if (psiconv_verbose(config,verb)) \
+      (func)(config,level,off,__VA_ARGS__); \
+  } while (0)
+
+#define psiconv_error(config,level,off,...) \
+  PSICONV_GUARDED_MESSAGE(psiconv_error,PSICONV_VERB_ERROR, \
+                          config,level,off,__VA_ARGS__)
+#define psiconv_warn(config,level,off,...) \
+  PSICONV_GUARDED_MESSAGE(psiconv_warn,PSICONV_VERB_WARN, \
+                          config,level,off,__VA_ARGS__)
+#define psiconv_warn_repeated(config,repeat,level,off,...) \
+  do { \
+    if (psiconv_verbose(config,PSICONV_VERB_WARN)) \
+      (psiconv_warn_repeated)(config,repeat,level,off,__VA_ARGS__); \
+  } while (0)
+#define psiconv_progress(config,level,off,...) \
+  PSICONV_GUARDED_MESSAGE(psiconv_progress,PSICONV_VERB_PROGRESS, \
+                          config,level,off,__VA_ARGS__)
+#define psiconv_debug(config,level,off,...) \
+  PSICONV_GUARDED_MESSAGE(psiconv_debug,PSICONV_VERB_DEBUG, \
+                          config,level,off,__VA_ARGS__)
+
+#else /* No variadic macros */
+
+#define psiconv_verbose(config,verb) ((config)->verbosity >= (verb))
+
+#endif
+
+/* Formatting every progress and debug message is slow. Instead, they can
+   be recorded as fixed-size records in a preallocated ring buffer: set
+   the trace field of the configuration to a ring made with
+   psiconv_trace_new. The verbosity still decides which messages are
+   recorded; errors and warnings are always passed to the error handler.
+   When the ring is full, the oldest records are overwritten.
+
+   A record keeps an event number and up to PSICONV_TRACE_ARGS numeric
+   arguments. The event number indexes psiconv_trace_events, a table of
+   all progress and debug format strings generated by trace_events.sh.
+   String arguments are not kept, as they usually do not outlive the
+   call; they are decoded as "...". Format strings that are not in the
+   table are recorded as event 0, without arguments.
+
+   Records can be decoded into the usual message text later on. Because
+   they contain no pointers, a ring can also be saved with
+   psiconv_trace_dump and loaded (by another process using the same
+   library version) with psiconv_trace_load. */
+#define PSICONV_TRACE_ARGS 6
+
+typedef union psiconv_trace_arg_u {
+  long i;
+  double f;
+} psiconv_trace_arg;
+
+typedef struct psiconv_trace_record_s {
+  psiconv_u32 event;  /* Index into psiconv_trace_events */
+  psiconv_u32 off;
+  psiconv_u8 kind;    /* PSICONV_VERB_PROGRESS or PSICONV_VERB_DEBUG */
+  psiconv_u8 level;
+  psiconv_u8 nr_args;
+  psiconv_trace_arg args[PSICONV_TRACE_ARGS];
+} psiconv_trace_record;
+
+typedef struct psiconv_trace_s *psiconv_trace;
+
+/* The format string of each event; entry 0 is NULL */
+extern const char *const psiconv_trace_events[];
+extern const psiconv_u32 psiconv_trace_nr_events;
+
+/* Allocate a ring for nr_records records. Returns NULL when not enough
+   memory is available. */
+extern psiconv_trace psiconv_trace_new(psiconv_u32 nr_records);
+
+/* Free a ring. Make sure no configuration still refers to it. */
+extern void psiconv_trace_free(psiconv_trace trace);
+
+/* Forget all records in the ring */
+extern void psiconv_trace_clear(psiconv_trace trace);
+
+/* The number of records currently in the ring */
+extern psiconv_u32 psiconv_trace_length(const psiconv_trace trace);
+
+/* Get a record; record 0 is the oldest one still in the ring. Returns
+   NULL if nr is out of range. */
+extern const psiconv_trace_record *psiconv_trace_get(const psiconv_trace trace,
+                                                     psiconv_u32 nr);
+
+/* Decode a record into the text the message would have had, and put it
+   into buffer (including the terminating zero, truncated to len bytes). */
+extern void psiconv_trace_decode(const psiconv_trace_record *record,
+                                 char *buffer, size_t len);
+
+/* Decode all records in the ring, oldest first, and pass them to the
+   error handler of config (or print them to stderr, if it has none). */
+extern void psiconv_trace_print(const psiconv_config config,
+                                const psiconv_trace trace);
+
+/* Append all records in the ring, oldest first, to buf. The data is the
+   same on every platform: the magic "PSITRACE", then a version number, a
+   checksum of psiconv_trace_events and the number of records, followed
+   by the records themselves. All numbers are little endian. Returns 0 on
+   success, and an error code on failure. */
+extern int psiconv_trace_dump(const psiconv_trace trace, psiconv_buffer buf);
+
+/* Allocate a new ring holding the records saved in buf. Returns 0 on
+   success, and an error code on failure; -PSICONV_E_PARSE is returned
+   if buf was not saved by psiconv_trace_dump, or if it was saved with a
+   different table of events. */
+extern int psiconv_trace_load(const psiconv_buffer buf, psiconv_trace *trace);
+
 #define PSICONV_E_OK    0
 #define PSICONV_E_OTHER 1
 #define PSICONV_E_NOMEM 2
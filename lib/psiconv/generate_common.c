@@ -117,7 +117,7 @@ int psiconv_write_text_section(const psiconv_config config,
 {
   int res;
   psiconv_buffer extra_buf = NULL;
-  int i,j;
+  int i;
   psiconv_paragraph paragraph;
 
   psiconv_progress(config,lev,0,"Writing text section");
@@ -139,10 +139,10 @@ int psiconv_write_text_section(const psiconv_config config,
         res = -PSICONV_E_NOMEM;
         goto ERROR;
       }
-      for (j = 0; j < psiconv_unicode_strlen(paragraph->text); j++) 
-	if ((res = psiconv_unicode_write_char(config,extra_buf,lev+1,
-                                              paragraph->text[j])))
-          goto ERROR;
+      if ((res = psiconv_unicode_write_string(config,extra_buf,lev+1,
+                              paragraph->text,
+                              psiconv_unicode_strlen(paragraph->text))))
+        goto ERROR;
       psiconv_unicode_write_char(config,extra_buf,lev+1,0x06);
     }
     if ((res = psiconv_write_X(config,buf,lev+1,psiconv_buffer_length(extra_buf))))
@@ -186,6 +186,7 @@ int psiconv_write_layout_section(const psiconv_config config,
   psiconv_word_style style;
   psiconv_character_layout para_charlayout;
   int i,j,para_type,nr_of_inlines=0,res,ptl_length,pel_length,thislen,paralen;
+  int text_len;
 
   psiconv_progress(config,lev,0,"Writing layout section");
   if (!value) {
@@ -230,8 +231,8 @@ int psiconv_write_layout_section(const psiconv_config config,
       res = -PSICONV_E_NOMEM;
       goto ERROR6;
     }
-    if ((res = psiconv_write_u32(config,buf_elements,lev+1,
-	                         psiconv_unicode_strlen(paragraph->text)+1)))
+    text_len = psiconv_unicode_strlen(paragraph->text);
+    if ((res = psiconv_write_u32(config,buf_elements,lev+1,text_len+1)))
       goto ERROR6;
 
     /* We need it for the next if-statement */
@@ -281,12 +282,12 @@ int psiconv_write_layout_section(const psiconv_config config,
         /* If this is the last in_line, we need to make sure that the
            complete length of all inlines equals the text length */
         if (j == psiconv_list_length(paragraph->in_lines)-1) {
-          if (paralen > psiconv_unicode_strlen(paragraph->text)+1) {
+          if (paralen > text_len+1) {
             psiconv_error(config,lev+1,0,"Inline formatting data length and line length are inconsistent");
             res = -PSICONV_E_GENERATE;
             goto ERROR6;
           }
-          thislen += psiconv_unicode_strlen(paragraph->text)+1-paralen;
+          thislen += text_len+1-paralen;
         }
         if ((res = psiconv_write_u32(config,buf_inlines,lev+1,thislen)))
           goto ERROR6;
@@ -20,6 +20,8 @@
 #include "config.h"
 #include "compat.h"
 
+#include <string.h>
+
 #include "generate_routines.h"
 #include "error.h"
 #include "list.h"
@@ -32,10 +34,11 @@
 
 static int psiconv_collect_pixel_data(psiconv_pixel_ints *pixels,
                                int xsize,int ysize, 
-                               const psiconv_pixel_floats_t data,
+                               const psiconv_paint_data_section data,
                                int colordepth,int color,
 			       int redbits,int greenbits,int bluebits,
-			       const psiconv_pixel_floats_t palet);
+			       const psiconv_pixel_floats_t palet,
+			       psiconv_bool_t dither);
 static int psiconv_pixel_data_to_bytes(const psiconv_config config,int lev,
                                 psiconv_pixel_bytes *bytes, int xsize,
                                 int ysize, const psiconv_pixel_ints pixels, 
@@ -46,23 +49,20 @@ static int psiconv_encode_rle8(const psiconv_config config,
 static int psiconv_encode_rle12(const psiconv_config config, 
                         const psiconv_pixel_bytes plain_bytes,
 			psiconv_pixel_bytes *encoded_bytes);
-static int psiconv_encode_rle16(const psiconv_config config, 
-                        const psiconv_pixel_bytes plain_bytes,
-			psiconv_pixel_bytes *encoded_bytes);
-static int psiconv_encode_rle24(const psiconv_config config, 
-                        const psiconv_pixel_bytes plain_bytes,
-			psiconv_pixel_bytes *encoded_bytes);
+static int psiconv_encode_rle(const psiconv_config config, 
+                       const psiconv_pixel_bytes plain_bytes, int pixel_size,
+		       psiconv_pixel_bytes *encoded_bytes);
 
 int psiconv_write_paint_data_section(const psiconv_config config,
                                      psiconv_buffer buf, int lev,
                                      const psiconv_paint_data_section value,
 				     int is_clipart)
 {
-  int res,colordepth,i;
+  int res,colordepth;
   psiconv_pixel_ints ints;
-  psiconv_pixel_floats_t floats,palet;
+  psiconv_pixel_floats_t palet;
   psiconv_list bytes,bytes_rle;
-  psiconv_u8 *byteptr,encoding;
+  psiconv_u8 encoding;
 
   psiconv_progress(config,lev,0,"Writing paint data section");
 
@@ -111,11 +111,6 @@ int psiconv_write_paint_data_section(const psiconv_config config,
     goto ERROR1;
   }
 
-  floats.red = value->red;
-  floats.green = value->green;
-  floats.blue = value->blue;
-  floats.length = value->xsize * value->ysize;
-
   palet = psiconv_palet_none;
   if ((config->color) && (config->redbits == 0) && (config->greenbits == 0) &&
       (config->bluebits == 0))
@@ -126,10 +121,10 @@ int psiconv_write_paint_data_section(const psiconv_config config,
     }
 
   if ((res = psiconv_collect_pixel_data(&ints,value->xsize,
-	                        value->ysize,floats,
+	                        value->ysize,value,
 	                        config->colordepth,config->color,
 				config->redbits,config->greenbits,
-				config->bluebits,palet))) {
+				config->bluebits,palet,config->dither))) {
     psiconv_error(config,lev,0,"Error collecting pixel data");
     goto ERROR1;
   }
@@ -161,14 +156,19 @@ int psiconv_write_paint_data_section(const psiconv_config config,
       break;
     case 16:
       encoding = 0x03;
-      if ((res = psiconv_encode_rle16(config,bytes,&bytes_rle))) {
+      if ((res = psiconv_encode_rle(config,bytes,2,&bytes_rle))) {
         psiconv_error(config,lev,0,"Error encoding RLE16");
 	goto ERROR3;
       }
       break;
     case 24:
+      /* RLE24 can only describe data made of whole pixels */
+      if (psiconv_list_length(bytes) % 3) {
+        encoding = 0x00;
+        break;
+      }
       encoding = 0x04;
-      if ((res = psiconv_encode_rle24(config,bytes,&bytes_rle))) {
+      if ((res = psiconv_encode_rle(config,bytes,3,&bytes_rle))) {
         psiconv_error(config,lev,0,"Error encoding RLE24");
 	goto ERROR3;
       }
@@ -214,11 +214,12 @@ int psiconv_write_paint_data_section(const psiconv_config config,
     if ((res = psiconv_write_u32(config,buf,lev+1,0x00000044)))
       goto ERROR3;
   }
-  for (i = 0; i < psiconv_list_length(bytes); i++) {
-    if (!(byteptr = psiconv_list_get(bytes,i)))
-      goto ERROR3;
-    if ((res = psiconv_write_u8(config,buf,lev+1,*byteptr)))
-      goto ERROR3;
+  psiconv_progress(config,lev+1,0,"Writing %d bytes of pixel data",
+                   psiconv_list_length(bytes));
+  if ((res = psiconv_buffer_add_n(buf,psiconv_list_u8_data(bytes),
+                                  psiconv_list_length(bytes)))) {
+    psiconv_error(config,lev+1,0,"Out of memory error");
+    goto ERROR3;
   }
 
 ERROR3:
@@ -233,60 +234,117 @@ ERROR1:
   return res;
 }
 
-/* Translate the floating point RGB information into pixel values.
+/* Threshold matrix for ordered dithering */
+static const int psiconv_dither_matrix[4][4] = { {  0,  8,  2, 10 },
+                                                 { 12,  4, 14,  6 },
+                                                 {  3, 11,  1,  9 },
+                                                 { 15,  7, 13,  5 } };
+
+#define PSICONV_CLAMP_COLOR(value) \
+  ((value) < 0 ? 0 : (value) > 1 ? 1 : (value))
+
+/* Translate the RGB information of a picture into pixel values.
    The palet is optional; without it, we just use the
-   colordepth. With a large palet this is not very fast, but it will do for
-   now. For greyscale pictures, just use the palet. */
+   colordepth. With a palet, the nearest palet color is found through a
+   table of candidates for each part of the color cube; with dither, an
+   ordered dither pattern about as strong as the distance between palet
+   colors is added first. For greyscale pictures, just use the palet.
+   Packed pictures without a palet are translated through a table per
+   color channel. */
 int psiconv_collect_pixel_data(psiconv_pixel_ints *pixels,int xsize,int ysize, 
-                               const psiconv_pixel_floats_t data,
+                               const psiconv_paint_data_section data,
                                int colordepth,int color,
-			       int redbits,int bluebits,int greenbits,
-			       const psiconv_pixel_floats_t palet)
+			       int redbits,int greenbits,int bluebits,
+			       const psiconv_pixel_floats_t palet,
+			       psiconv_bool_t dither)
 {
-  int res,x,y,i;
+  int res,x,y,i,levels;
   psiconv_u32 index,pixel;
-  float p_red,p_green,p_blue,dist,new_dist;
+  psiconv_u32 *out;
+  const psiconv_u8 *rgb;
+  float p_red,p_green,p_blue,dist,new_dist,spread = 0,offset;
+  psiconv_channel_lut_t channel_lut;
+  psiconv_palet_lut palet_lut = NULL;
 
   if (!(*pixels = psiconv_list_new(sizeof(psiconv_u32)))) {
     res = -PSICONV_E_NOMEM;
     goto ERROR1;
   }
 
+  if (data->rgb && !palet.length) {
+    psiconv_channel_lut_init(&channel_lut,colordepth,color,
+                             redbits,bluebits,greenbits);
+    /* Nothing to convert; appending no elements may return NULL */
+    if (!xsize || !ysize)
+      return 0;
+    if (!(out = psiconv_list_append_uninit(*pixels,xsize*ysize))) {
+      res = -PSICONV_E_NOMEM;
+      goto ERROR2;
+    }
+    rgb = data->rgb;
+    for (index = 0; index < xsize*ysize; index++, rgb += 3)
+      out[index] = (channel_lut.red[rgb[0]] + channel_lut.green[rgb[1]] +
+                    channel_lut.blue[rgb[2]]) * channel_lut.scale;
+    return 0;
+  }
+
+  if (palet.length) {
+    /* Without a table, we just search the whole palet */
+    palet_lut = psiconv_palet_lut_get(palet);
+    if (dither) {
+      for (levels = 2; levels * levels * levels < palet.length; levels++);
+      spread = 1.0 / (levels - 1);
+    }
+  }
+
   for (y = 0; y < ysize; y++) {
     for (x = 0; x < xsize; x++) {
       index = y*xsize+x;
-      p_red = data.red[index];
-      p_green = data.green[index];
-      p_blue = data.blue[index];
+      psiconv_paint_data_get_floats(data,index,&p_red,&p_green,&p_blue);
       if (!palet.length) {
 	if (color) 
-	  pixel = (((psiconv_u32) (p_red * (1 << redbits) + 0.5)) 
+	  pixel = (((psiconv_u32) (p_red * ((1 << redbits) - 1) + 0.5)) 
 	                                      << (greenbits+bluebits)) +
-	          (((psiconv_u32) (p_green * (1 << greenbits) + 0.5))
+	          (((psiconv_u32) (p_green * ((1 << greenbits) - 1) + 0.5))
 		                              << bluebits) +
-	          ((psiconv_u32) (p_blue * (1 << bluebits) + 0.5));
+	          ((psiconv_u32) (p_blue * ((1 << bluebits) - 1) + 0.5));
 	else
 	  pixel = (0.212671 * p_red + 0.715160 * p_green + 0.072169 * p_blue) * ((1 << colordepth) * 0.999);
       } else {
-	dist = 4; /* Max distance is 3, so this is safe */
-	pixel = -1;
-	for (i = 0; i < palet.length; i++) {
-	  new_dist = (p_red - palet.red[i]) * (p_red - palet.red[i]) +
-                     (p_green - palet.green[i]) * (p_green - palet.green[i]) +
-		     (p_blue - palet.blue[i]) * (p_blue - palet.blue[i]);
-	  if (new_dist < dist) {
-	    pixel = i;
-	    dist = new_dist;
+	if (dither) {
+	  offset = ((psiconv_dither_matrix[y % 4][x % 4] + 0.5) / 16 - 0.5) *
+	           spread;
+	  p_red = PSICONV_CLAMP_COLOR(p_red + offset);
+	  p_green = PSICONV_CLAMP_COLOR(p_green + offset);
+	  p_blue = PSICONV_CLAMP_COLOR(p_blue + offset);
+	}
+	if (palet_lut && (p_red >= 0) && (p_red <= 1) && (p_green >= 0) &&
+	    (p_green <= 1) && (p_blue >= 0) && (p_blue <= 1))
+	  pixel = psiconv_palet_lut_nearest(palet_lut,palet,
+	                                    p_red,p_green,p_blue);
+	else {
+	  dist = 4; /* Max distance is 3, so this is safe */
+	  pixel = -1;
+	  for (i = 0; i < palet.length; i++) {
+	    new_dist = (p_red - palet.red[i]) * (p_red - palet.red[i]) +
+                       (p_green - palet.green[i]) * (p_green - palet.green[i]) +
+		       (p_blue - palet.blue[i]) * (p_blue - palet.blue[i]);
+	    if (new_dist < dist) {
+	      pixel = i;
+	      dist = new_dist;
+	    }
 	  }
 	}
       }
-      if ((res = psiconv_list_add(*pixels,&pixel)))
+      if ((res = psiconv_list_u32_add(*pixels,pixel)))
 	goto ERROR2;
     }
   }
+  psiconv_palet_lut_release(palet_lut);
   return 0;
 
 ERROR2:
+  psiconv_palet_lut_release(palet_lut);
   psiconv_list_free(*pixels);
 ERROR1:
   return res;
@@ -333,12 +391,12 @@ int psiconv_pixel_data_to_bytes(const psiconv_config config,int lev,
   for (y = 0; y < ysize; y++) {
     outputbytenr = 0;
     for (x = 0; x < xsize; x++) {
-      if (!(pixelptr = psiconv_list_get(pixels,y*xsize+x))) {
+      if (!(pixelptr = psiconv_list_u32_get(pixels,y*xsize+x))) {
 	psiconv_error(config,lev,0,"Data structure corruption");
 	res = -PSICONV_E_NOMEM;
 	goto ERROR2;
       }
-      inputbitsleft = colordepth;
+      inputbitsleft = psiconv_pixel_storage_bits(colordepth);
       inputdata = *pixelptr;
       while (inputbitsleft) {
 	bitsfit = (inputbitsleft+outputbitnr<=8?inputbitsleft:8-outputbitnr);
@@ -347,7 +405,7 @@ int psiconv_pixel_data_to_bytes(const psiconv_config config,int lev,
 	inputbitsleft -= bitsfit;
 	outputbitnr += bitsfit;
 	if (outputbitnr == 8) {
-	  if ((res = psiconv_list_add(*bytes,&outputbyte)))
+	  if ((res = psiconv_list_u8_add(*bytes,outputbyte)))
 	    goto ERROR2;
 	  outputbitnr = 0;
 	  outputbyte = 0;
@@ -357,7 +415,7 @@ int psiconv_pixel_data_to_bytes(const psiconv_config config,int lev,
     }
     /* Always end lines on a long border */
     if (outputbitnr != 0) {
-      if ((res = psiconv_list_add(*bytes,&outputbyte)))
+      if ((res = psiconv_list_u8_add(*bytes,outputbyte)))
 	goto ERROR2;
       outputbitnr = 0;
       outputbyte = 0;
@@ -365,7 +423,7 @@ int psiconv_pixel_data_to_bytes(const psiconv_config config,int lev,
     }
 
     while (outputbytenr % 0x04) {
-      if ((res = psiconv_list_add(*bytes,&outputbyte)))
+      if ((res = psiconv_list_u8_add(*bytes,outputbyte)))
 	goto ERROR2;
       outputbytenr ++;
     }
@@ -397,21 +455,21 @@ int psiconv_encode_rle8(const psiconv_config config,
   }
 
   for (i = 0; i < psiconv_list_length(plain_bytes);) {
-    if (!(entry = psiconv_list_get(plain_bytes,i))) {
+    if (!(entry = psiconv_list_u8_get(plain_bytes,i))) {
       res = -PSICONV_E_NOMEM;
       goto ERROR2;
     }
-    if (!(next = psiconv_list_get(plain_bytes,i+1))) {
+    if (!(next = psiconv_list_u8_get(plain_bytes,i+1))) {
       res = -PSICONV_E_NOMEM;
       goto ERROR2;
     }
     if (i == psiconv_list_length(plain_bytes) - 2) {
       temp = 0xfe;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
+      if ((res = psiconv_list_u8_add(*encoded_bytes,temp)))
 	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry)))
+      if ((res = psiconv_list_u8_add(*encoded_bytes,*entry)))
 	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,next)))
+      if ((res = psiconv_list_u8_add(*encoded_bytes,*next)))
 	goto ERROR2;
       i +=2;
     } else if (*next == *entry) {
@@ -420,15 +478,15 @@ int psiconv_encode_rle8(const psiconv_config config,
 	     (i+len + 2 < psiconv_list_length(plain_bytes)) &&
 	     len < 0x80) {
 	len ++;
-	if (!(next = psiconv_list_get(plain_bytes,i+len))) {
+	if (!(next = psiconv_list_u8_get(plain_bytes,i+len))) {
 	  res = -PSICONV_E_NOMEM;
 	  goto ERROR2;
 	}
       }
       temp = len - 1;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
+      if ((res = psiconv_list_u8_add(*encoded_bytes,temp)))
 	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry)))
+      if ((res = psiconv_list_u8_add(*encoded_bytes,*entry)))
 	goto ERROR2;
       i += len;
     } else {
@@ -438,21 +496,21 @@ int psiconv_encode_rle8(const psiconv_config config,
 	     len < 0x80) {
 	len ++;
 	entry = next;
-	if (!(next = psiconv_list_get(plain_bytes,i+len))) {
+	if (!(next = psiconv_list_u8_get(plain_bytes,i+len))) {
 	  res = -PSICONV_E_NOMEM;
 	  goto ERROR2;
         }
       }
       len --;
       temp = 0x100 - len;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
+      if ((res = psiconv_list_u8_add(*encoded_bytes,temp)))
         goto ERROR2;
       for (j = 0; j < len; j++) {
-        if (!(next = psiconv_list_get(plain_bytes,i+j))) {
+        if (!(next = psiconv_list_u8_get(plain_bytes,i+j))) {
   	  res = -PSICONV_E_NOMEM;
   	  goto ERROR2;
         }
-        if ((res = psiconv_list_add(*encoded_bytes,next)))
+        if ((res = psiconv_list_u8_add(*encoded_bytes,*next)))
          goto ERROR2;
       }
       i += len;
@@ -467,217 +525,35 @@ ERROR1:
 }
 
 /* RLE12 encoding:
-     Word based. The 12 least significant bits contain the pixel colors.
-     the 4 most signigicant bits are the number of repetitions minus 1 */
+     Word based, on the 16-bit words that hold the pixels. The 12 least
+     significant bits contain the pixel colors, the 4 most significant bits
+     are the number of repetitions minus 1 */
 int psiconv_encode_rle12(const psiconv_config config, 
                         const psiconv_pixel_bytes plain_bytes,
 			psiconv_pixel_bytes *encoded_bytes)
 {
-  typedef psiconv_list psiconv_word_data; /* of psiconv_u16 */
-  psiconv_word_data data;
-  int res,i,len,location;
-  psiconv_u16 *word_entry,*word_next;
-  psiconv_u16 word_data;
-  psiconv_u8 byte_temp;
-  psiconv_u8 *byte_entry;
-  
-
-  /* First extract the 12-bit values to encode */
-  if (!(data = psiconv_list_new(sizeof(psiconv_u16)))) {
-    res = -PSICONV_E_NOMEM;
-    goto ERROR1;
-  }
-
-  for (i = 0; i < psiconv_list_length(plain_bytes); i++) {
-    if (!(byte_entry = psiconv_list_get(plain_bytes,i))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    location = 0;
-    if (location == 0) {
-      word_data = *byte_entry;
-      location ++;
-    } else if (location == 1) {
-      word_data = (word_data << 4) + (*byte_entry & 0x0f);
-      if ((res = psiconv_list_add(data,&word_data)))
-	goto ERROR2;
-      word_data = *byte_entry >> 4;
-      location ++;
-    } else {
-      word_data = (word_data << 8) + *byte_entry;
-      if ((res = psiconv_list_add(data,&word_data)))
-	goto ERROR2;
-      location = 0;
-    }
-  }
+  int res;
+  psiconv_u32 i,len,nr_words;
+  const psiconv_u8 *data;
+  psiconv_u16 word;
 
   if (!(*encoded_bytes = psiconv_list_new(sizeof(psiconv_u8)))) {
-    res = -PSICONV_E_NOMEM;
-    goto ERROR2;
-  }
-
-  for (i = 0; i < psiconv_list_length(data);) {
-    if (!(word_entry = psiconv_list_get(data,i))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR3;
-    }
-
-    if (!(word_next = psiconv_list_get(data,i+1))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR3;
-    }
-
-    if (i == psiconv_list_length(data) - 2) {
-      byte_temp = *word_entry && 0xff;
-      if ((res = psiconv_list_add(*encoded_bytes,&byte_temp)))
-        goto ERROR3;
-      byte_temp = *word_entry >> 8;
-      if ((res = psiconv_list_add(*encoded_bytes,&byte_temp)))
-        goto ERROR3;
-      byte_temp = *word_next && 0xff;
-      if ((res = psiconv_list_add(*encoded_bytes,&byte_temp)))
-        goto ERROR3;
-      byte_temp = *word_next >> 8;
-      if ((res = psiconv_list_add(*encoded_bytes,&byte_temp)))
-        goto ERROR3;
-      i += 2;
-    }
-    
-    len = 0;
-    while ((*word_entry == *word_next) && (len < 16) && 
-	   (i+len+1 < psiconv_list_length(data))) {
-      len ++;
-      if (!(word_next = psiconv_list_get(data,i+len))) {
-	res = -PSICONV_E_NOMEM;
-	goto ERROR3;
-      }
-    }
-
-    byte_temp = *word_entry && 0xff;
-    if ((res = psiconv_list_add(*encoded_bytes,&byte_temp)))
-      goto ERROR3;
-    byte_temp = (*word_entry >> 8) + ((len - 1) << 4);
-    if ((res = psiconv_list_add(*encoded_bytes,&byte_temp)))
-      goto ERROR3;
-    i += len;
-  }
-  return 0;
-
-ERROR3:
-  psiconv_list_free(*encoded_bytes);
-ERROR2:
-  psiconv_list_free(data);
-ERROR1:
-  return res;
-}
-
-/* RLE16 encoding:
-     Marker bytes followed by one or more data words.
-     Marker value 0x00-0x7f: repeat the next data word (marker+1) times
-     Marker value 0xff-0x80: (0x100-marker) data words follow */
-int psiconv_encode_rle16(const psiconv_config config, 
-                        const psiconv_pixel_bytes plain_bytes,
-			psiconv_pixel_bytes *encoded_bytes)
-{
-  int res,i,j,len;
-  psiconv_u8 *entry1,*entry2,*next1,*next2;
-  psiconv_u8 temp;
-
-  if (!(*encoded_bytes = psiconv_list_new(sizeof(*entry1)))) {
     res = -PSICONV_E_NOMEM;
     goto ERROR1;
   }
 
-  for (i = 0; i < psiconv_list_length(plain_bytes);) {
-    if (!(entry1 = psiconv_list_get(plain_bytes,i))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    if (!(entry2 = psiconv_list_get(plain_bytes,i+1))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    if (!(next1 = psiconv_list_get(plain_bytes,i+2))) {
-      res = -PSICONV_E_NOMEM;
+  data = psiconv_list_u8_data(plain_bytes);
+  nr_words = psiconv_list_length(plain_bytes) / 2;
+  for (i = 0; i < nr_words; i += len) {
+    word = (data[2*i] | (data[2*i+1] << 8)) & 0x0fff;
+    for (len = 1; (len < 0x10) && (i + len < nr_words) &&
+                  (data[2*(i+len)] == data[2*i]) &&
+                  (data[2*(i+len)+1] == data[2*i+1]); len++);
+    if ((res = psiconv_list_u8_add(*encoded_bytes,word & 0xff)))
       goto ERROR2;
-    }
-    if (!(next2 = psiconv_list_get(plain_bytes,i+3))) {
-      res = -PSICONV_E_NOMEM;
+    if ((res = psiconv_list_u8_add(*encoded_bytes,
+                                   (word >> 8) | ((len - 1) << 4))))
       goto ERROR2;
-    }
-    if (i == psiconv_list_length(plain_bytes) - 4) {
-      temp = 0xfe;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry1)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry2)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,next1)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,next2)))
-	goto ERROR2;
-      i +=4;
-    } else if ((*next1 == *entry1) && (*next2 == *entry2)) {
-      len = 0;
-      while (((*next1 == *entry1) && (*next2 == *entry2)) && 
-	     (i+2*len + 4 < psiconv_list_length(plain_bytes)) &&
-	     len < 0x80) {
-	len ++;
-	if (!(next1 = psiconv_list_get(plain_bytes,i+len*2))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-	}
-	if (!(next2 = psiconv_list_get(plain_bytes,i+len*2+1))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-	}
-      }
-      temp = len - 1;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry1)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry2)))
-	goto ERROR2;
-      i += len*2;
-    } else {
-      len = 1;
-      while (((*next1 != *entry1) || (*next2 != *entry2))&& 
-	     (i+len*2+4 < psiconv_list_length(plain_bytes)) &&
-	     len < 0x80) {
-	len ++;
-	entry1 = next1;
-	entry2 = next2;
-	if (!(next1 = psiconv_list_get(plain_bytes,i+len*2))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-        }
-	if (!(next2 = psiconv_list_get(plain_bytes,i+len*2+1))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-        }
-      }
-      len --;
-      temp = 0x100 - len;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
-        goto ERROR2;
-      for (j = 0; j < len; j++) {
-        if (!(next1 = psiconv_list_get(plain_bytes,i+j*2))) {
-  	  res = -PSICONV_E_NOMEM;
-  	  goto ERROR2;
-        }
-        if (!(next2 = psiconv_list_get(plain_bytes,i+j*2+1))) {
-  	  res = -PSICONV_E_NOMEM;
-  	  goto ERROR2;
-        }
-        if ((res = psiconv_list_add(*encoded_bytes,next1)))
-         goto ERROR2;
-        if ((res = psiconv_list_add(*encoded_bytes,next2)))
-         goto ERROR2;
-      }
-      i += len*2;
-    }
   }
   return 0;
 
@@ -687,144 +563,46 @@ ERROR1:
   return res;
 }
 
-/* RLE24 encoding:
-     Marker bytes followed by one or more data byte-triplets.
-     Marker value 0x00-0x7f: repeat the next data byte-triplets (marker+1) times
-     Marker value 0xff-0x80: (0x100-marker) data byte-triplets follow */
-int psiconv_encode_rle24(const psiconv_config config, 
-                        const psiconv_pixel_bytes plain_bytes,
-			psiconv_pixel_bytes *encoded_bytes)
+/* RLE16 and RLE24 encoding:
+     Marker bytes followed by one or more pixels of pixel_size bytes.
+     Marker value 0x00-0x7f: repeat the next pixel (marker+1) times
+     Marker value 0xff-0x80: (0x100-marker) pixels follow
+   Any bytes after the last whole pixel are dropped. */
+int psiconv_encode_rle(const psiconv_config config, 
+                       const psiconv_pixel_bytes plain_bytes, int pixel_size,
+		       psiconv_pixel_bytes *encoded_bytes)
 {
-  int res,i,j,len;
-  psiconv_u8 *entry1,*entry2,*entry3,*next1,*next2,*next3;
-  psiconv_u8 temp;
+  int res;
+  psiconv_u32 i,len,nr_pixels;
+  const psiconv_u8 *data,*pixel;
 
-  if (!(*encoded_bytes = psiconv_list_new(sizeof(*entry1)))) {
+  if (!(*encoded_bytes = psiconv_list_new(sizeof(psiconv_u8)))) {
     res = -PSICONV_E_NOMEM;
     goto ERROR1;
   }
 
-  for (i = 0; i < psiconv_list_length(plain_bytes);) {
-    if (!(entry1 = psiconv_list_get(plain_bytes,i))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    if (!(entry2 = psiconv_list_get(plain_bytes,i+1))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    if (!(entry3 = psiconv_list_get(plain_bytes,i+2))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    if (!(next1 = psiconv_list_get(plain_bytes,i+3))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    if (!(next2 = psiconv_list_get(plain_bytes,i+4))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    if (!(next3 = psiconv_list_get(plain_bytes,i+5))) {
-      res = -PSICONV_E_NOMEM;
-      goto ERROR2;
-    }
-    if (i == psiconv_list_length(plain_bytes) - 6) {
-      temp = 0xfe;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry1)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry2)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry3)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,next1)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,next2)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,next3)))
-	goto ERROR2;
-      i +=4;
-    } else if ((*next1 == *entry1) && (*next2 == *entry2) && 
-	       (*next3 == *entry3)) {
-      len = 0;
-      while (((*next1 == *entry1) && (*next2 == *entry2) && 
-	      (*next3 == *entry3)) &&
-	     (i+3*len + 6 < psiconv_list_length(plain_bytes)) &&
-	     len < 0x80) {
-	len ++;
-	if (!(next1 = psiconv_list_get(plain_bytes,i+len*3))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-	}
-	if (!(next2 = psiconv_list_get(plain_bytes,i+len*3+1))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-	}
-	if (!(next3 = psiconv_list_get(plain_bytes,i+len*3+2))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-	}
-      }
-      temp = len - 1;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry1)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry2)))
-	goto ERROR2;
-      if ((res = psiconv_list_add(*encoded_bytes,entry3)))
-	goto ERROR2;
-      i += len*3;
+  data = psiconv_list_u8_data(plain_bytes);
+  nr_pixels = psiconv_list_length(plain_bytes) / pixel_size;
+  for (i = 0; i < nr_pixels; i += len) {
+    pixel = data + i * pixel_size;
+    for (len = 1; (len < 0x80) && (i + len < nr_pixels) &&
+                  !memcmp(pixel,pixel + len * pixel_size,pixel_size); len++);
+    if (len > 1) {
+      if ((res = psiconv_list_u8_add(*encoded_bytes,len - 1)))
+        goto ERROR2;
+      if ((res = psiconv_list_add_n(*encoded_bytes,pixel,pixel_size)))
+        goto ERROR2;
     } else {
-      len = 1;
-      while (((*next1 != *entry1) || (*next2 != *entry2) || 
-	      (*next3 != *entry3)) && 
-	     (i+len*3+6 < psiconv_list_length(plain_bytes)) &&
-	     len < 0x80) {
-	len ++;
-	entry1 = next1;
-	entry2 = next2;
-	entry3 = next3;
-	if (!(next1 = psiconv_list_get(plain_bytes,i+len*3))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-        }
-	if (!(next2 = psiconv_list_get(plain_bytes,i+len*3+1))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-        }
-	if (!(next3 = psiconv_list_get(plain_bytes,i+len*3+2))) {
-	  res = -PSICONV_E_NOMEM;
-	  goto ERROR2;
-        }
-      }
-      len --;
-      temp = 0x100 - len;
-      if ((res = psiconv_list_add(*encoded_bytes,&temp)))
+      /* Take pixels literally up to the start of the next run */
+      for (len = 1; (len < 0x80) && (i + len < nr_pixels) &&
+                    ((i + len + 1 == nr_pixels) ||
+                     memcmp(pixel + len * pixel_size,
+                            pixel + (len + 1) * pixel_size,pixel_size));
+           len++);
+      if ((res = psiconv_list_u8_add(*encoded_bytes,0x100 - len)))
+        goto ERROR2;
+      if ((res = psiconv_list_add_n(*encoded_bytes,pixel,len * pixel_size)))
         goto ERROR2;
-      for (j = 0; j < len; j++) {
-        if (!(next1 = psiconv_list_get(plain_bytes,i+j*3))) {
-  	  res = -PSICONV_E_NOMEM;
-  	  goto ERROR2;
-        }
-        if (!(next2 = psiconv_list_get(plain_bytes,i+j*3+1))) {
-  	  res = -PSICONV_E_NOMEM;
-  	  goto ERROR2;
-        }
-        if (!(next2 = psiconv_list_get(plain_bytes,i+j*3+2))) {
-  	  res = -PSICONV_E_NOMEM;
-  	  goto ERROR2;
-        }
-        if ((res = psiconv_list_add(*encoded_bytes,next1)))
-         goto ERROR2;
-        if ((res = psiconv_list_add(*encoded_bytes,next2)))
-         goto ERROR2;
-        if ((res = psiconv_list_add(*encoded_bytes,next3)))
-         goto ERROR2;
-      }
-      i += len*3;
     }
   }
   return 0;
@@ -222,7 +222,7 @@ int psiconv_write_charlist(const psiconv_config config,psiconv_buffer buf,
 int psiconv_write_string_aux(const psiconv_config config,psiconv_buffer buf,
                              int lev, const psiconv_string_t value,int kind)
 {
-  int res,i,len;
+  int res,len;
   char *printable;
 
   len = psiconv_unicode_strlen(value);
@@ -231,12 +231,14 @@ int psiconv_write_string_aux(const psiconv_config config,psiconv_buffer buf,
     return -PSICONV_E_GENERATE;
   }
 
-  if (!(printable = psiconv_make_printable(config,value))) {
-    psiconv_error(config,lev,0,"Out of memory error");
-    return -PSICONV_E_NOMEM;
+  if (psiconv_verbose(config,PSICONV_VERB_DEBUG)) {
+    if (!(printable = psiconv_make_printable(config,value))) {
+      psiconv_error(config,lev,0,"Out of memory error");
+      return -PSICONV_E_NOMEM;
+    }
+    psiconv_debug(config,lev+1,0,"Value: %s",printable);
+    free(printable);
   }
-  psiconv_debug(config,lev+1,0,"Value: %s",printable);
-  free(printable);
 
   if (kind == -1) 
     res = psiconv_write_S(config,buf,lev+2,len);
@@ -247,10 +249,7 @@ int psiconv_write_string_aux(const psiconv_config config,psiconv_buffer buf,
   if (res)
     return res;
 
-  for (i = 0; i < len; i++) 
-    if ((res = psiconv_unicode_write_char(config,buf,lev+2,value[i]))) 
-      return res;
-  return -PSICONV_E_OK;
+  return psiconv_unicode_write_string(config,buf,lev+2,value,len);
 }
 
 int psiconv_write_offset(const psiconv_config config,psiconv_buffer buf, 
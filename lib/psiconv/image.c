@@ -23,7 +23,14 @@
 #include "config.h"
 #include "compat.h"
 
+#include <stdlib.h>
+
 #include <psiconv/image.h>
+#include "error.h"
+
+#ifdef DMALLOC
+#include <dmalloc.h>
+#endif
 
 #define PALET_NONE_LEN 0
 
@@ -275,3 +282,316 @@ psiconv_pixel_floats_t psiconv_palet_color_8 =
     palet_color_8_blue,
   };
 
+int psiconv_pixel_lut_new(psiconv_pixel_floats_t *lut,
+                          int colordepth, int color,
+                          int redbits, int bluebits, int greenbits,
+                          const psiconv_pixel_floats_t palet)
+{
+  psiconv_u32 i;
+
+  if ((colordepth < 1) || (colordepth > PSICONV_PIXEL_LUT_MAX_DEPTH))
+    return -PSICONV_E_OTHER;
+  lut->length = 1 << colordepth;
+  if (!(lut->red = malloc(lut->length * sizeof(*lut->red))))
+    goto ERROR1;
+  if (!(lut->green = malloc(lut->length * sizeof(*lut->green))))
+    goto ERROR2;
+  if (!(lut->blue = malloc(lut->length * sizeof(*lut->blue))))
+    goto ERROR3;
+  for (i = 0; i < lut->length; i++)
+    psiconv_pixel_to_floats(i,colordepth,color,redbits,bluebits,greenbits,
+                            &palet,&lut->red[i],&lut->green[i],&lut->blue[i]);
+  return 0;
+
+ERROR3:
+  free(lut->green);
+ERROR2:
+  free(lut->red);
+ERROR1:
+  return -PSICONV_E_NOMEM;
+}
+
+void psiconv_pixel_lut_free(psiconv_pixel_floats_t lut)
+{
+  free(lut.red);
+  free(lut.green);
+  free(lut.blue);
+}
+
+/* The entries are computed exactly like psiconv_collect_pixel_data does
+   for a single pixel, so both give the same pixel values */
+void psiconv_channel_lut_init(psiconv_channel_lut_t *lut,
+                              int colordepth, int color,
+                              int redbits, int bluebits, int greenbits)
+{
+  int i;
+  float value;
+
+  for (i = 0; i < 0x100; i++) {
+    value = i / 255.0;
+    if (color) {
+      lut->red[i] = ((psiconv_u32) (value * ((1 << redbits) - 1) + 0.5))
+                                              << (greenbits+bluebits);
+      lut->green[i] = ((psiconv_u32) (value * ((1 << greenbits) - 1) + 0.5))
+                                              << bluebits;
+      lut->blue[i] = (psiconv_u32) (value * ((1 << bluebits) - 1) + 0.5);
+    } else {
+      lut->red[i] = 0.212671 * value;
+      lut->green[i] = 0.715160 * value;
+      lut->blue[i] = 0.072169 * value;
+    }
+  }
+  lut->scale = color ? 1.0 : (1 << colordepth) * 0.999;
+}
+
+/* Palet colors are only left out of a cell if they are farther away than
+   this (squared) from being a candidate, so rounding errors in the float
+   distances can never make them the nearest color after all */
+#define PSICONV_PALET_LUT_SLACK 1e-5
+
+/* The cell a color component between 0 and 1 belongs to */
+#define PSICONV_PALET_LUT_CELL(value) \
+  ((value) >= 1 ? PSICONV_PALET_LUT_CELLS - 1 : \
+                  (int) ((value) * PSICONV_PALET_LUT_CELLS))
+
+struct psiconv_palet_lut_s
+{
+  psiconv_bool_t shared;
+  int cells; /* Along each side of the color cube */
+  /* The candidates of cell c are candidates[start[c]] up to (but not
+     including) candidates[start[c+1]], in increasing order */
+  psiconv_u32 *start;
+  psiconv_u16 *candidates;
+};
+
+/* The tables of psiconv_palet_color_4 and psiconv_palet_color_8. Several
+   threads may try to build them at once; the first one to finish wins,
+   where the compiler lets us */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+static _Atomic(psiconv_palet_lut) palet_lut_cache[2];
+#define PALET_LUT_CACHED(slot) atomic_load(&palet_lut_cache[slot])
+#elif defined(__GNUC__)
+static psiconv_palet_lut volatile palet_lut_cache[2];
+#define PALET_LUT_CACHED(slot) (palet_lut_cache[slot])
+#else
+static psiconv_palet_lut palet_lut_cache[2];
+#define PALET_LUT_CACHED(slot) (palet_lut_cache[slot])
+#endif
+
+static int psiconv_palet_lut_cache(int slot, psiconv_palet_lut lut);
+static psiconv_palet_lut psiconv_palet_lut_new
+                                (const psiconv_pixel_floats_t palet,
+                                 int cells, const psiconv_palet_lut parent);
+static void psiconv_palet_box_dist(const psiconv_pixel_floats_t palet,
+                                   psiconv_u32 color,
+                                   const double *low, const double *high,
+                                   double *mindist, double *maxdist);
+static void psiconv_palet_lut_free(psiconv_palet_lut lut);
+static psiconv_palet_lut psiconv_palet_lut_build
+                                (const psiconv_pixel_floats_t palet);
+
+/* Store lut in the cache, unless another thread beat us to it. Returns
+   whether it was stored. */
+int psiconv_palet_lut_cache(int slot, psiconv_palet_lut lut)
+{
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_ATOMICS__)
+  psiconv_palet_lut expected = NULL;
+  return atomic_compare_exchange_strong(&palet_lut_cache[slot],&expected,lut);
+#elif defined(__GNUC__)
+  return __sync_bool_compare_and_swap(&palet_lut_cache[slot],NULL,lut);
+#else
+  if (palet_lut_cache[slot])
+    return 0;
+  palet_lut_cache[slot] = lut;
+  return 1;
+#endif
+}
+
+/* The squared distances between a palet color and the nearest and the
+   farthest point of a box within the color cube */
+void psiconv_palet_box_dist(const psiconv_pixel_floats_t palet,
+                            psiconv_u32 color,
+                            const double *low, const double *high,
+                            double *mindist, double *maxdist)
+{
+  double value[3],near,far;
+  int i;
+
+  value[0] = palet.red[color];
+  value[1] = palet.green[color];
+  value[2] = palet.blue[color];
+  *mindist = *maxdist = 0;
+  for (i = 0; i < 3; i++) {
+    if (value[i] < low[i])
+      near = low[i] - value[i];
+    else if (value[i] > high[i])
+      near = value[i] - high[i];
+    else
+      near = 0;
+    far = value[i] - low[i] > high[i] - value[i] ? value[i] - low[i] :
+                                                   high[i] - value[i];
+    *mindist += near * near;
+    *maxdist += far * far;
+  }
+}
+
+/* For each cell, the nearest palet color of any color within it is never
+   farther away than the farthest point of the cell is from the palet color
+   for which that is smallest. So any palet color that is farther away from
+   the whole cell can never be the nearest one, and is left out.
+   The candidates of a cell are always among those of any larger cell
+   around it, so if a parent table with half as many cells along each side
+   is given, only its candidates are considered. */
+psiconv_palet_lut psiconv_palet_lut_new(const psiconv_pixel_floats_t palet,
+                                        int cells,
+                                        const psiconv_palet_lut parent)
+{
+  psiconv_palet_lut lut;
+  psiconv_u32 size,cell,parent_cell,first,last,i,color,nr,allocated;
+  psiconv_u16 *candidates;
+  double low[3],high[3],mindist,maxdist,best;
+  int pos[3],j;
+
+  if (!palet.length || (palet.length > PSICONV_PALET_LUT_MAX))
+    goto ERROR1;
+  if (!(lut = malloc(sizeof(*lut))))
+    goto ERROR1;
+  lut->shared = psiconv_bool_false;
+  lut->cells = cells;
+  size = cells * cells * cells;
+  if (!(lut->start = malloc((size + 1) * sizeof(*lut->start))))
+    goto ERROR2;
+  allocated = size;
+  if (!(lut->candidates = malloc(allocated * sizeof(*lut->candidates))))
+    goto ERROR3;
+
+  nr = 0;
+  first = 0;
+  last = palet.length;
+  for (cell = 0; cell < size; cell++) {
+    lut->start[cell] = nr;
+    pos[0] = cell / (cells * cells);
+    pos[1] = (cell / cells) % cells;
+    pos[2] = cell % cells;
+    for (j = 0; j < 3; j++) {
+      low[j] = (double) pos[j] / cells;
+      high[j] = (double) (pos[j] + 1) / cells;
+    }
+    if (parent) {
+      parent_cell = ((pos[0] / 2) * parent->cells + pos[1] / 2) *
+                    parent->cells + pos[2] / 2;
+      first = parent->start[parent_cell];
+      last = parent->start[parent_cell+1];
+    }
+    best = 3;
+    for (i = first; i < last; i++) {
+      color = parent ? parent->candidates[i] : i;
+      psiconv_palet_box_dist(palet,color,low,high,&mindist,&maxdist);
+      if (maxdist < best)
+        best = maxdist;
+    }
+    for (i = first; i < last; i++) {
+      color = parent ? parent->candidates[i] : i;
+      psiconv_palet_box_dist(palet,color,low,high,&mindist,&maxdist);
+      if (mindist > best + PSICONV_PALET_LUT_SLACK)
+        continue;
+      if (nr == allocated) {
+        if (!(candidates = realloc(lut->candidates,
+                                   2 * allocated * sizeof(*candidates))))
+          goto ERROR4;
+        lut->candidates = candidates;
+        allocated *= 2;
+      }
+      lut->candidates[nr++] = color;
+    }
+  }
+  lut->start[cell] = nr;
+  return lut;
+
+ERROR4:
+  free(lut->candidates);
+ERROR3:
+  free(lut->start);
+ERROR2:
+  free(lut);
+ERROR1:
+  return NULL;
+}
+
+void psiconv_palet_lut_free(psiconv_palet_lut lut)
+{
+  free(lut->start);
+  free(lut->candidates);
+  free(lut);
+}
+
+/* Building the table from one with half as many cells along each side is
+   much faster than starting from the whole palet for every cell */
+psiconv_palet_lut psiconv_palet_lut_build(const psiconv_pixel_floats_t palet)
+{
+  psiconv_palet_lut parent,lut;
+
+  if (!(parent = psiconv_palet_lut_new(palet,PSICONV_PALET_LUT_CELLS / 2,
+                                       NULL)))
+    return NULL;
+  lut = psiconv_palet_lut_new(palet,PSICONV_PALET_LUT_CELLS,parent);
+  psiconv_palet_lut_free(parent);
+  return lut;
+}
+
+psiconv_palet_lut psiconv_palet_lut_get(const psiconv_pixel_floats_t palet)
+{
+  psiconv_palet_lut lut;
+  int slot;
+
+  if (palet.red == psiconv_palet_color_4.red)
+    slot = 0;
+  else if (palet.red == psiconv_palet_color_8.red)
+    slot = 1;
+  else
+    return psiconv_palet_lut_build(palet);
+
+  if ((lut = PALET_LUT_CACHED(slot)))
+    return lut;
+  if (!(lut = psiconv_palet_lut_build(palet)))
+    return NULL;
+  lut->shared = psiconv_bool_true;
+  if (!psiconv_palet_lut_cache(slot,lut)) {
+    psiconv_palet_lut_free(lut);
+    lut = PALET_LUT_CACHED(slot);
+  }
+  return lut;
+}
+
+void psiconv_palet_lut_release(psiconv_palet_lut lut)
+{
+  if (lut && !lut->shared)
+    psiconv_palet_lut_free(lut);
+}
+
+psiconv_u32 psiconv_palet_lut_nearest(const psiconv_palet_lut lut,
+                                      const psiconv_pixel_floats_t palet,
+                                      float red, float green, float blue)
+{
+  psiconv_u32 cell,i,color,pixel = 0;
+  float dist,new_dist;
+
+  cell = (PSICONV_PALET_LUT_CELL(red) * PSICONV_PALET_LUT_CELLS +
+          PSICONV_PALET_LUT_CELL(green)) * PSICONV_PALET_LUT_CELLS +
+         PSICONV_PALET_LUT_CELL(blue);
+  dist = 4; /* Max distance is 3, so this is safe */
+  for (i = lut->start[cell]; i < lut->start[cell+1]; i++) {
+    color = lut->candidates[i];
+    new_dist = (red - palet.red[color]) * (red - palet.red[color]) +
+               (green - palet.green[color]) * (green - palet.green[color]) +
+               (blue - palet.blue[color]) * (blue - palet.blue[color]);
+    if (new_dist < dist) {
+      pixel = color;
+      dist = new_dist;
+    }
+  }
+  return pixel;
+}
@@ -43,6 +43,118 @@ typedef struct psiconv_pixel_float_s
 extern psiconv_pixel_floats_t psiconv_palet_none, psiconv_palet_color_4, 
                               psiconv_palet_color_8;
 
+/* Pixels are stored least significant bits first: for depths below 8,
+   the leftmost pixel is in the lowest bits of a byte, and wider pixels
+   are little-endian. 12-bit pixels take a whole 16-bit word, with the
+   top four bits clear. Every line starts at a long. This returns the
+   number of bits a pixel takes. */
+PSICONV_INLINE psiconv_u32 psiconv_pixel_storage_bits(int colordepth)
+{
+  return colordepth == 12?16:colordepth;
+}
+
+/* Normalize the channel value in the lowest bits of value. A channel
+   without any bits is always 0.0. */
+PSICONV_INLINE float psiconv_pixel_channel(psiconv_u32 value, int bits)
+{
+  if (!bits)
+    return 0.0;
+  return ((float) (value & ((1 << bits) - 1))) / ((1 << bits) - 1);
+}
+
+/* Translate one pixel value into normalized colors. Returns 0 if the pixel
+   is not in the palet; color 0 of the palet is used instead. */
+PSICONV_INLINE int psiconv_pixel_to_floats(psiconv_u32 pixel,
+                                    int colordepth, int color,
+                                    int redbits, int bluebits, int greenbits,
+                                    const psiconv_pixel_floats_t *palet,
+                                    float *red, float *green, float *blue)
+{
+  if (!palet->length) {
+    if (color) {
+      *blue = psiconv_pixel_channel(pixel,bluebits);
+      *green = psiconv_pixel_channel(pixel >> bluebits,greenbits);
+      *red = psiconv_pixel_channel(pixel >> (bluebits+greenbits),redbits);
+    } else {
+      *red = *green = *blue = psiconv_pixel_channel(pixel,colordepth);
+    }
+  } else {
+    if (pixel >= palet->length) {
+      *red = palet->red[0];
+      *green = palet->green[0];
+      *blue = palet->blue[0];
+      return 0;
+    } else {
+      *red = palet->red[pixel];
+      *green = palet->green[pixel];
+      *blue = palet->blue[pixel];
+    }
+  }
+  return 1;
+}
+
+/* Pictures with at most this many bits per pixel are converted through a
+   lookup table with an entry for every possible pixel value */
+#define PSICONV_PIXEL_LUT_MAX_DEPTH 16
+
+/* Allocate a table with the normalized colors of all pixel values of the
+   given colordepth, as psiconv_pixel_to_floats would find them. Values
+   that are not in the palet get color 0 of the palet. Returns 0 on success,
+   and an error code on failure. */
+extern int psiconv_pixel_lut_new(psiconv_pixel_floats_t *lut,
+                                 int colordepth, int color,
+                                 int redbits, int bluebits, int greenbits,
+                                 const psiconv_pixel_floats_t palet);
+
+/* Free a table allocated by psiconv_pixel_lut_new */
+extern void psiconv_pixel_lut_free(psiconv_pixel_floats_t lut);
+
+/* The other way around: for pictures with 8 bits per color channel, the
+   part of the pixel value each channel value contributes. The pixel value
+   is the sum of the red, green and blue entries, times scale. */
+typedef struct psiconv_channel_lut_s
+{
+  double red[0x100];
+  double green[0x100];
+  double blue[0x100];
+  double scale;
+} psiconv_channel_lut_t;
+
+/* Fill the table for a picture without palet */
+extern void psiconv_channel_lut_init(psiconv_channel_lut_t *lut,
+                                     int colordepth, int color,
+                                     int redbits, int bluebits, int greenbits);
+
+/* Palets with at most this many colors get a table to find the nearest
+   palet color of a pixel quickly */
+#define PSICONV_PALET_LUT_MAX 0x10000
+
+/* The number of cells along each side of the color cube in such a table */
+#define PSICONV_PALET_LUT_CELLS 32
+
+/* A table that divides the color cube into cells, and lists for each cell
+   the palet colors that may be the nearest one to some color within it.
+   Always use psiconv_palet_lut, never struct psiconv_palet_lut_s */
+typedef struct psiconv_palet_lut_s *psiconv_palet_lut;
+
+/* Get the table of a palet. The tables of the default palets above are
+   built the first time they are needed, and are then shared by everyone;
+   tables of other palets are built on every call. Returns NULL if the palet
+   has too many colors or not enough memory is available. */
+extern psiconv_palet_lut psiconv_palet_lut_get
+                                (const psiconv_pixel_floats_t palet);
+
+/* Release a table got from psiconv_palet_lut_get */
+extern void psiconv_palet_lut_release(psiconv_palet_lut lut);
+
+/* Find the palet color nearest to a color. All components must be between
+   0 and 1. Like a search through the whole palet, the lowest index wins if
+   several colors are equally near. */
+extern psiconv_u32 psiconv_palet_lut_nearest(const psiconv_palet_lut lut,
+                                             const psiconv_pixel_floats_t palet,
+                                             float red, float green,
+                                             float blue);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
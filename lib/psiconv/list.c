@@ -32,15 +32,10 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
 
-static int psiconv_list_resize(psiconv_list l,psiconv_u32 nr);
 
-struct psiconv_list_s {
-  psiconv_u32 cur_len;
-  psiconv_u32 max_len;
-  size_t el_size;
-  void *els;
-};
+static int psiconv_list_resize(psiconv_list l,psiconv_u32 nr);
 
 psiconv_list psiconv_list_new(size_t element_size)
 {
@@ -52,11 +47,32 @@ psiconv_list psiconv_list_new(size_t element_size)
   l->max_len = 0;
   l->el_size=element_size;
   l->els = NULL; 
+  l->arena = NULL;
   return l;
 } 
 
+psiconv_list psiconv_tree_list_new(size_t element_size)
+{
+  psiconv_list l;
+  psiconv_arena arena;
+
+  if (!(arena = psiconv_arena_current()))
+    return psiconv_list_new(element_size);
+  if (!(l = psiconv_arena_alloc(arena,sizeof(*l))))
+    return NULL;
+  l->cur_len = 0;
+  l->max_len = 0;
+  l->el_size=element_size;
+  l->els = NULL;
+  l->arena = arena;
+  return l;
+}
+
 void psiconv_list_free(psiconv_list l)
 {
+  /* Lists in an arena are released with the arena */
+  if (l->arena)
+    return;
   if (l->max_len)
     free(l->els);
   free(l);
@@ -102,6 +118,44 @@ int psiconv_list_add(psiconv_list l, const void *el)
   return 0;
 }
 
+int psiconv_list_add_n(psiconv_list l, const void *els, psiconv_u32 count)
+{
+  void *dest;
+  if (!count)
+    return -PSICONV_E_OK;
+  if (!(dest = psiconv_list_append_uninit(l,count)))
+    return -PSICONV_E_NOMEM;
+  memcpy(dest,els,count * l->el_size);
+  return -PSICONV_E_OK;
+}
+
+int psiconv_list_add_repeat(psiconv_list l, const void *el, psiconv_u32 count)
+{
+  char *dest;
+  psiconv_u32 i;
+  if (!count)
+    return -PSICONV_E_OK;
+  if (!(dest = psiconv_list_append_uninit(l,count)))
+    return -PSICONV_E_NOMEM;
+  if (l->el_size == 1)
+    memset(dest,*(const psiconv_u8 *) el,count);
+  else
+    for (i = 0; i < count; i++, dest += l->el_size)
+      memcpy(dest,el,l->el_size);
+  return -PSICONV_E_OK;
+}
+
+void *psiconv_list_append_uninit(psiconv_list l, psiconv_u32 count)
+{
+  void *dest;
+  if ((count > 0xffffffff - l->cur_len) ||
+      psiconv_list_resize(l,l->cur_len + count))
+    return NULL;
+  dest = ((char *) (l->els)) + l->cur_len * l->el_size;
+  l->cur_len += count;
+  return dest;
+}
+
 int psiconv_list_pop(psiconv_list l, void *el)
 {
   if (! l->cur_len)
@@ -121,23 +175,22 @@ int psiconv_list_replace(psiconv_list l, psiconv_u32 indx, const void *el)
 
 void psiconv_list_foreach_el(psiconv_list l, void action(void *el))
 {
-  psiconv_u32 i;
-  for (i = 0; i < l->cur_len; i ++)
-    action(psiconv_list_get(l,i));
+  char *el = l->els;
+  char *end = el + l->cur_len * l->el_size;
+  for (; el < end; el += l->el_size)
+    action(el);
 }
 
 psiconv_list psiconv_list_clone(const psiconv_list l)
 {
   psiconv_list l2;
-  psiconv_u32 i;
   l2 = psiconv_list_new(l->el_size);
   if (!l2)
     return NULL;
-  for (i = 0; i < l->cur_len; i ++)
-    if (psiconv_list_add(l2,psiconv_list_get(l,i))) {
-      psiconv_list_free(l2);
-      return NULL;
-    }
+  if (psiconv_list_add_n(l2,l->els,l->cur_len)) {
+    psiconv_list_free(l2);
+    return NULL;
+  }
   return l2;
   
 }
@@ -175,22 +228,64 @@ int psiconv_list_fwrite_all(const psiconv_list l, FILE *f)
   return -PSICONV_E_OK;
 }
 
-int psiconv_list_resize(psiconv_list l,psiconv_u32 nr)
+psiconv_u32 psiconv_list_capacity(const psiconv_list l)
+{
+  return l->max_len;
+}
+
+int psiconv_list_reserve(psiconv_list l, psiconv_u32 nr)
 {
   void * temp;
-  if (nr > l->max_len) {
-    l->max_len = 1.1 * nr;
-    l->max_len += 16 - l->max_len % 16;
-    temp = realloc(l->els,l->max_len * l->el_size);
-    if (temp) {
-      l->els = temp;
-      return -PSICONV_E_OK;
-    } else
-      return -PSICONV_E_NOMEM;
+  if (nr <= l->max_len)
+    return -PSICONV_E_OK;
+  if (l->arena)
+    temp = psiconv_arena_realloc(l->arena,l->els,
+                                 (size_t) l->max_len * l->el_size,
+                                 (size_t) nr * l->el_size);
+  else
+    temp = realloc(l->els,(size_t) nr * l->el_size);
+  if (!temp)
+    return -PSICONV_E_NOMEM;
+  l->els = temp;
+  l->max_len = nr;
+  return -PSICONV_E_OK;
+}
+
+int psiconv_list_shrink_to_fit(psiconv_list l)
+{
+  void * temp;
+  /* Memory can not be given back to an arena */
+  if ((l->cur_len == l->max_len) || l->arena)
+    return -PSICONV_E_OK;
+  if (l->cur_len == 0) {
+    free(l->els);
+    l->els = NULL;
+    l->max_len = 0;
+    return -PSICONV_E_OK;
   }
+  if (!(temp = realloc(l->els,(size_t) l->cur_len * l->el_size)))
+    return -PSICONV_E_NOMEM;
+  l->els = temp;
+  l->max_len = l->cur_len;
   return -PSICONV_E_OK;
 }
 
+/* Make room for at least nr elements. The capacity is doubled each time
+   it runs out, so adding elements one by one takes amortized constant
+   time. */
+int psiconv_list_resize(psiconv_list l,psiconv_u32 nr)
+{
+  psiconv_u32 new_len;
+  if (nr <= l->max_len)
+    return -PSICONV_E_OK;
+  new_len = l->max_len < 16 ? 16 : l->max_len;
+  while ((new_len < nr) && (new_len <= 0x7fffffff))
+    new_len *= 2;
+  if (new_len < nr)
+    new_len = nr;
+  return psiconv_list_reserve(l,new_len);
+}
+
 int psiconv_list_concat(psiconv_list l, const psiconv_list extra)
 {
   int res;
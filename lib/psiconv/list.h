@@ -33,9 +33,27 @@ extern "C" {
 #endif /* __cplusplus */
 
 /* Always use psiconv_list, never struct psiconv_list */
-/* No need to export the actual internal format */
 typedef struct psiconv_list_s *psiconv_list; 
 
+/* The internal format is only exported so that psiconv_list_data and the
+   typed accessors below can be inlined. Never use its fields directly. */
+struct psiconv_list_s {
+  psiconv_u32 cur_len;
+  psiconv_u32 max_len;
+  size_t el_size;
+  void *els;
+  struct psiconv_arena_s *arena; /* Where els comes from; NULL for the heap */
+};
+
+#if defined(__cplusplus) || \
+    (defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L))
+#define PSICONV_INLINE static inline
+#elif defined(__GNUC__)
+#define PSICONV_INLINE static __inline__
+#else
+#define PSICONV_INLINE static
+#endif
+
 /* Before using a list, call list_new. It takes the size of a single element
    as its argument. Always compute it with a sizeof() expression, just to be
    safe. The returned list is empty. 
@@ -56,6 +74,18 @@ extern void psiconv_list_free_el(psiconv_list l, void free_el(void *el));
 /* Return the number of allocated elements */
 extern psiconv_u32 psiconv_list_length(const psiconv_list l);
 
+/* Return the number of elements for which space is allocated */
+extern psiconv_u32 psiconv_list_capacity(const psiconv_list l);
+
+/* Make sure space is allocated for at least nr elements, so that adding
+   elements up to that number will not need to allocate memory. Returns
+   0 on success, and an error code on failure. */
+extern int psiconv_list_reserve(psiconv_list l, psiconv_u32 nr);
+
+/* Release any space allocated beyond the current length of the list.
+   Returns 0 on success, and an error code on failure. */
+extern int psiconv_list_shrink_to_fit(psiconv_list l);
+
 /* Return 1 if the list is empty, 0 if not */
 extern int psiconv_list_is_empty(const psiconv_list l);
 
@@ -68,6 +98,25 @@ extern void psiconv_list_empty(psiconv_list l);
    If indx is out of range, NULL is returned. */
 extern void * psiconv_list_get(const psiconv_list l, psiconv_u32 indx);
 
+/* Return a pointer to the elements of the list, which are stored
+   contiguously as an array. You can directly modify them, but the pointer
+   is only valid until elements are added to the list. It may be NULL if
+   the list is empty. */
+PSICONV_INLINE void *psiconv_list_data(const psiconv_list l)
+{
+  return l->els;
+}
+
+/* Walk through all elements of list l, which must be of type type, setting
+   el to a pointer to each in turn. Do not add elements to the list within
+   the loop. For example:
+     psiconv_paragraph para;
+     PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,paragraphs)
+       do_something(para);  */
+#define PSICONV_LIST_FOREACH(type,el,l) \
+  for ((el) = (type *) psiconv_list_data(l); \
+       (el) < (type *) psiconv_list_data(l) + (l)->cur_len; (el) ++)
+
 /* Add an element at the end of the list. The element is copied from the
    supplied element. Of course, this does not help if the element contains
    pointers. 
@@ -76,6 +125,22 @@ extern void * psiconv_list_get(const psiconv_list l, psiconv_u32 indx);
    succeeds, 0 is returned. */
 extern int psiconv_list_add(psiconv_list l, const void *el);
 
+/* Add count elements at the end of the list, copied from the array els.
+   Returns 0 on success, and a negative error-code on failure. */
+extern int psiconv_list_add_n(psiconv_list l, const void *els,
+                              psiconv_u32 count);
+
+/* Add count copies of the element el at the end of the list. Returns 0 on
+   success, and a negative error-code on failure. */
+extern int psiconv_list_add_repeat(psiconv_list l, const void *el,
+                                   psiconv_u32 count);
+
+/* Add count uninitialized elements at the end of the list, and return a
+   pointer to the first of them, so you can fill them in directly. The
+   pointer is only valid until the list is changed again. If not enough
+   memory is available, NULL is returned and the list is unchanged. */
+extern void *psiconv_list_append_uninit(psiconv_list l, psiconv_u32 count);
+
 /* Remove the last element from the list, and copy it to el. Note that
    this will not reduce the amount of space reserved for the list.
    An error code is returned, which will be 0 zero if everything
@@ -118,6 +183,35 @@ extern int psiconv_list_fwrite_all(const psiconv_list l, FILE *f);
 int psiconv_list_concat(psiconv_list l, const psiconv_list extra);
 
 
+/* PSICONV_LIST_DECLARE(name,type) defines typed versions of list_add,
+   list_get and a list_data accessor, called psiconv_list_name_add and
+   so on, for lists created with psiconv_list_new(sizeof(type)). They
+   behave like the generic functions, but are inlined and move elements
+   by assignment instead of by memcpy. psiconv_list_name_data returns the
+   elements as an array; it is only valid until the list is changed. */
+#define PSICONV_LIST_DECLARE(name,type) \
+PSICONV_INLINE int psiconv_list_##name##_add(psiconv_list l, type el) \
+{ \
+  if (l->cur_len < l->max_len) { \
+    ((type *) l->els)[l->cur_len ++] = el; \
+    return 0; \
+  } \
+  return psiconv_list_add(l,&el); \
+} \
+PSICONV_INLINE type *psiconv_list_##name##_get(const psiconv_list l, \
+                                               psiconv_u32 indx) \
+{ \
+  return indx < l->cur_len ? ((type *) l->els) + indx : (type *) NULL; \
+} \
+PSICONV_INLINE type *psiconv_list_##name##_data(const psiconv_list l) \
+{ \
+  return (type *) psiconv_list_data(l); \
+}
+
+PSICONV_LIST_DECLARE(u8,psiconv_u8)
+PSICONV_LIST_DECLARE(u32,psiconv_u32)
+PSICONV_LIST_DECLARE(ucs2,psiconv_ucs2)
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
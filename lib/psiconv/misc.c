@@ -33,15 +33,15 @@
 char *psiconv_make_printable(const psiconv_config config,
                              const psiconv_string_t input)
 {
-  int i;
+  int i,len;
   char *output;
 
-  if (!(output = malloc(sizeof(*output) * 
-	                (psiconv_unicode_strlen(input) + 1)))) {
+  len = psiconv_unicode_strlen(input);
+  if (!(output = malloc(sizeof(*output) * (len + 1)))) {
     return NULL;
   }
 
-  for (i = 0; i < psiconv_unicode_strlen(input); i ++)
+  for (i = 0; i < len; i ++)
     if (input[i] < 0x20 || input[i] >= 0x7f)
       output[i] = '.';
     else
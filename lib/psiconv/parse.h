@@ -30,6 +30,7 @@
 #include <psiconv/common.h>
 #include <psiconv/list.h>
 #include <psiconv/buffer.h>
+#include <psiconv/arena.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -50,6 +51,22 @@ extern psiconv_file_type_t psiconv_file_type(psiconv_config config,
 extern int psiconv_parse(psiconv_config config,
                          const psiconv_buffer buf,psiconv_file *result);
 
+/* Like psiconv_parse, but all memory for *result is taken from arena.
+   The result is read-only: do not change it, and do not call
+   psiconv_free_file (or any other psiconv_free_* function) on it or
+   anything in it; it is released by psiconv_arena_free (see arena.h).
+   Several files may share one arena. */
+extern int psiconv_parse_arena(psiconv_config config,
+                               const psiconv_buffer buf, psiconv_arena arena,
+                               psiconv_file *result);
+
+/* Like psiconv_parse, but parses the len bytes at data directly, without
+   copying them into a psiconv_buffer first. The memory is only read
+   during this call; nothing in *result points into it afterwards. */
+extern int psiconv_parse_bytes(psiconv_config config,
+                               const psiconv_u8 *data, size_t len,
+                               psiconv_file *result);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
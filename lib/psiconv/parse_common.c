@@ -29,6 +29,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 
 static int psiconv_parse_layout_section(const psiconv_config config,
                                  const psiconv_buffer buf,
@@ -52,6 +54,7 @@ int psiconv_parse_header_section(const psiconv_config config,
   psiconv_u32 temp;
 
   psiconv_progress(config,lev+1,off+len,"Going to read the header section");
+  /* Never part of the parse tree, so it always comes from the heap */
   if (!((*result) = malloc(sizeof(**result))))
     goto ERROR1;
   
@@ -162,13 +165,14 @@ int psiconv_parse_section_table_section(const psiconv_config config,
 {
   int res=0;
   int len=0;
-  psiconv_section_table_entry entry;
+  struct psiconv_section_table_entry_s entry;
+  psiconv_reader reader;
 
   int i;
   psiconv_u8 nr;
 
   psiconv_progress(config,lev+1,off+len,"Going to read the section table section");
-  if (!(*result = psiconv_list_new(sizeof(*entry))))
+  if (!(*result = psiconv_list_new(sizeof(entry))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the section table length");
@@ -183,24 +187,26 @@ int psiconv_parse_section_table_section(const psiconv_config config,
   len ++;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the section table entries");
-  entry = malloc(sizeof(*entry));
+  if ((res = psiconv_list_reserve(*result,nr / 2)))
+    goto ERROR2;
+  psiconv_reader_init(&reader,buf,off+len);
   for (i = 0; i < nr / 2; i++) {
-    entry->id = psiconv_read_u32(config,buf,lev+2,off + len,&res);
-    if (res)
-      goto ERROR3;
-    psiconv_debug(config,lev+2,off + len,"Entry %d: ID = %08x",i,entry->id);
+    entry.id = psiconv_reader_u32(&reader);
+    entry.offset = psiconv_reader_u32(&reader);
+    if (reader.error) {
+      psiconv_error(config,lev+2,psiconv_reader_offset(&reader),
+                    "Trying long read past the end of the file");
+      res = reader.error;
+      goto ERROR2;
+    }
+    psiconv_debug(config,lev+2,off + len,"Entry %d: ID = %08x",i,entry.id);
     len += 0x04;
-    entry->offset = psiconv_read_u32(config,buf,lev+2,off + len,&res);
-    if (res)
-      goto ERROR3;
-    psiconv_debug(config,lev+2,off +len,"Entry %d: Offset = %08x",i,entry->offset);
+    psiconv_debug(config,lev+2,off +len,"Entry %d: Offset = %08x",i,entry.offset);
     len += 0x04;
-    if ((res=psiconv_list_add(*result,entry)))
-      goto ERROR3;
+    if ((res=psiconv_list_add(*result,&entry)))
+      goto ERROR2;
   }
 
-  free(entry);
-
   if (length)
     *length = len;
 
@@ -208,8 +214,6 @@ int psiconv_parse_section_table_section(const psiconv_config config,
                    "(total length: %08x)", len);
 
   return 0;
-ERROR3:
-  free(entry);
 ERROR2:
   psiconv_list_free(*result);
 ERROR1:
@@ -230,6 +234,11 @@ int psiconv_parse_application_id_section(const psiconv_config config,
   int res=0;
   int len=0;
   int leng;
+  psiconv_arena arena;
+
+  /* Never part of the parse tree, so it always comes from the heap; that
+     includes the name */
+  arena = psiconv_arena_enter(NULL);
 
   psiconv_progress(config,lev+1,off,"Going to read the application id section");
   if (!(*result = malloc(sizeof(**result))))
@@ -254,10 +263,12 @@ int psiconv_parse_application_id_section(const psiconv_config config,
   psiconv_progress(config,lev+1,off+len-1,"End of application id section "
                    "(total length: %08x", len);
 
+  psiconv_arena_enter(arena);
   return res;
 ERROR2:
   free(*result);
 ERROR1:
+  psiconv_arena_enter(arena);
   psiconv_error(config,lev+1,off,"Reading of Application ID Section failed");
   if (length)
     *length = 0;
@@ -267,6 +278,46 @@ ERROR1:
     return res;
 }
 
+/* Return whether byte 0x06 is the only byte that decodes to the paragraph
+   separator 0x06, so we can look for it with memchr. This is always true
+   for UTF-8, where bytes below 0x80 never occur within other characters */
+static psiconv_bool_t psiconv_separator_is_byte(const psiconv_config config)
+{
+  int i;
+  psiconv_ucs2 ch;
+
+  if (config->unicode)
+    return psiconv_bool_true;
+  for (i = 0; i < 0x100; i++) {
+    ch = config->unicode_table[i]?config->unicode_table[i]:
+                                  config->unknown_unicode_char;
+    if ((ch == 0x06) != (i == 0x06))
+      return psiconv_bool_false;
+  }
+  return psiconv_bool_true;
+}
+
+/* Find the next byte in [data,end) that decodes to the paragraph separator,
+   or return end if there is none */
+static const psiconv_u8 *psiconv_find_separator(const psiconv_config config,
+                                                const psiconv_u8 *data,
+                                                const psiconv_u8 *end,
+                                                psiconv_bool_t is_byte)
+{
+  const psiconv_u8 *res;
+  psiconv_ucs2 ch;
+
+  if (is_byte)
+    return (res = memchr(data,0x06,end - data))?res:end;
+  for (; data < end; data++) {
+    ch = config->unicode_table[*data]?config->unicode_table[*data]:
+                                      config->unknown_unicode_char;
+    if (ch == 0x06)
+      break;
+  }
+  return data;
+}
+
 int psiconv_parse_text_section(const psiconv_config config,
                                const psiconv_buffer buf,int lev,psiconv_u32 off,
                                int *length,psiconv_text_and_layout *result)
@@ -277,18 +328,18 @@ int psiconv_parse_text_section(const psiconv_config config,
 
   psiconv_u32 text_len;
   psiconv_paragraph para;
-  psiconv_ucs2 temp;
-  psiconv_list line;
+  const psiconv_u8 *data,*pos,*next,*end;
+  psiconv_bool_t is_byte;
 
   int nr;
-  int i,leng;
+  int i,leng,nrchars;
   char *str_copy;
  
   psiconv_progress(config,lev+1,off,"Going to parse the text section");
 
-  if(!(*result = psiconv_list_new(sizeof(*para))))
+  if(!(*result = psiconv_tree_list_new(sizeof(*para))))
     goto ERROR1;
-  if (!(para = malloc(sizeof(*para))))
+  if (!(para = psiconv_tree_malloc(sizeof(*para))))
     goto ERROR2;
 
   psiconv_progress(config,lev+2,off,"Reading the text length");
@@ -298,58 +349,64 @@ int psiconv_parse_text_section(const psiconv_config config,
   psiconv_debug(config,lev+2,off,"Length: %08x",text_len);
   len += leng;
 
-  if (!(line = psiconv_list_new(sizeof(psiconv_ucs2))))
+  if (!(data = psiconv_buffer_span(buf,off+len,text_len))) {
+    psiconv_error(config,lev+2,off+len,
+                  "Trying text read past the end of the file");
+    res = -PSICONV_E_PARSE;
     goto ERROR3;
+  }
+  end = data + text_len;
+  is_byte = psiconv_separator_is_byte(config);
 
-  i = 0;
+  /* Each paragraph ends with a separator. If the last one does not, its
+     last character is dropped instead. */
   nr = 0;
-  while (i < text_len) {
-    temp = psiconv_unicode_read_char(config,buf,lev+2,off+len+i,&leng,&res);
-    if (res)
-      goto ERROR4;
-    if (i + leng > text_len) {
-      psiconv_error(config,lev+2,off+len+i,"Malformed text section");
-      res = PSICONV_E_PARSE;
+  for (pos = data; pos < end; pos = next + 1) {
+    next = psiconv_find_separator(config,pos,end,is_byte);
+
+    /* Each character takes at least one byte */
+    if (!(para->text = psiconv_tree_malloc(sizeof(*para->text) * (next - pos + 1))))
+      goto ERROR3;
+    if ((nrchars = psiconv_unicode_decode(config,pos,next - pos,
+                                          para->text)) < 0) {
+      psiconv_error(config,lev+2,off+len+(pos-data),"Malformed text section");
+      res = -PSICONV_E_PARSE;
       goto ERROR4;
     }
-    if ((temp == 0x06) || (i + leng == text_len)) {
-      if (!(para->text = psiconv_unicode_from_list(line))) 
-	goto ERROR4;
+    if (next == end)
+      nrchars--;
+    para->text[nrchars] = 0;
+    i = next - data;
 
+    if (psiconv_verbose(config,PSICONV_VERB_DEBUG)) {
       if (!(str_copy = psiconv_make_printable(config,para->text)))
-        goto ERROR5;
+        goto ERROR4;
       psiconv_debug(config,lev+2,off+i+len,"Line %d: %d characters",nr,
                     strlen(str_copy) +1);
       psiconv_debug(config,lev+2,off+i+len,"Line %d: `%s'",nr,str_copy);
       free(str_copy);
-      i += leng;
-
-      if (!(para->in_lines = psiconv_list_new(sizeof(
-				struct psiconv_in_line_layout_s))))
-	goto ERROR5;
-      if (!(para->replacements = psiconv_list_new(sizeof(
-				struct psiconv_replacement_s)))) 
-	goto ERROR6;
-      if (!(para->base_character = psiconv_basic_character_layout()))
-	 goto ERROR7;
-      if (!(para->base_paragraph = psiconv_basic_paragraph_layout()))
-	 goto ERROR8;
-      para->base_style = 0;
-
-      if ((res = psiconv_list_add(*result,para)))
-        goto ERROR9;
-      psiconv_progress(config,lev+2,off+len+i,"Starting a new line");
-      psiconv_list_empty(line);
-      nr ++;
-    } else {
-      if ((res = psiconv_list_add(line,&temp)))
-	goto ERROR4;
-      i += leng;
     }
+    i ++;
+
+    if (!(para->in_lines = psiconv_tree_list_new(sizeof(
+			      struct psiconv_in_line_layout_s))))
+      goto ERROR4;
+    if (!(para->replacements = psiconv_tree_list_new(sizeof(
+			      struct psiconv_replacement_s)))) 
+      goto ERROR5;
+    if (!(para->base_character = psiconv_basic_character_layout()))
+       goto ERROR6;
+    if (!(para->base_paragraph = psiconv_basic_paragraph_layout()))
+       goto ERROR7;
+    para->base_style = 0;
+
+    if ((res = psiconv_list_add(*result,para)))
+      goto ERROR8;
+    psiconv_progress(config,lev+2,off+len+i,"Starting a new line");
+    nr ++;
   }
 
-  psiconv_list_free(line);
-  free(para);
+  psiconv_tree_free(para);
 
   len += text_len;
 
@@ -361,20 +418,18 @@ int psiconv_parse_text_section(const psiconv_config config,
 
   return res;
 
-ERROR9:
-  psiconv_free_paragraph_layout(para->base_paragraph);
 ERROR8:
-  psiconv_free_character_layout(para->base_character);
+  psiconv_free_paragraph_layout(para->base_paragraph);
 ERROR7:
-  psiconv_list_free(para->replacements);
+  psiconv_free_character_layout(para->base_character);
 ERROR6:
-  psiconv_list_free(para->in_lines);
+  psiconv_list_free(para->replacements);
 ERROR5:
-  free(para->text);
+  psiconv_list_free(para->in_lines);
 ERROR4:
-  psiconv_list_free(line);
+  psiconv_tree_free(para->text);
 ERROR3:
-  free(para);
+  psiconv_tree_free(para);
 ERROR2:
   psiconv_free_text_and_layout(*result);
 ERROR1:
@@ -399,7 +454,7 @@ int psiconv_parse_layout_section(const psiconv_config config,
   int res = 0;
   int len = 0;
   psiconv_u32 temp;
-  int parse_styles,nr,i,j,total,leng,line_length;
+  int parse_styles,nr,i,j,total,leng,line_length,text_len;
 
   typedef struct anon_style_s
   {
@@ -414,6 +469,7 @@ int psiconv_parse_layout_section(const psiconv_config config,
   anon_style_list anon_styles;
   struct anon_style_s anon;
   anon_style anon_ptr=NULL;
+  psiconv_arena arena;
 
   psiconv_character_layout temp_char;
   psiconv_paragraph_layout temp_para;
@@ -485,9 +541,12 @@ int psiconv_parse_layout_section(const psiconv_config config,
         goto ERROR3;
       }
     }
+    /* The anonymous styles are only needed while parsing this section,
+       so their layouts are taken from the heap */
+    arena = psiconv_arena_enter(NULL);
     if (!(anon.paragraph = psiconv_clone_paragraph_layout
                                               (temp_style->paragraph)))
-      goto ERROR3;
+      goto ERROR3_0;
     if (!(anon.character = psiconv_clone_character_layout
                                               (temp_style->character)))
       goto ERROR3_1;
@@ -507,6 +566,7 @@ int psiconv_parse_layout_section(const psiconv_config config,
     len += leng;
     if ((res = psiconv_list_add(anon_styles,&anon)))
       goto ERROR3_2;
+    psiconv_arena_enter(arena);
   }
 
   psiconv_progress(config,lev+2,off+len,"Going to parse the paragraph element list");
@@ -531,9 +591,9 @@ int psiconv_parse_layout_section(const psiconv_config config,
     psiconv_progress(config,lev+3,off+len,"Element %d",i);
     if (i >= psiconv_list_length(result)) {
       psiconv_debug(config,lev+4,off+len,"Going to allocate a new element");
-      if (!(para = malloc(sizeof(*para))))
+      if (!(para = psiconv_tree_malloc(sizeof(*para))))
         goto ERROR4;
-      if (!(para->in_lines = psiconv_list_new(sizeof(
+      if (!(para->in_lines = psiconv_tree_list_new(sizeof(
                               struct psiconv_in_line_layout_s))))
         goto ERROR4_1;
       para->base_style = 0;
@@ -543,7 +603,7 @@ int psiconv_parse_layout_section(const psiconv_config config,
         goto ERROR4_3;
       if ((res = psiconv_list_add(result,para)))
         goto ERROR4_4;
-      free(para);
+      psiconv_tree_free(para);
     }
     if (!(para = psiconv_list_get(result,i)))
       goto ERROR4;
@@ -680,6 +740,7 @@ int psiconv_parse_layout_section(const psiconv_config config,
       goto ERROR4;
     }
     line_length = -1;
+    text_len = psiconv_unicode_strlen(para->text);
     for (j = 0; j < inline_count[i]; j++) {
       psiconv_progress(config,lev+3,off+len,"Element %d: Paragraph %d, element %d",
                         total,i,j);
@@ -759,11 +820,11 @@ int psiconv_parse_layout_section(const psiconv_config config,
         } else if (temp != 0x00) {
           psiconv_warn(config,lev+4,off+len,"Layout section unknown inline type");
         }
-        if (line_length + in_line.length > psiconv_unicode_strlen(para->text)) {
+        if (line_length + in_line.length > text_len) {
           psiconv_warn(config,lev+4,off+len,
                        "Layout section inlines: line length mismatch");
           res = -1;
-          in_line.length = psiconv_unicode_strlen(para->text) - line_length;
+          in_line.length = text_len - line_length;
         }
         line_length += in_line.length;
         if ((res = psiconv_list_add(para->in_lines,&in_line)))
@@ -779,14 +840,17 @@ int psiconv_parse_layout_section(const psiconv_config config,
 
   free(inline_count);
 
+  arena = psiconv_arena_enter(NULL);
   for (i = 0 ; i < psiconv_list_length(anon_styles); i ++) {
     if (!(anon_ptr = psiconv_list_get(anon_styles,i))) {
+      psiconv_arena_enter(arena);
       psiconv_error(config,lev+4,off+len,"Data structure corruption");
       goto ERROR2;
     }
     psiconv_free_character_layout(anon_ptr->character);
     psiconv_free_paragraph_layout(anon_ptr->paragraph);
   }
+  psiconv_arena_enter(arena);
   psiconv_list_free(anon_styles);
 
   if (length)
@@ -804,13 +868,15 @@ ERROR4_3:
 ERROR4_2:
   psiconv_list_free(para->in_lines);
 ERROR4_1:
-  free(para);
+  psiconv_tree_free(para);
   goto ERROR4;
 
 ERROR3_2:
   psiconv_free_character_layout(anon.character);
 ERROR3_1:
   psiconv_free_paragraph_layout(anon.paragraph);
+ERROR3_0:
+  psiconv_arena_enter(arena);
   goto ERROR3;
 
 ERROR5:
@@ -821,6 +887,7 @@ ERROR5:
 ERROR4:
   free(inline_count);
 ERROR3:
+  arena = psiconv_arena_enter(NULL);
   for (i = 0; i < psiconv_list_length(anon_styles); i++) {
     if (!(anon_ptr = psiconv_list_get(anon_styles,i))) {
       psiconv_error(config,lev+1,off,"Data structure corruption");
@@ -829,6 +896,7 @@ ERROR3:
     psiconv_free_paragraph_layout(anon_ptr->paragraph);
     psiconv_free_character_layout(anon_ptr->character);
   }
+  psiconv_arena_enter(arena);
 
 ERROR2:
   psiconv_list_free(anon_styles);
@@ -863,9 +931,9 @@ int psiconv_parse_styleless_layout_section(const psiconv_config config,
   int res = 0;
   psiconv_word_styles_section styles_section;
 
-  if (!(styles_section = malloc(sizeof(*styles_section))))
+  if (!(styles_section = psiconv_tree_malloc(sizeof(*styles_section))))
     goto ERROR1;
-  if (!(styles_section->normal = malloc(sizeof(*styles_section->normal))))
+  if (!(styles_section->normal = psiconv_tree_malloc(sizeof(*styles_section->normal))))
     goto ERROR2;
   if (!(styles_section->normal->character = 
                             psiconv_clone_character_layout(base_char)))
@@ -877,7 +945,7 @@ int psiconv_parse_styleless_layout_section(const psiconv_config config,
 
   if (!(styles_section->normal->name = psiconv_unicode_empty_string()))
     goto ERROR5;
-  if (!(styles_section->styles = psiconv_list_new(sizeof(
+  if (!(styles_section->styles = psiconv_tree_list_new(sizeof(
                                         struct psiconv_word_style_s))))
     goto ERROR6;
   
@@ -888,15 +956,15 @@ int psiconv_parse_styleless_layout_section(const psiconv_config config,
   return res;
 
 ERROR6:
-  free(styles_section->normal->name);
+  psiconv_tree_free(styles_section->normal->name);
 ERROR5:
   psiconv_free_paragraph_layout(styles_section->normal->paragraph);
 ERROR4:
   psiconv_free_character_layout(styles_section->normal->character);
 ERROR3:
-  free(styles_section->normal);
+  psiconv_tree_free(styles_section->normal);
 ERROR2:
-  free(styles_section);
+  psiconv_tree_free(styles_section);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Styleless Layout Section failed");
   if (length)
@@ -921,7 +989,7 @@ int psiconv_parse_embedded_object_section(const psiconv_config config,
   psiconv_buffer subbuf;
 
   psiconv_progress(config,lev+1,off+len,"Going to read an Embedded Object");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
       goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the Embedded Object Section");
@@ -991,7 +1059,7 @@ int psiconv_parse_embedded_object_section(const psiconv_config config,
 	                         psiconv_buffer_length(buf)-table_sec))) 
       goto ERROR4;
     
-    if (!((*result)->object = malloc(sizeof(*(*result)->object))))
+    if (!((*result)->object = psiconv_tree_malloc(sizeof(*(*result)->object))))
        goto ERROR5;
 
     /* We need to find the file type, but we don't have a normal header */
@@ -1039,7 +1107,7 @@ int psiconv_parse_embedded_object_section(const psiconv_config config,
 
  
 ERROR6:
-  free((*result)->object);
+  psiconv_tree_free((*result)->object);
 ERROR5:
   psiconv_buffer_free(subbuf);
 ERROR4:
@@ -1145,7 +1213,7 @@ int psiconv_parse_object_display_section(const psiconv_config config,
   psiconv_u32 temp;
   
   psiconv_progress(config,lev+1,off,"Going to read the Object Display Section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the display as icon flag "
@@ -1198,7 +1266,7 @@ int psiconv_parse_object_display_section(const psiconv_config config,
   return res;
 
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off+len,"Reading of Object Display Section failed");
   if (length)
@@ -1219,7 +1287,7 @@ int psiconv_parse_object_icon_section(const psiconv_config config,
   int leng;
   
   psiconv_progress(config,lev+1,off,"Going to read the Object Icon Section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the icon name");
@@ -1250,9 +1318,9 @@ int psiconv_parse_object_icon_section(const psiconv_config config,
   return res;
 
 ERROR3:
-  free((*result)->icon_name);
+  psiconv_tree_free((*result)->icon_name);
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off+len,"Reading of Object Icon Section failed");
   if (length)
@@ -31,6 +31,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 /* Compare whether application id names match.
    Sought must be lower case; the comparison is case insensitive */
 static psiconv_bool_t applid_matches(psiconv_string_t found, 
@@ -47,6 +49,37 @@ static psiconv_bool_t applid_matches(psiconv_string_t found,
   return psiconv_bool_true;
 }
 
+/* The base layouts of a TextEd file are only needed while it is parsed,
+   so they are taken from the heap and freed there, even while an arena
+   is current */
+static psiconv_character_layout base_character_layout(void)
+{
+  psiconv_arena arena = psiconv_arena_enter(NULL);
+  psiconv_character_layout res = psiconv_basic_character_layout();
+
+  psiconv_arena_enter(arena);
+  return res;
+}
+
+static psiconv_paragraph_layout base_paragraph_layout(void)
+{
+  psiconv_arena arena = psiconv_arena_enter(NULL);
+  psiconv_paragraph_layout res = psiconv_basic_paragraph_layout();
+
+  psiconv_arena_enter(arena);
+  return res;
+}
+
+static void free_base_layouts(psiconv_character_layout base_char,
+                              psiconv_paragraph_layout base_para)
+{
+  psiconv_arena arena = psiconv_arena_enter(NULL);
+
+  psiconv_free_character_layout(base_char);
+  psiconv_free_paragraph_layout(base_para);
+  psiconv_arena_enter(arena);
+}
+
 psiconv_file_type_t psiconv_file_type(const psiconv_config config,
                                       psiconv_buffer buf,int *length,
                                       psiconv_header_section *result)
@@ -75,7 +108,7 @@ int psiconv_parse(const psiconv_config config,const psiconv_buffer buf,
   int off=0;
   int leng;
 
-  if (!((*result) = malloc(sizeof(**result))))
+  if (!((*result) = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   (*result)->type = psiconv_file_type(config,buf,&leng,NULL);
@@ -109,7 +142,7 @@ int psiconv_parse(const psiconv_config config,const psiconv_buffer buf,
   return 0;
 
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Psion File failed");
   if (res == 0)
@@ -118,6 +151,37 @@ ERROR1:
     return res;
 }
 
+int psiconv_parse_arena(const psiconv_config config,const psiconv_buffer buf,
+                        psiconv_arena arena, psiconv_file *result)
+{
+  psiconv_arena old;
+  int res;
+
+  old = psiconv_arena_enter(arena);
+  res = psiconv_parse(config,buf,result);
+  psiconv_arena_enter(old);
+  return res;
+}
+
+int psiconv_parse_bytes(const psiconv_config config,const psiconv_u8 *data,
+                        size_t len, psiconv_file *result)
+{
+  psiconv_buffer buf;
+  int res;
+
+  if (len > 0xffffffffUL) {
+    psiconv_error(config,0,0,"File too large (%lu bytes)",(unsigned long) len);
+    return -PSICONV_E_OTHER;
+  }
+  if (!(buf = psiconv_buffer_borrow(data,len))) {
+    psiconv_error(config,0,0,"Out of memory error");
+    return -PSICONV_E_NOMEM;
+  }
+  res = psiconv_parse(config,buf,result);
+  psiconv_buffer_free(buf);
+  return res;
+}
+
 int psiconv_parse_clipart_file(const psiconv_config config,
                                const psiconv_buffer buf,int lev, 
                                psiconv_u32 off, psiconv_clipart_f *result)
@@ -129,7 +193,7 @@ int psiconv_parse_clipart_file(const psiconv_config config,
   psiconv_u32 *entry;
 
   psiconv_progress(config,lev+1,off,"Going to read a clipart file");
-  if (!((*result) = malloc(sizeof(**result))))
+  if (!((*result) = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off,"Going to read the MBM jumptable");
@@ -137,7 +201,7 @@ int psiconv_parse_clipart_file(const psiconv_config config,
     goto ERROR2;
 
   psiconv_progress(config,lev+2,off,"Going to read the clipart sections");
-  if (!((*result)->sections = psiconv_list_new(sizeof(*clipart))))
+  if (!((*result)->sections = psiconv_tree_list_new(sizeof(*clipart))))
     goto ERROR3;
   for (i = 0; i < psiconv_list_length(table); i ++) {
     if (!(entry = psiconv_list_get(table,i)))
@@ -147,7 +211,7 @@ int psiconv_parse_clipart_file(const psiconv_config config,
       goto ERROR4;
     if ((res = psiconv_list_add((*result)->sections,clipart)))
       goto ERROR5;
-    free(clipart);
+    psiconv_tree_free(clipart);
   }
 
   psiconv_free_jumptable_section(table);
@@ -167,7 +231,7 @@ ERROR4:
 ERROR3:
   psiconv_free_jumptable_section(table);
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Clipart File failed");
   if (res == 0)
@@ -188,7 +252,7 @@ int psiconv_parse_mbm_file(const psiconv_config config,
   psiconv_u32 sto;
 
   psiconv_progress(config,lev+1,off,"Going to read a mbm file");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off,"Going to read the offset of the MBM jumptable");
@@ -202,7 +266,7 @@ int psiconv_parse_mbm_file(const psiconv_config config,
     goto ERROR2;
 
   psiconv_progress(config,lev+2,off,"Going to read the picture sections");
-  if (!((*result)->sections = psiconv_list_new(sizeof(*paint))))
+  if (!((*result)->sections = psiconv_tree_list_new(sizeof(*paint))))
     goto ERROR3;
   for (i = 0; i < psiconv_list_length(table); i ++) {
     if (!(entry = psiconv_list_get(table,i)))
@@ -213,7 +277,7 @@ int psiconv_parse_mbm_file(const psiconv_config config,
       goto ERROR4;
     if ((res = psiconv_list_add((*result)->sections,paint)))
       goto ERROR5;
-    free(paint);
+    psiconv_tree_free(paint);
   }
 
   psiconv_free_jumptable_section(table);
@@ -222,18 +286,11 @@ int psiconv_parse_mbm_file(const psiconv_config config,
 ERROR5:
   psiconv_free_paint_data_section(paint);
 ERROR4:
-  for (i = 0; i < psiconv_list_length((*result)->sections); i++) {
-    if (!(paint = psiconv_list_get((*result)->sections,i))) {
-      psiconv_error(config,lev+1,off,"Data structure corruption");
-      goto ERROR3;
-    }
-    psiconv_free_paint_data_section(paint);
-  }
-  psiconv_list_free((*result)->sections);
+  psiconv_free_pictures((*result)->sections);
 ERROR3:
   psiconv_free_jumptable_section(table);
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of MBM File failed");
   if (res == 0)
@@ -258,7 +315,7 @@ int psiconv_parse_sketch_file(const psiconv_config config,
   char *temp_str;
 
   psiconv_progress(config,lev+1,off,"Going to read a sketch file");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off,
@@ -343,7 +400,7 @@ ERROR4:
 ERROR3:
   free(table);
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sketch File failed");
   if (res == 0)
@@ -372,7 +429,7 @@ int psiconv_parse_texted_file(const psiconv_config config,
   int i;
 
   psiconv_progress(config,lev+1,off,"Going to read a texted file");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off,
@@ -454,10 +511,10 @@ int psiconv_parse_texted_file(const psiconv_config config,
       goto ERROR4;
   }
 
-  if (!(base_char = psiconv_basic_character_layout()))
+  base_char = base_character_layout();
+  base_para = base_paragraph_layout();
+  if (!base_char || !base_para)
     goto ERROR5;
-  if (!(base_para = psiconv_basic_paragraph_layout()))
-    goto ERROR6;
   
   psiconv_progress(config,lev+2,sto,
                    "Looking for the TextEd section");
@@ -465,16 +522,15 @@ int psiconv_parse_texted_file(const psiconv_config config,
    psiconv_error(config,lev+2,sto,
                 "TextEd section not found in the section table");
     res = -PSICONV_E_PARSE;
-    goto ERROR7;
+    goto ERROR5;
   } else {
     psiconv_debug(config,lev+2,sto, "TextEd section at offset %08x",texted_sec);
     if ((res = psiconv_parse_texted_section(config,buf,lev+2,texted_sec,NULL,
                                         &(*result)->texted_sec,
                                         base_char,base_para)))
-      goto ERROR7;
+      goto ERROR5;
   }
-  psiconv_free_character_layout(base_char);
-  psiconv_free_paragraph_layout(base_para);
+  free_base_layouts(base_char,base_para);
   
   psiconv_free_application_id_section(appl_id);
   psiconv_free_section_table_section(table);
@@ -482,18 +538,15 @@ int psiconv_parse_texted_file(const psiconv_config config,
   psiconv_progress(config,lev+1,off,"End of TextEd file");
   return 0;
 
-ERROR7:
-  psiconv_free_paragraph_layout(base_para);
-ERROR6:
-  psiconv_free_character_layout(base_char);
 ERROR5:
+  free_base_layouts(base_char,base_para);
   psiconv_free_page_layout_section((*result)->page_sec);
 ERROR4:
   psiconv_free_application_id_section(appl_id);
 ERROR3:
   psiconv_free_section_table_section(table);
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of TextEd File failed");
   if (res == 0)
@@ -522,7 +575,7 @@ int psiconv_parse_word_file(const psiconv_config config,
   int i;
 
   psiconv_progress(config,lev+1,off,"Going to read a word file");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off,
@@ -698,7 +751,7 @@ ERROR4:
 ERROR3:
   psiconv_free_section_table_section(table);
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Word File failed");
   if (res == 0)
@@ -725,7 +778,7 @@ int psiconv_parse_sheet_file(const psiconv_config config,
   int i;
 
   psiconv_progress(config,lev+1,off,"Going to read a sheet file");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off,
@@ -863,7 +916,7 @@ ERROR4:
 ERROR3:
   psiconv_free_section_table_section(table);
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet File failed");
   if (res == 0)
@@ -29,6 +29,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 
 struct formula_element
 {
@@ -406,24 +408,24 @@ static int psiconv_parse_formula_element_list(const psiconv_config config,
   psiconv_u16 temp,nr_of_subs;
 
   psiconv_progress(config,lev+1,off,"Going to read a formula element list");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
   if (!(formula_stack = psiconv_list_new(sizeof(struct psiconv_formula_s))))
     goto ERROR2;
-  if (!(formula = malloc(sizeof(*formula))))
+  if (!(formula = psiconv_tree_malloc(sizeof(*formula))))
     goto ERROR3;
   /* By setting the type to unknown, we can safely call psiconv_free_formula */
   formula->type = psiconv_formula_unknown;
-  if (!(subformula1 = malloc(sizeof(*subformula1))))
+  if (!(subformula1 = psiconv_tree_malloc(sizeof(*subformula1))))
     goto ERROR4;
   subformula1->type = psiconv_formula_unknown;
-  if (!(subformula2 = malloc(sizeof(*subformula2))))
+  if (!(subformula2 = psiconv_tree_malloc(sizeof(*subformula2))))
     goto ERROR5;
   subformula2->type = psiconv_formula_unknown;
-  if (!(subformula3 = malloc(sizeof(*subformula3))))
+  if (!(subformula3 = psiconv_tree_malloc(sizeof(*subformula3))))
     goto ERROR6;
   subformula3->type = psiconv_formula_unknown;
-  if (!(subformula4 = malloc(sizeof(*subformula4))))
+  if (!(subformula4 = psiconv_tree_malloc(sizeof(*subformula4))))
     goto ERROR7;
   subformula4->type = psiconv_formula_unknown;
 
@@ -523,7 +525,7 @@ static int psiconv_parse_formula_element_list(const psiconv_config config,
     } else if (formula_elements[marker].number_of_args == -1) {
       psiconv_progress(config,lev+3,off+len,"Going to parse a vararg function");
       if (!(formula->data.fun_operands = 
-                      psiconv_list_new(sizeof(*formula))))
+                      psiconv_tree_list_new(sizeof(*formula))))
           goto ERROR8;
       formula->type = formula_elements[marker].formula_type;
       nr_of_subs = 0;
@@ -539,7 +541,7 @@ static int psiconv_parse_formula_element_list(const psiconv_config config,
           psiconv_free_formula(subformula);
           goto ERROR8;
         }
-        free(subformula);
+        psiconv_tree_free(subformula);
         psiconv_progress(config,lev+4,off+len,"Going to read the next marker");
         submarker = psiconv_read_u8(config,buf,lev+4,off+len,&res);
         len ++;
@@ -608,7 +610,7 @@ static int psiconv_parse_formula_element_list(const psiconv_config config,
         if ((res = psiconv_list_pop(formula_stack,subformula4)))
           goto ERROR8;
       if (!(formula->data.fun_operands = 
-                      psiconv_list_new(sizeof(*formula))))
+                      psiconv_tree_list_new(sizeof(*formula))))
           goto ERROR8;
        formula->type = formula_elements[marker].formula_type;
       if (formula_elements[marker].number_of_args > 3) 
@@ -644,7 +646,7 @@ static int psiconv_parse_formula_element_list(const psiconv_config config,
   if ((res = psiconv_list_pop(formula_stack,*result)))
     goto ERROR8;
   psiconv_list_free(formula_stack);
-  free(formula);
+  psiconv_tree_free(formula);
   
   if (length)
     *length = len;
@@ -666,7 +668,7 @@ ERROR4:
 ERROR3:
   psiconv_free_formula_list(formula_stack);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of formula element list failed");
   if (length)
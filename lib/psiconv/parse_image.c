@@ -21,6 +21,13 @@
 #include "compat.h"
 
 #include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "parse_routines.h"
 #include "error.h"
@@ -30,34 +37,34 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 /* Extreme debugging info */
 #undef LOUD
 
-static int psiconv_decode_rle8 (const psiconv_config config, int lev,
-                         psiconv_u32 off,
-                         const psiconv_pixel_bytes encoded,
-			 psiconv_pixel_bytes *decoded);
-
-static int psiconv_decode_rle12 (const psiconv_config config, int lev,
-                         psiconv_u32 off,
-                         const psiconv_pixel_bytes encoded,
-			 psiconv_pixel_bytes *decoded);
+static int psiconv_pixel_data_size(const psiconv_config config, int lev,
+                                   psiconv_u32 off, psiconv_u32 xsize,
+                                   psiconv_u32 ysize, psiconv_u32 bits,
+                                   psiconv_u32 *size);
 
-static int psiconv_decode_rle16 (const psiconv_config config, int lev,
+static int psiconv_decode_rle (const psiconv_config config, int lev,
                          psiconv_u32 off,
-                         const psiconv_pixel_bytes encoded,
+                         const psiconv_u8 *encoded, psiconv_u32 encoded_len,
+                         int pixel_size, psiconv_u32 size,
 			 psiconv_pixel_bytes *decoded);
 
-static int psiconv_decode_rle24 (const psiconv_config config, int lev,
+static int psiconv_decode_rle12 (const psiconv_config config, int lev,
                          psiconv_u32 off,
-                         const psiconv_pixel_bytes encoded,
+                         const psiconv_u8 *encoded, psiconv_u32 encoded_len,
+                         psiconv_u32 size,
 			 psiconv_pixel_bytes *decoded);
 
 static int psiconv_bytes_to_pixel_data(const psiconv_config config,
                                 int lev, psiconv_u32 off,
 				const psiconv_pixel_bytes bytes,
 				psiconv_pixel_ints *pixels,
-				int colordepth, int xsize, int ysize);
+				int colordepth, psiconv_u32 xsize,
+				psiconv_u32 ysize);
 
 static int psiconv_pixel_data_to_floats (const psiconv_config config, int lev,
                                   psiconv_u32 off, 
@@ -67,6 +74,24 @@ static int psiconv_pixel_data_to_floats (const psiconv_config config, int lev,
 				  int redbits, int bluebits, int greenbits,
 				  const psiconv_pixel_floats_t palet);
 
+static int psiconv_pixel_data_to_rgb8 (const psiconv_config config, int lev,
+                                psiconv_u32 off, 
+                                const psiconv_pixel_ints pixels,
+                                psiconv_u8 **rgb,
+                                int colordepth, int color,
+                                int redbits, int bluebits, int greenbits,
+                                const psiconv_pixel_floats_t palet);
+
+static void psiconv_check_palet(const psiconv_config config, int lev,
+                                psiconv_u32 off,
+                                const psiconv_pixel_ints pixels,
+                                int colordepth,
+                                const psiconv_pixel_floats_t palet);
+static void psiconv_apply_lut_floats(const psiconv_u32 *pixels,
+                                     psiconv_u32 nr,
+                                     const psiconv_pixel_floats_t *lut,
+                                     float *red, float *green, float *blue);
+
 
 
 int psiconv_parse_jumptable_section(const psiconv_config config,
@@ -77,6 +102,7 @@ int psiconv_parse_jumptable_section(const psiconv_config config,
   int res = 0;
   int len = 0;
   psiconv_u32 listlen,temp;
+  psiconv_reader reader;
   int i;
 
   psiconv_progress(config,lev+1,off+len,"Going to read the jumptable section");
@@ -91,11 +117,16 @@ int psiconv_parse_jumptable_section(const psiconv_config config,
   len += 4;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the list");
+  psiconv_reader_init(&reader,buf,off+len);
   for (i = 0; i < listlen; i++) {
-    temp = psiconv_read_u32(config,buf,lev+2,off+len,&res);
-    if (res)
+    temp = psiconv_reader_u32(&reader);
+    if (reader.error) {
+      psiconv_error(config,lev+2,off+len,
+                    "Trying long read past the end of the file");
+      res = reader.error;
       goto ERROR2;
-    if ((res = psiconv_list_add(*result,&temp)))
+    }
+    if ((res = psiconv_list_u32_add(*result,temp)))
       goto ERROR2;
     psiconv_debug(config,lev+3,off+len,"Offset: %08x",temp);
     len += 4;
@@ -128,17 +159,20 @@ int psiconv_parse_paint_data_section(const psiconv_config config,
 {
   int res = 0;
   int len = 0;
-  psiconv_u32 size,offset,temp,datasize,color,
+  psiconv_u32 size,offset,temp,datasize,color,decoded_size,
               redbits,bluebits,greenbits;
-  psiconv_u8 byte;
-  int leng,i;
+  const psiconv_u8 *data;
+  int leng;
+#ifdef LOUD
+  int i;
+#endif
   psiconv_u32 bits_per_pixel,compression;
   psiconv_pixel_bytes bytes,decoded;
   psiconv_pixel_ints pixels;
   psiconv_pixel_floats_t floats,palet;
 
   psiconv_progress(config,lev+1,off,"Going to read a paint data section");
-  if (!((*result) = malloc(sizeof(**result))))
+  if (!((*result) = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   if (!(bytes = psiconv_list_new(sizeof(psiconv_u8))))
@@ -278,44 +312,40 @@ int psiconv_parse_paint_data_section(const psiconv_config config,
 	         "All image types except 2-bit greyscale are experimental!");
 
   psiconv_progress(config,lev+2,off+len,"Going to read the pixel data");
-  for (i = 0; i < datasize; i++) {
-    byte = psiconv_read_u8(config,buf,lev+2,off+len+i,&res);
+  if (!(data = psiconv_buffer_span(buf,off+len,datasize))) {
+    psiconv_error(config,lev+2,off+len,
+                  "Trying pixel data read past the end of the file");
+    res = -PSICONV_E_PARSE;
+    goto ERROR3;
+  }
 #ifdef LOUD
+  for (i = 0; i < datasize; i++)
     psiconv_debug(config,lev+2,off+len+i,
 	          "Pixel byte %04x of %04x has value %02x",
-	          i,datasize,byte);
+	          i,datasize,data[i]);
 #endif
-    if (res)
-      goto ERROR3;
-    psiconv_list_add(bytes,&byte);
-  }
   len += datasize;
 
-  switch(compression) {
-    case 1: 
-      if ((res = psiconv_decode_rle8(config,lev+2,off+len,bytes,&decoded)))
-	goto ERROR3;
-      psiconv_list_free(bytes);
-      bytes = decoded;
-      break;
-    case 2: 
-      if ((psiconv_decode_rle12(config,lev+2,off+len,bytes,&decoded)))
-	goto ERROR3;
-      psiconv_list_free(bytes);
-      bytes = decoded;
-      break;
-    case 3: 
-      if ((psiconv_decode_rle16(config,lev+2,off+len,bytes,&decoded)))
-        goto ERROR3;
-      psiconv_list_free(bytes);
-      bytes = decoded;
-      break;
-    case 4: 
-      if ((psiconv_decode_rle24(config,lev+2,off+len,bytes,&decoded)))
-        goto ERROR3;
-      psiconv_list_free(bytes);
-      bytes = decoded;
-      break;
+  if (!compression) {
+    if ((res = psiconv_list_add_n(bytes,data,datasize)))
+      goto ERROR3;
+  } else {
+    if ((res = psiconv_pixel_data_size(config,lev+2,off+len,
+                                       (*result)->xsize,(*result)->ysize,
+                                   psiconv_pixel_storage_bits(bits_per_pixel),
+                                       &decoded_size)))
+      goto ERROR3;
+    if (compression == 2)
+      res = psiconv_decode_rle12(config,lev+2,off+len,data,datasize,
+                                 decoded_size,&decoded);
+    else
+      res = psiconv_decode_rle(config,lev+2,off+len,data,datasize,
+                               compression == 1?1:compression == 3?2:3,
+                               decoded_size,&decoded);
+    if (res)
+      goto ERROR3;
+    psiconv_list_free(bytes);
+    bytes = decoded;
   }
 
   if ((res = psiconv_bytes_to_pixel_data(config,lev+2,off+len,bytes,
@@ -337,14 +367,23 @@ int psiconv_parse_paint_data_section(const psiconv_config config,
       bluebits = bits_per_pixel - redbits - greenbits;
     }
   }
-  if ((res = psiconv_pixel_data_to_floats(config,lev+2,off+len,pixels,
-	                                  &floats,bits_per_pixel,color,
-					  redbits,greenbits,bluebits,palet)))
-    goto ERROR4;
-  
-  (*result)->red = floats.red;
-  (*result)->green = floats.green;
-  (*result)->blue = floats.blue;
+  (*result)->red = (*result)->green = (*result)->blue = NULL;
+  (*result)->rgb = NULL;
+  if (config->packed_pixels) {
+    if ((res = psiconv_pixel_data_to_rgb8(config,lev+2,off+len,pixels,
+                                          &(*result)->rgb,bits_per_pixel,
+                                          color,redbits,bluebits,greenbits,
+                                          palet)))
+      goto ERROR4;
+  } else {
+    if ((res = psiconv_pixel_data_to_floats(config,lev+2,off+len,pixels,
+                                            &floats,bits_per_pixel,color,
+                                            redbits,bluebits,greenbits,palet)))
+      goto ERROR4;
+    (*result)->red = floats.red;
+    (*result)->green = floats.green;
+    (*result)->blue = floats.blue;
+  }
 
   psiconv_list_free(bytes);
   psiconv_list_free(pixels);
@@ -363,7 +402,7 @@ ERROR4:
 ERROR3:
   psiconv_list_free(bytes);
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Paint Data Section failed");
   if (length)
@@ -385,7 +424,7 @@ int psiconv_parse_sketch_section(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the sketch section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the displayed hor. size");
@@ -528,7 +567,7 @@ int psiconv_parse_sketch_section(const psiconv_config config,
 ERROR3:
   psiconv_free_paint_data_section((*result)->picture);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sketch Section failed");
   if (length)
@@ -551,7 +590,7 @@ int psiconv_parse_clipart_section(const psiconv_config config,
   psiconv_u32 temp;
 
   psiconv_progress(config,lev+1,off+len,"Going to read the clipart section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the section ID");
@@ -631,7 +670,7 @@ int psiconv_parse_clipart_section(const psiconv_config config,
   return 0;
 
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Font failed");
   if (length)
@@ -642,107 +681,176 @@ ERROR1:
     return res;
 }
 
-int psiconv_decode_rle8 (const psiconv_config config, int lev, psiconv_u32 off,
-                         const psiconv_pixel_bytes encoded,
-			 psiconv_pixel_bytes *decoded)
+int psiconv_pixel_data_size(const psiconv_config config, int lev,
+                            psiconv_u32 off, psiconv_u32 xsize,
+                            psiconv_u32 ysize, psiconv_u32 bits,
+                            psiconv_u32 *size)
+{
+  psiconv_u32 line;
+
+  if (bits && (xsize > (0xffffffff - 31) / bits))
+    goto ERROR1;
+  line = (xsize * bits + 31) / 32 * 4;
+  if (ysize && (line > 0xffffffff / ysize))
+    goto ERROR1;
+  *size = line * ysize;
+  return 0;
+
+ERROR1:
+  psiconv_error(config,lev+1,off,"Picture is too large");
+  psiconv_debug(config,lev+1,off,"Size: %d x %d pixels, %d bits per pixel",
+                xsize,ysize,bits);
+  return -PSICONV_E_PARSE;
+}
+
+/* Store count copies of the pixel at dest, which must already hold the
+   first copy. The area copied doubles each time. */
+static void psiconv_fill_pixels(psiconv_u8 *dest, int pixel_size,
+                                psiconv_u32 count)
+{
+  psiconv_u32 done,total;
+
+  if (pixel_size == 1) {
+    memset(dest+1,dest[0],count-1);
+    return;
+  }
+  total = count * pixel_size;
+  for (done = pixel_size; done < total; done *= 2)
+    memcpy(dest+done,dest,done < total-done?done:total-done);
+}
+
+/* RLE8, RLE16 and RLE24 only differ in the size of a pixel. A marker byte
+   below 0x80 is followed by one pixel that is repeated marker+1 times;
+   otherwise 0x100-marker pixels follow literally. Pixels are stored
+   little-endian, just like in the decoded data. */
+int psiconv_decode_rle (const psiconv_config config, int lev, psiconv_u32 off,
+                        const psiconv_u8 *encoded, psiconv_u32 encoded_len,
+                        int pixel_size, psiconv_u32 size,
+			psiconv_pixel_bytes *decoded)
 {
   int res=0;
-  psiconv_u8 *marker,*value;
-  int i,j;
+  const psiconv_u8 *in,*in_end;
+  psiconv_u8 *out,*out_end;
+  psiconv_u32 count;
 
-  psiconv_progress(config,lev+1,off,"Going to decode the RLE8 encoding");
+  psiconv_progress(config,lev+1,off,"Going to decode the RLE%d encoding",
+                   pixel_size * 8);
   if (!(*decoded = psiconv_list_new(sizeof(psiconv_u8))))
     goto ERROR1;
+  out = NULL;
+  if (size && !(out = psiconv_list_append_uninit(*decoded,size)))
+    goto ERROR2;
+  out_end = out + size;
 
-  for (i = 0; i < psiconv_list_length(encoded);) {
-#ifdef LOUD
-    psiconv_progress(config,lev+2,off,"Going to read marker byte at %04x",i);
-#endif
-    if (!(marker = psiconv_list_get(encoded,i)))
-      goto ERROR2;
-#ifdef LOUD
-    psiconv_debug(config,lev+2,off,"Marker byte: %02x",*marker);
-#endif
-    if (*marker < 0x80) {
+  in = encoded;
+  in_end = encoded + encoded_len;
+  while (in < in_end) {
 #ifdef LOUD
-      psiconv_debug(config,lev+2,off,"Marker: repeat value byte %02x times",
-	            *marker+1); */
-      psiconv_progress(config,lev+2,off,"Going to read value byte at %04x",i+1);
+    psiconv_debug(config,lev+2,off,"Marker byte at %04x: %02x",
+                  (int) (in - encoded),*in);
 #endif
-      if (!(value = psiconv_list_get(encoded,i+1)))
-	goto ERROR2;
-#ifdef LOUD
-      psiconv_debug(config,lev+2,off,"Value byte: %02x",*value); 
-      psiconv_progress(config,lev+2,off,"Adding %02x pixels %02x",
-	               *marker+1,*value);
-#endif
-      for (j = 0; j < *marker + 1; j++)
-        if ((res = psiconv_list_add(*decoded,value)))
-	  goto ERROR2;
-      i += 2;
+    if (*in < 0x80) {
+      count = *in + 1;
+      if (in_end - in - 1 < pixel_size)
+        goto TRUNCATED;
+      if (out_end - out < count * pixel_size)
+        goto TOO_LONG;
+      memcpy(out,in+1,pixel_size);
+      psiconv_fill_pixels(out,pixel_size,count);
+      in += 1 + pixel_size;
     } else {
-#ifdef LOUD
-      psiconv_debug(config,lev+2,off,"Marker: %02x value bytes follow",
-	            0x100 - *marker);
-#endif
-      for (j = 0; j < (0x100 - *marker); j++) {
-#ifdef LOUD
-	psiconv_progress(config,lev+2,off,"Going to read value byte at %04x",
-	                 i+j+1);
-#endif
-	if (!(value = psiconv_list_get(encoded,i+j+1)))
-	  goto ERROR2;
-#ifdef LOUD
-	 psiconv_debug(config,lev+2,off,"Value: %02x",*value);
-#endif
-	if ((res = psiconv_list_add(*decoded,value)))
-	  goto ERROR2;
-      }
-      i += (0x100 - *marker) + 1;
+      count = 0x100 - *in;
+      if (in_end - in - 1 < count * pixel_size)
+        goto TRUNCATED;
+      if (out_end - out < count * pixel_size)
+        goto TOO_LONG;
+      memcpy(out,in+1,count * pixel_size);
+      in += 1 + count * pixel_size;
     }
+    out += count * pixel_size;
+  }
+  if (out != out_end) {
+    psiconv_error(config,lev+1,off,"RLE%d data is too short for the picture",
+                  pixel_size * 8);
+    psiconv_debug(config,lev+1,off,"Decoded %d bytes, expected %d",
+                  size - (psiconv_u32) (out_end - out),size);
+    res = -PSICONV_E_PARSE;
+    goto ERROR2;
   }
   psiconv_progress(config,lev,off,
-                   "End of RLE8 decoding process");
+                   "End of RLE%d decoding process",pixel_size * 8);
   return 0;
 
+TOO_LONG:
+  psiconv_error(config,lev+1,off,"RLE%d data is too long for the picture",
+                pixel_size * 8);
+  res = -PSICONV_E_PARSE;
+  goto ERROR2;
+TRUNCATED:
+  psiconv_error(config,lev+1,off,"RLE%d data ends in the middle of a run",
+                pixel_size * 8);
+  res = -PSICONV_E_PARSE;
 ERROR2:
   psiconv_list_free(*decoded);
 ERROR1:
-  psiconv_error(config,lev+1,off,"Decoding of RLE8 failed");
+  psiconv_error(config,lev+1,off,"Decoding of RLE%d failed",pixel_size * 8);
    if (!res)
      return -PSICONV_E_NOMEM;
    else
     return res;
 }	
 
+/* RLE12 consists of little-endian words: the low 12 bits hold the pixel,
+   the high 4 bits the number of repeats minus one. Each pixel is stored
+   as a little-endian 16-bit word. */
 int psiconv_decode_rle12 (const psiconv_config config, int lev, psiconv_u32 off,
-                         const psiconv_pixel_bytes encoded,
-			 psiconv_pixel_bytes *decoded)
+                          const psiconv_u8 *encoded, psiconv_u32 encoded_len,
+                          psiconv_u32 size,
+			  psiconv_pixel_bytes *decoded)
 {
   int res=0;
-  psiconv_u8 *value0,*value1;
-  psiconv_u32 value,repeat;
-  int i,j;
+  const psiconv_u8 *in,*in_end;
+  psiconv_u8 *out,*out_end;
+  psiconv_u32 count;
 
   psiconv_progress(config,lev+1,off,"Going to decode the RLE12 encoding");
   if (!(*decoded = psiconv_list_new(sizeof(psiconv_u8))))
     goto ERROR1;
-
-  for (i = 0; i < psiconv_list_length(encoded);) {
-    psiconv_progress(config,lev+2,off,"Going to read data word at %04x",i);
-    if (!(value0 = psiconv_list_get(encoded,i)))
+  out = NULL;
+  if (size && !(out = psiconv_list_append_uninit(*decoded,size)))
+    goto ERROR2;
+  out_end = out + size;
+
+  in = encoded;
+  in_end = encoded + encoded_len;
+  while (in < in_end) {
+    if (in_end - in < 2) {
+      psiconv_error(config,lev+1,off,"RLE12 data ends in the middle of a word");
+      res = -PSICONV_E_PARSE;
       goto ERROR2;
-    if (!(value1 = psiconv_list_get(encoded,i+1)))
+    }
+#ifdef LOUD
+    psiconv_debug(config,lev+2,off,"Data word at %04x: %04x",
+                  (int) (in - encoded),in[0] + (in[1] << 8));
+#endif
+    count = (in[1] >> 4) + 1;
+    if (out_end - out < count * 2) {
+      psiconv_error(config,lev+1,off,"RLE12 data is too long for the picture");
+      res = -PSICONV_E_PARSE;
       goto ERROR2;
-    psiconv_debug(config,lev+2,off,"Data Word: %04x",*value0 + (*value1 << 8));
-    value = *value0 + ((*value1 & 0x0f) << 8);
-    repeat = (*value1 >> 4) + 1;
-    psiconv_progress(config,lev+2,off,"Adding %02x pixels %03x",
-	             repeat,value);
-    for (j = 0; j < repeat; j ++) 
-      if ((res = psiconv_list_add(*decoded,&value)))
-	goto ERROR2;
-    i += 2;
+    }
+    out[0] = in[0];
+    out[1] = in[1] & 0x0f;
+    psiconv_fill_pixels(out,2,count);
+    out += count * 2;
+    in += 2;
+  }
+  if (out != out_end) {
+    psiconv_error(config,lev+1,off,"RLE12 data is too short for the picture");
+    psiconv_debug(config,lev+1,off,"Decoded %d bytes, expected %d",
+                  size - (psiconv_u32) (out_end - out),size);
+    res = -PSICONV_E_PARSE;
+    goto ERROR2;
   }
   psiconv_progress(config,lev,off,
                    "End of RLE12 decoding process");
@@ -758,202 +866,224 @@ ERROR1:
     return res;
 }
 
-int psiconv_decode_rle16 (const psiconv_config config, int lev, psiconv_u32 off,
-                         const psiconv_pixel_bytes encoded,
-			 psiconv_pixel_bytes *decoded)
+/* Tables to unpack all pixels within a byte at once, for depths below 8 */
+#define PSICONV_UNPACK_1(b) \
+  { (b) & 1, ((b) >> 1) & 1, ((b) >> 2) & 1, ((b) >> 3) & 1, \
+    ((b) >> 4) & 1, ((b) >> 5) & 1, ((b) >> 6) & 1, ((b) >> 7) & 1 }
+#define PSICONV_UNPACK_2(b) \
+  { (b) & 3, ((b) >> 2) & 3, ((b) >> 4) & 3, ((b) >> 6) & 3 }
+#define PSICONV_UNPACK_4(b) \
+  { (b) & 15, ((b) >> 4) & 15 }
+#define PSICONV_UNPACK_TABLE_4(m,b) m(b), m((b)+1), m((b)+2), m((b)+3)
+#define PSICONV_UNPACK_TABLE_16(m,b) \
+  PSICONV_UNPACK_TABLE_4(m,b), PSICONV_UNPACK_TABLE_4(m,(b)+4), \
+  PSICONV_UNPACK_TABLE_4(m,(b)+8), PSICONV_UNPACK_TABLE_4(m,(b)+12)
+#define PSICONV_UNPACK_TABLE_64(m,b) \
+  PSICONV_UNPACK_TABLE_16(m,b), PSICONV_UNPACK_TABLE_16(m,(b)+16), \
+  PSICONV_UNPACK_TABLE_16(m,(b)+32), PSICONV_UNPACK_TABLE_16(m,(b)+48)
+#define PSICONV_UNPACK_TABLE(m) \
+  { PSICONV_UNPACK_TABLE_64(m,0), PSICONV_UNPACK_TABLE_64(m,64), \
+    PSICONV_UNPACK_TABLE_64(m,128), PSICONV_UNPACK_TABLE_64(m,192) }
+
+static const psiconv_u8 psiconv_unpack_table_1[0x100][8] =
+  PSICONV_UNPACK_TABLE(PSICONV_UNPACK_1);
+static const psiconv_u8 psiconv_unpack_table_2[0x100][4] =
+  PSICONV_UNPACK_TABLE(PSICONV_UNPACK_2);
+static const psiconv_u8 psiconv_unpack_table_4[0x100][2] =
+  PSICONV_UNPACK_TABLE(PSICONV_UNPACK_4);
+
+/* Each unpacker converts one line of xsize pixels */
+typedef void psiconv_unpack_line(const psiconv_u8 *data, psiconv_u32 *output,
+                                 psiconv_u32 xsize, int colordepth);
+
+PSICONV_INLINE void psiconv_unpack_with_table(const psiconv_u8 *data,
+                                              psiconv_u32 *output,
+                                              psiconv_u32 xsize,
+                                              const psiconv_u8 *table,
+                                              int colordepth)
 {
-  int res=0;
-  psiconv_u8 *marker,*value0,*value1;
-  psiconv_u32 value;
-  int i,j;
+  const int per_byte = 8 / colordepth;
+  const psiconv_u8 *entry;
+  psiconv_u32 x;
+  int i;
 
-  psiconv_progress(config,lev+1,off,"Going to decode the RLE16 encoding");
-  if (!(*decoded = psiconv_list_new(sizeof(psiconv_u8))))
-    goto ERROR1;
+  for (x = 0; x + per_byte <= xsize; x += per_byte, data++) {
+    entry = table + *data * per_byte;
+    for (i = 0; i < per_byte; i++)
+      output[x+i] = entry[i];
+  }
+  for (i = 0; x < xsize; x++, i++)
+    output[x] = (*data >> (i * colordepth)) & ((1 << colordepth) - 1);
+}
 
-  for (i = 0; i < psiconv_list_length(encoded);) {
-    psiconv_progress(config,lev+2,off,"Going to read marker byte at %04x",i);
-    if (!(marker = psiconv_list_get(encoded,i)))
-      goto ERROR2;
-    psiconv_debug(config,lev+2,off,"Marker byte: %02x",*marker);
-    if (*marker < 0x80) {
-      psiconv_debug(config,lev+2,off,"Marker: repeat value word %02x times",
-	            *marker+1);
-      psiconv_progress(config,lev+2,off,"Going to read value word at %04x",i+1);
-      if (!(value0 = psiconv_list_get(encoded,i+1)))
-	goto ERROR2;
-      if (!(value1 = psiconv_list_get(encoded,i+2)))
-	goto ERROR2;
-      value = *value0 + (*value1 << 8);
-      psiconv_debug(config,lev+2,off,"Value word: %02x",value);
-      psiconv_progress(config,lev+2,off,"Adding %02x pixels %04x",
-	               *marker+1,value);
-      for (j = 0; j < *marker + 1; j++)
-        if ((res = psiconv_list_add(*decoded,&value)))
-	  goto ERROR2;
-      i += 3;
-    } else {
-      psiconv_debug(config,lev+2,off,"Marker: %02x value words follow",
-	            0x100 - *marker);
-      for (j = 0; j < (0x100 - *marker); j++) {
-	psiconv_progress(config,lev+2,off,"Going to read value word at %04x",
-	                 i+j*2+1);
-	if (!(value0 = psiconv_list_get(encoded,i+j*2+1)))
-	  goto ERROR2;
-	if (!(value1 = psiconv_list_get(encoded,i+j*2+2)))
-	  goto ERROR2;
-	value = *value0 + (*value1 << 8);
-	psiconv_debug(config,lev+2,off,"Value: %04x",value);
-	if ((res = psiconv_list_add(*decoded,&value)))
-	  goto ERROR2;
-      }
-      i += (0x100 - *marker)*2 + 1;
-    }
+static void psiconv_unpack_1(const psiconv_u8 *data, psiconv_u32 *output,
+                             psiconv_u32 xsize, int colordepth)
+{
+  psiconv_unpack_with_table(data,output,xsize,psiconv_unpack_table_1[0],1);
+}
+
+static void psiconv_unpack_2(const psiconv_u8 *data, psiconv_u32 *output,
+                             psiconv_u32 xsize, int colordepth)
+{
+  psiconv_unpack_with_table(data,output,xsize,psiconv_unpack_table_2[0],2);
+}
+
+static void psiconv_unpack_4(const psiconv_u8 *data, psiconv_u32 *output,
+                             psiconv_u32 xsize, int colordepth)
+{
+  psiconv_unpack_with_table(data,output,xsize,psiconv_unpack_table_4[0],4);
+}
+
+static void psiconv_unpack_8(const psiconv_u8 *data, psiconv_u32 *output,
+                             psiconv_u32 xsize, int colordepth)
+{
+  psiconv_u32 x = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  __m128i in,low,high;
+
+  for (; x + 16 <= xsize; x += 16) {
+    in = _mm_loadu_si128((const __m128i *) (data + x));
+    low = _mm_unpacklo_epi8(in,zero);
+    high = _mm_unpackhi_epi8(in,zero);
+    _mm_storeu_si128((__m128i *) (output + x),_mm_unpacklo_epi16(low,zero));
+    _mm_storeu_si128((__m128i *) (output + x + 4),
+                     _mm_unpackhi_epi16(low,zero));
+    _mm_storeu_si128((__m128i *) (output + x + 8),
+                     _mm_unpacklo_epi16(high,zero));
+    _mm_storeu_si128((__m128i *) (output + x + 12),
+                     _mm_unpackhi_epi16(high,zero));
   }
-  psiconv_progress(config,lev,off,
-                   "End of RLE16 decoding process");
-  return 0;
+#endif
+  for (; x < xsize; x++)
+    output[x] = data[x];
+}
 
-ERROR2:
-  psiconv_list_free(*decoded);
-ERROR1:
-  psiconv_error(config,lev+1,off,"Decoding of RLE16 failed");
-   if (!res)
-     return -PSICONV_E_NOMEM;
-   else
-    return res;
+/* Used for both 12 and 16 bit pixels */
+static void psiconv_unpack_16(const psiconv_u8 *data, psiconv_u32 *output,
+                              psiconv_u32 xsize, int colordepth)
+{
+  const psiconv_u32 mask = (1 << colordepth) - 1;
+  psiconv_u32 x = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i wide_mask = _mm_set1_epi16((short) mask);
+  __m128i in;
+
+  for (; x + 8 <= xsize; x += 8) {
+    in = _mm_and_si128(_mm_loadu_si128((const __m128i *) (data + 2 * x)),
+                       wide_mask);
+    _mm_storeu_si128((__m128i *) (output + x),_mm_unpacklo_epi16(in,zero));
+    _mm_storeu_si128((__m128i *) (output + x + 4),
+                     _mm_unpackhi_epi16(in,zero));
+  }
+#endif
+  for (; x < xsize; x++)
+    output[x] = (data[2*x] | (data[2*x+1] << 8)) & mask;
 }
 
-int psiconv_decode_rle24 (const psiconv_config config, int lev, psiconv_u32 off,
-                          const psiconv_pixel_bytes encoded,
-			  psiconv_pixel_bytes *decoded)
+static void psiconv_unpack_24(const psiconv_u8 *data, psiconv_u32 *output,
+                              psiconv_u32 xsize, int colordepth)
 {
-  int res=0;
-  psiconv_u8 *marker,*value0,*value1,*value2;
-  psiconv_u32 value;
-  int i,j;
+  psiconv_u32 x;
 
-  psiconv_progress(config,lev+1,off,"Going to decode the RLE24 encoding");
-  if (!(*decoded = psiconv_list_new(sizeof(psiconv_u8))))
-    goto ERROR1;
+  for (x = 0; x < xsize; x++, data += 3)
+    output[x] = data[0] | (data[1] << 8) | ((psiconv_u32) data[2] << 16);
+}
 
-  for (i = 0; i < psiconv_list_length(encoded);) {
-    psiconv_progress(config,lev+2,off,"Going to read marker byte at %04x",i);
-    if (!(marker = psiconv_list_get(encoded,i)))
-      goto ERROR2;
-    psiconv_debug(config,lev+2,off,"Marker byte: %02x",*marker);
-    if (*marker < 0x80) {
-      psiconv_debug(config,lev+2,off,"Marker: repeat value byte triplet %02x times",
-	            *marker+1);
-      psiconv_progress(config,lev+2,off,"Going to read value byte triplet at %04x",i+1);
-      if (!(value0 = psiconv_list_get(encoded,i+1)))
-	goto ERROR2;
-      if (!(value1 = psiconv_list_get(encoded,i+2)))
-	goto ERROR2;
-      if (!(value2 = psiconv_list_get(encoded,i+3)))
-	goto ERROR2;
-      value = *value0 + (*value1 << 8) + (*value2 << 16);
-      psiconv_debug(config,lev+2,off,"Value byte triplet: %06x",value);
-      psiconv_progress(config,lev+2,off,"Adding %02x pixels %06x",
-	               *marker+1,value);
-      for (j = 0; j < *marker + 1; j++)
-        if ((res = psiconv_list_add(*decoded,&value)))
-	  goto ERROR2;
-      i += 4;
-    } else {
-      psiconv_debug(config,lev+2,off,"Marker: %02x value byte triplets follow",
-	            0x100 - *marker);
-      for (j = 0; j < (0x100 - *marker); j++) {
-	psiconv_progress(config,lev+2,off,"Going to read value byte triplets at %04x",
-	                 i+j*3+1);
-	if (!(value0 = psiconv_list_get(encoded,i+j*3+1)))
-	  goto ERROR2;
-	if (!(value1 = psiconv_list_get(encoded,i+j*3+2)))
-	  goto ERROR2;
-	if (!(value2 = psiconv_list_get(encoded,i+j*3+3)))
-	  goto ERROR2;
-	value = *value0 + (*value1 << 8) + (*value2 << 16);
-	psiconv_debug(config,lev+2,off,"Value: %06x",value);
-	if ((res = psiconv_list_add(*decoded,&value)))
-	  goto ERROR2;
+/* Any other depth: take the bits one byte at a time */
+static void psiconv_unpack_bits(const psiconv_u8 *data, psiconv_u32 *output,
+                                psiconv_u32 xsize, int colordepth)
+{
+  psiconv_u32 x,value;
+  psiconv_u8 input = 0;
+  int ibits = 0,obits,bits;
+
+  for (x = 0; x < xsize; x++) {
+    value = 0;
+    for (obits = 0; obits < colordepth; obits += bits) {
+      if (ibits == 0) {
+        input = *data++;
+        ibits = 8;
       }
-      i += (0x100 - *marker)*3 + 1;
+      bits = ibits + obits > colordepth?colordepth-obits:ibits;
+      value |= (psiconv_u32) (input & ((1 << bits) - 1)) << obits;
+      input = input >> bits;
+      ibits -= bits;
     }
+    output[x] = value;
   }
-  psiconv_progress(config,lev,off,
-                   "End of RLE24 decoding process");
-  return 0;
-
-ERROR2:
-  psiconv_list_free(*decoded);
-ERROR1:
-  psiconv_error(config,lev+1,off,"Decoding of RLE24 failed");
-   if (!res)
-     return -PSICONV_E_NOMEM;
-   else
-    return res;
 }
 
 int psiconv_bytes_to_pixel_data(const psiconv_config config,
                                 int lev, psiconv_u32 off,
 				const psiconv_pixel_bytes bytes,
 				psiconv_pixel_ints *pixels,
-				int colordepth, int xsize, int ysize)
+				int colordepth, psiconv_u32 xsize,
+				psiconv_u32 ysize)
 {
   int res=0;
-  int ibits,obits,x,y,bits;
-  psiconv_u8 input;
-  psiconv_u32 nr,output;
-  psiconv_u8 *ientry;
+  psiconv_u32 y,line_size,needed;
+  const psiconv_u8 *data;
+  psiconv_u32 *output;
+  psiconv_unpack_line *unpack;
 
   psiconv_progress(config,lev+1,off,"Going to convert the bytes to pixels");
   if (!(*pixels = psiconv_list_new(sizeof(psiconv_u32))))
     goto ERROR1;
 
-  nr = 0;
-  for (y = 0; y < ysize; y++) {
-    /* New lines will start at longs */
-    while (nr % 4)
-      nr ++;
-    input = 0;
-    ibits = 0;
-    for (x= 0; x < xsize; x++) {
-#ifdef LOUD
-      psiconv_progress(config,lev+2,off,
-	               "Processing pixel at (x,y) = (%04x,%04x)",x,y);
-#endif
-      output = 0;
-      obits = 0;
-      while (obits < colordepth) {
-	if (ibits == 0) {
-#ifdef LOUD
-	  psiconv_progress(config,lev+3,off,
-	                   "Going to read byte %08x",nr);
-#endif
-	  if (!(ientry = psiconv_list_get(bytes,nr)))
-	    goto ERROR2;
-#ifdef LOUD
-	  psiconv_debug(config,lev+3,off,"Byte value: %02x",*ientry);
-#endif
-	  input = *ientry;
-	  ibits = 8;
-	  nr ++;
-	}
-	bits = ibits + obits > colordepth?colordepth-obits:ibits;
-	output = output << bits;
-        output |= input & ((1 << bits) - 1);
-	input = input >> bits;
-	ibits -= bits;
-  	obits += bits;
-      }
-#ifdef LOUD
-      psiconv_debug(config,lev+2,off,"Pixel value: %08x",output);
-#endif
-      if ((res = psiconv_list_add(*pixels,&output)))
-	goto ERROR2;
-    }
+  if ((colordepth < 1) || (colordepth > 32)) {
+    psiconv_error(config,lev+1,off,"Unsupported number of bits per pixel");
+    psiconv_debug(config,lev+1,off,"Bits per pixel: %d",colordepth);
+    res = -PSICONV_E_PARSE;
+    goto ERROR2;
+  }
+  if ((res = psiconv_pixel_data_size(config,lev+1,off,xsize,ysize,
+                                     psiconv_pixel_storage_bits(colordepth),
+                                     &needed)))
+    goto ERROR2;
+  if (ysize && (xsize > 0xffffffff / ysize)) {
+    psiconv_error(config,lev+1,off,"Picture is too large");
+    res = -PSICONV_E_PARSE;
+    goto ERROR2;
+  }
+
+  /* The padding at the end of the last line may be missing */
+  line_size = 0;
+  if (xsize && ysize) {
+    line_size = needed / ysize;
+    needed -= line_size -
+              (xsize * psiconv_pixel_storage_bits(colordepth) + 7) / 8;
+  } else
+    needed = 0;
+  if (psiconv_list_length(bytes) < needed) {
+    psiconv_error(config,lev+1,off,"Not enough pixel data for the picture");
+    psiconv_debug(config,lev+1,off,"Found %d bytes, expected %d",
+                  psiconv_list_length(bytes),needed);
+    res = -PSICONV_E_PARSE;
+    goto ERROR2;
+  }
+  if (!needed)
+    goto DONE;
+  if (!(output = psiconv_list_append_uninit(*pixels,xsize * ysize)))
+    goto ERROR2;
+
+  switch (colordepth) {
+    case 1: unpack = psiconv_unpack_1; break;
+    case 2: unpack = psiconv_unpack_2; break;
+    case 4: unpack = psiconv_unpack_4; break;
+    case 8: unpack = psiconv_unpack_8; break;
+    case 12:
+    case 16: unpack = psiconv_unpack_16; break;
+    case 24: unpack = psiconv_unpack_24; break;
+    default: unpack = psiconv_unpack_bits; break;
   }
 
+  data = psiconv_list_u8_data(bytes);
+  for (y = 0; y < ysize; y++, data += line_size, output += xsize)
+    unpack(data,output,xsize,colordepth);
+
+DONE:
   psiconv_progress(config,lev,off,
                    "Converting bytes to pixels completed");
   return 0;
@@ -969,6 +1099,55 @@ ERROR1:
     return res;
 }
 
+/* Warn about the pixels that are not in the palet. The lookup tables
+   quietly give them color 0 of the palet. */
+void psiconv_check_palet(const psiconv_config config, int lev,
+                         psiconv_u32 off, const psiconv_pixel_ints pixels,
+                         int colordepth, const psiconv_pixel_floats_t palet)
+{
+  psiconv_u32 i,nr;
+  const psiconv_u32 *pixel;
+  psiconv_repeat invalid_color = PSICONV_REPEAT_INIT(PSICONV_REPEAT_PIXEL);
+
+  if (!palet.length || (colordepth < 32 && palet.length >> colordepth))
+    return;
+  nr = psiconv_list_length(pixels);
+  pixel = psiconv_list_u32_data(pixels);
+  for (i = 0; i < nr; i++)
+    if (pixel[i] >= palet.length)
+      psiconv_warn_repeated(config,&invalid_color,lev,off,
+                            "Invalid palet color found (using color 0x00)");
+  psiconv_repeat_summary(config,&invalid_color);
+}
+
+/* Look up the colors of nr pixels. All pixel values must be in the table. */
+void psiconv_apply_lut_floats(const psiconv_u32 *pixels, psiconv_u32 nr,
+                              const psiconv_pixel_floats_t *lut,
+                              float *red, float *green, float *blue)
+{
+  psiconv_u32 i = 0;
+#ifdef __AVX2__
+  __m256i index;
+
+  for (; i + 8 <= nr; i += 8) {
+    index = _mm256_loadu_si256((const __m256i *) (pixels + i));
+    _mm256_storeu_ps(red + i,_mm256_i32gather_ps(lut->red,index,4));
+    _mm256_storeu_ps(green + i,_mm256_i32gather_ps(lut->green,index,4));
+    _mm256_storeu_ps(blue + i,_mm256_i32gather_ps(lut->blue,index,4));
+  }
+#endif
+  for (; i < nr; i++) {
+    red[i] = lut->red[pixels[i]];
+    green[i] = lut->green[pixels[i]];
+    blue[i] = lut->blue[pixels[i]];
+  }
+}
+
+/* Use a lookup table only if it is not much larger than the picture itself */
+#define PSICONV_USE_PIXEL_LUT(colordepth,nr) \
+  (((colordepth) <= PSICONV_PIXEL_LUT_MAX_DEPTH) && \
+   (((psiconv_u32) 1 << (colordepth)) <= (nr)))
+
 int psiconv_pixel_data_to_floats (const psiconv_config config, int lev,
                                   psiconv_u32 off, 
 			 	  const psiconv_pixel_ints pixels,
@@ -980,65 +1159,57 @@ int psiconv_pixel_data_to_floats (const psiconv_config config, int lev,
   int res = 0;
   psiconv_u32 i;
   psiconv_u32 *pixel;
+  psiconv_pixel_floats_t lut;
+  psiconv_repeat invalid_color = PSICONV_REPEAT_INIT(PSICONV_REPEAT_PIXEL);
 
   psiconv_progress(config,lev+1,off,"Going to convert pixels to floats");
-  if (!((*floats).red = malloc(psiconv_list_length(pixels) * 
+  if (!((*floats).red = psiconv_tree_malloc(psiconv_list_length(pixels) * 
 	                    sizeof(*(*floats).red))))
     goto ERROR1;
-  if (!((*floats).green = malloc(psiconv_list_length(pixels) *
+  if (!((*floats).green = psiconv_tree_malloc(psiconv_list_length(pixels) *
 	                      sizeof(*(*floats).green))))
     goto ERROR2;
-  if (!((*floats).blue = malloc(psiconv_list_length(pixels) *
+  if (!((*floats).blue = psiconv_tree_malloc(psiconv_list_length(pixels) *
 	                     sizeof(*(*floats).blue))))
     goto ERROR3;
   (*floats).length = psiconv_list_length(pixels);
 
-  for (i = 0; i < psiconv_list_length(pixels); i++) {
-    if (!(pixel = psiconv_list_get(pixels,i)))
+  pixel = psiconv_list_u32_data(pixels);
+  if (PSICONV_USE_PIXEL_LUT(colordepth,(*floats).length)) {
+    if ((res = psiconv_pixel_lut_new(&lut,colordepth,color,
+                                     redbits,bluebits,greenbits,palet)))
       goto ERROR4;
+    psiconv_check_palet(config,lev+2,off,pixels,colordepth,palet);
+    psiconv_apply_lut_floats(pixel,(*floats).length,&lut,(*floats).red,
+                             (*floats).green,(*floats).blue);
+    psiconv_pixel_lut_free(lut);
+  } else {
+    for (i = 0; i < psiconv_list_length(pixels); i++, pixel++) {
 #ifdef LOUD
-    psiconv_progress(config,lev+2,off, "Handling pixel %04x (%04x)",i,*pixel);
+      psiconv_progress(config,lev+2,off, "Handling pixel %04x (%04x)",i,*pixel);
 #endif
-    if (!palet.length) {
-      if (color) {
-	(*floats).blue[i] = ((float) (*pixel & ((1 << bluebits) - 1))) / 
-	             ((1 << bluebits) - 1);
-	(*floats).green[i] = ((float) ((*pixel >> bluebits) & 
-   		            ((1 << greenbits) - 1))) / ((1 << greenbits) - 1);
-	(*floats).red[i] = ((float) ((*pixel >> (bluebits+greenbits)) & 
-                            ((1 << redbits) - 1))) / ((1 << redbits) - 1);
-      } else {
-        (*floats).red[i] = (*floats).green[i] = 
-	                (*floats).blue[i] = ((float) *pixel) / 
-			                     ((1 << colordepth) - 1);
-      }
-    } else {
-      if (*pixel >= palet.length) {
-	psiconv_warn(config,lev+2,off,
-	             "Invalid palet color found (using color 0x00)");
-	(*floats).red[i] = palet.red[0];
-	(*floats).green[i] = palet.green[0];
-	(*floats).blue[i] = palet.blue[0];
-      } else {
-	(*floats).red[i] = palet.red[*pixel];
-	(*floats).green[i] = palet.green[*pixel];
-	(*floats).blue[i] = palet.blue[*pixel];
-      }
-    }
+      if (!psiconv_pixel_to_floats(*pixel,colordepth,color,
+                                   redbits,bluebits,greenbits,&palet,
+                                   &(*floats).red[i],&(*floats).green[i],
+                                   &(*floats).blue[i]))
+        psiconv_warn_repeated(config,&invalid_color,lev+2,off,
+                              "Invalid palet color found (using color 0x00)");
 #ifdef LOUD
-    psiconv_debug(config,lev+2,off, "Pixel: Red (%f), green (%f), blue (%f)",
-	          (*floats).red[i],(*floats).green[i],(*floats).blue[i]);
+      psiconv_debug(config,lev+2,off, "Pixel: Red (%f), green (%f), blue (%f)",
+	            (*floats).red[i],(*floats).green[i],(*floats).blue[i]);
 #endif
+    }
+    psiconv_repeat_summary(config,&invalid_color);
   }
   psiconv_progress(config,lev+1,off,"Finished converting pixels to floats");
   return 0;
 
 ERROR4:
-  free((*floats).blue);
+  psiconv_tree_free((*floats).blue);
 ERROR3:
-  free((*floats).green);
+  psiconv_tree_free((*floats).green);
 ERROR2:
-  free((*floats).red);
+  psiconv_tree_free((*floats).red);
 ERROR1:
   psiconv_error(config,lev+1,off,"Converting pixels to floats failed");
   if (!res)
@@ -1047,5 +1218,76 @@ ERROR1:
     return res;
 }
 
+int psiconv_pixel_data_to_rgb8 (const psiconv_config config, int lev,
+                                psiconv_u32 off, 
+                                const psiconv_pixel_ints pixels,
+                                psiconv_u8 **rgb,
+                                int colordepth, int color,
+                                int redbits, int bluebits, int greenbits,
+                                const psiconv_pixel_floats_t palet)
+{
+  int res = 0;
+  psiconv_u32 i,nr;
+  psiconv_u32 *pixel;
+  psiconv_u8 *out,*table = NULL;
+  const psiconv_u8 *entry;
+  float red,green,blue;
+  psiconv_pixel_floats_t lut;
+  psiconv_repeat invalid_color = PSICONV_REPEAT_INIT(PSICONV_REPEAT_PIXEL);
+
+  psiconv_progress(config,lev+1,off,"Going to convert pixels to packed RGB");
+  nr = psiconv_list_length(pixels);
+  if (!(*rgb = psiconv_tree_malloc(nr * 3 + 1)))
+    goto ERROR1;
 
+  pixel = psiconv_list_u32_data(pixels);
+  out = *rgb;
+  if (PSICONV_USE_PIXEL_LUT(colordepth,nr)) {
+    if ((res = psiconv_pixel_lut_new(&lut,colordepth,color,
+                                     redbits,bluebits,greenbits,palet)))
+      goto ERROR2;
+    if (!(table = malloc(lut.length * 3)))
+      goto ERROR3;
+    for (i = 0; i < lut.length; i++) {
+      table[3*i] = lut.red[i] * 255 + 0.5;
+      table[3*i+1] = lut.green[i] * 255 + 0.5;
+      table[3*i+2] = lut.blue[i] * 255 + 0.5;
+    }
+    psiconv_pixel_lut_free(lut);
+    psiconv_check_palet(config,lev+2,off,pixels,colordepth,palet);
+    for (i = 0; i < nr; i++, out += 3) {
+      entry = table + 3 * pixel[i];
+      out[0] = entry[0];
+      out[1] = entry[1];
+      out[2] = entry[2];
+    }
+    free(table);
+  } else {
+    for (i = 0; i < nr; i++, pixel++, out += 3) {
+      if (!psiconv_pixel_to_floats(*pixel,colordepth,color,
+                                   redbits,bluebits,greenbits,&palet,
+                                   &red,&green,&blue))
+        psiconv_warn_repeated(config,&invalid_color,lev+2,off,
+                              "Invalid palet color found (using color 0x00)");
+      out[0] = red * 255 + 0.5;
+      out[1] = green * 255 + 0.5;
+      out[2] = blue * 255 + 0.5;
+    }
+    psiconv_repeat_summary(config,&invalid_color);
+  }
+  psiconv_progress(config,lev+1,off,
+                   "Finished converting pixels to packed RGB");
+  return 0;
 
+ERROR3:
+  psiconv_pixel_lut_free(lut);
+ERROR2:
+  psiconv_tree_free(*rgb);
+  *rgb = NULL;
+ERROR1:
+  psiconv_error(config,lev+1,off,"Converting pixels to packed RGB failed");
+  if (!res)
+    return -PSICONV_E_NOMEM;
+  else
+    return res;
+}
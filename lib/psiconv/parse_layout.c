@@ -30,6 +30,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 
 int psiconv_parse_color(const psiconv_config config,
                         const psiconv_buffer buf, int lev, psiconv_u32 off, 
@@ -39,7 +41,7 @@ int psiconv_parse_color(const psiconv_config config,
   int len = 0;
 
   psiconv_progress(config,lev+1,off,"Going to parse color");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   (*result)->red = psiconv_read_u8(config,buf,lev+2,off+len,&res);
@@ -62,7 +64,7 @@ int psiconv_parse_color(const psiconv_config config,
   return 0;
 
 ERROR2:
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Color failed");
   if (length)
@@ -85,7 +87,7 @@ int psiconv_parse_font(const psiconv_config config,
   int fontlen;
 
   psiconv_progress(config,lev+1,off,"Going to parse font");
-  if (!(*result = malloc(sizeof(**result)))) 
+  if (!(*result = psiconv_tree_malloc(sizeof(**result)))) 
     goto ERROR1;
 
   fontlen = psiconv_read_u8(config,buf,lev+2,off,&res);
@@ -102,13 +104,14 @@ int psiconv_parse_font(const psiconv_config config,
   if (res)
     goto ERROR3;
 
-  if (!(str_copy = psiconv_make_printable(config,(*result)->name)))
-    goto ERROR3;
-
-  psiconv_debug(config,lev+2,off+len,
-                "Found font `%s', displayed with screen font %02x",
-                    str_copy,(*result)->screenfont);
-  free(str_copy);
+  if (psiconv_verbose(config,PSICONV_VERB_DEBUG)) {
+    if (!(str_copy = psiconv_make_printable(config,(*result)->name)))
+      goto ERROR3;
+    psiconv_debug(config,lev+2,off+len,
+                  "Found font `%s', displayed with screen font %02x",
+                      str_copy,(*result)->screenfont);
+    free(str_copy);
+  }
   len ++;
 
   if (length)
@@ -119,9 +122,9 @@ int psiconv_parse_font(const psiconv_config config,
   return 0;
 
 ERROR3:
-  free ((*result)->name);
+  psiconv_tree_free((*result)->name);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Font failed");
   if (length)
@@ -142,7 +145,7 @@ int psiconv_parse_border(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to parse border data");
-  if (!(*result = malloc(sizeof(**result)))) {
+  if (!(*result = psiconv_tree_malloc(sizeof(**result)))) {
     goto ERROR1;
   }
 
@@ -216,7 +219,7 @@ int psiconv_parse_border(const psiconv_config config,
 ERROR3:
   psiconv_free_color((*result)->color);
 ERROR2:
-  free (result);
+  psiconv_tree_free(result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Border failed");
   if (length)
@@ -236,7 +239,7 @@ int psiconv_parse_bullet(const psiconv_config config,
   int leng;
   int bullet_length;
 
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
   (*result)->on = psiconv_bool_true;
 
@@ -294,7 +297,7 @@ int psiconv_parse_bullet(const psiconv_config config,
 ERROR3:
   psiconv_free_color((*result)->color);
 ERROR2:
-  free (result);
+  psiconv_tree_free(result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Bullet failed");
   if (length)
@@ -315,7 +318,7 @@ int psiconv_parse_tab(const psiconv_config config,
   psiconv_u8 temp;
 
   psiconv_progress(config,lev+1,off,"Going to parse tab");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off,"Going to read tab location");
@@ -350,7 +353,7 @@ int psiconv_parse_tab(const psiconv_config config,
   return 0;
   
 ERROR2:
-  free (result);
+  psiconv_tree_free(result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Tab failed");
   if (length)
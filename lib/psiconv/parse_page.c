@@ -30,6 +30,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 
 int psiconv_parse_page_header(const psiconv_config config,
                               const psiconv_buffer buf,int lev,psiconv_u32 off,
@@ -41,7 +43,7 @@ int psiconv_parse_page_header(const psiconv_config config,
   psiconv_u32 temp;
 
   psiconv_progress(config,lev+1,off,"Going to read a page header (or footer)");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -128,7 +130,7 @@ ERROR4:
 ERROR3:
   psiconv_free_paragraph_layout((*result)->base_paragraph_layout);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Page Header failed");
   if (length)
@@ -150,7 +152,7 @@ int psiconv_parse_page_layout_section(const psiconv_config config,
   psiconv_u32 temp;
 
   psiconv_progress(config,lev+1,off,"Going to read the page layout section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read first page number");
@@ -263,7 +265,7 @@ ERROR4:
 ERROR3:
   psiconv_free_page_header((*result)->header);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Page Section failed");
   if (length)
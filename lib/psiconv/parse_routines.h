@@ -26,6 +26,7 @@
 #include <psiconv/buffer.h>
 #include <psiconv/common.h>
 #include <psiconv/parse.h>
+#include <psiconv/error.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +37,101 @@ extern "C" {
    * parse_simple.c *
    ****************** */
 
+/* A psiconv_reader reads consecutive fields from a buffer, with only one
+   bounds check for each field. Reading past the end, or an invalid S or X
+   encoding, sets error to -PSICONV_E_PARSE; the read returns 0, and so do
+   all reads after it, so it is enough to check error after a group of
+   reads. ptr is then left at the field that could not be read.
+   The buffer may not be changed while the reader is in use. */
+typedef struct psiconv_reader_s {
+  const psiconv_u8 *ptr;   /* The next byte to read */
+  const psiconv_u8 *end;
+  const psiconv_u8 *start;
+  psiconv_u32 off;         /* The buffer offset of start */
+  int error;
+} psiconv_reader;
+
+/* Start reading buf at offset off */
+extern void psiconv_reader_init(psiconv_reader *reader,
+                                const psiconv_buffer buf, psiconv_u32 off);
+
+/* The buffer offset of the next byte to read */
+PSICONV_INLINE psiconv_u32 psiconv_reader_offset(const psiconv_reader *reader)
+{
+  return reader->off + (reader->ptr - reader->start);
+}
+
+PSICONV_INLINE psiconv_u32 psiconv_reader_fail(psiconv_reader *reader)
+{
+  reader->end = reader->ptr;
+  reader->error = -PSICONV_E_PARSE;
+  return 0;
+}
+
+PSICONV_INLINE psiconv_u8 psiconv_reader_u8(psiconv_reader *reader)
+{
+  if (reader->ptr == reader->end)
+    return psiconv_reader_fail(reader);
+  return *reader->ptr++;
+}
+
+PSICONV_INLINE psiconv_u16 psiconv_reader_u16(psiconv_reader *reader)
+{
+  const psiconv_u8 *p = reader->ptr;
+  if (reader->end - p < 2)
+    return psiconv_reader_fail(reader);
+  reader->ptr = p + 2;
+  return p[0] | (p[1] << 8);
+}
+
+PSICONV_INLINE psiconv_u32 psiconv_reader_u32(psiconv_reader *reader)
+{
+  const psiconv_u8 *p = reader->ptr;
+  if (reader->end - p < 4)
+    return psiconv_reader_fail(reader);
+  reader->ptr = p + 4;
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((psiconv_u32) p[3] << 24);
+}
+
+/* S and X are the variable-length encodings of psiconv_read_S and
+   psiconv_read_X */
+PSICONV_INLINE psiconv_u32 psiconv_reader_S(psiconv_reader *reader)
+{
+  const psiconv_u8 *p = reader->ptr;
+  if (p == reader->end)
+    return psiconv_reader_fail(reader);
+  if ((p[0] & 0x03) == 0x02) {
+    reader->ptr = p + 1;
+    return p[0] >> 2;
+  }
+  if (((p[0] & 0x07) == 0x05) && (reader->end - p >= 2)) {
+    reader->ptr = p + 2;
+    return (p[0] | (p[1] << 8)) >> 3;
+  }
+  return psiconv_reader_fail(reader);
+}
+
+PSICONV_INLINE psiconv_u32 psiconv_reader_X(psiconv_reader *reader)
+{
+  const psiconv_u8 *p = reader->ptr;
+  if (p == reader->end)
+    return psiconv_reader_fail(reader);
+  if ((p[0] & 0x01) == 0x00) {
+    reader->ptr = p + 1;
+    return p[0] >> 1;
+  }
+  if (((p[0] & 0x03) == 0x01) && (reader->end - p >= 2)) {
+    reader->ptr = p + 2;
+    return (p[0] | (p[1] << 8)) >> 2;
+  }
+  if (((p[0] & 0x07) == 0x03) && (reader->end - p >= 4)) {
+    reader->ptr = p + 4;
+    return (p[0] | (p[1] << 8) | (p[2] << 16) | ((psiconv_u32) p[3] << 24))
+           >> 3;
+  }
+  return psiconv_reader_fail(reader);
+}
+
 extern psiconv_u8 psiconv_read_u8(const psiconv_config config,
                                   const psiconv_buffer buf,int lev,
                                   psiconv_u32 off, int *status);
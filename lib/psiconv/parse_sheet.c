@@ -29,16 +29,18 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 static psiconv_sheet_cell_layout psiconv_basic_cell_layout(void)
 {
   psiconv_sheet_cell_layout result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->character = psiconv_basic_character_layout()))
     goto ERROR2;
   if (!(result->paragraph = psiconv_basic_paragraph_layout()))
     goto ERROR3;
-  if (!(result->numberformat = malloc(sizeof(*result->numberformat))))
+  if (!(result->numberformat = psiconv_tree_malloc(sizeof(*result->numberformat))))
     goto ERROR4;
   result->numberformat->code = psiconv_numberformat_general;
   result->numberformat->decimal = 2;
@@ -48,7 +50,7 @@ ERROR4:
 ERROR3:
   psiconv_free_character_layout(result->character);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -57,7 +59,7 @@ static psiconv_sheet_cell_layout psiconv_clone_cell_layout
                                     (psiconv_sheet_cell_layout original)
 {
   psiconv_sheet_cell_layout result;
-  if (!(result = malloc(sizeof(*result))))
+  if (!(result = psiconv_tree_malloc(sizeof(*result))))
     goto ERROR1;
   if (!(result->character = 
         psiconv_clone_character_layout(original->character)))
@@ -65,7 +67,7 @@ static psiconv_sheet_cell_layout psiconv_clone_cell_layout
   if (!(result->paragraph = 
         psiconv_clone_paragraph_layout(original->paragraph)))
     goto ERROR3;
-  if (!(result->numberformat = malloc(sizeof(*result->numberformat))))
+  if (!(result->numberformat = psiconv_tree_malloc(sizeof(*result->numberformat))))
     goto ERROR4;
   result->numberformat->code = original->numberformat->code;
   result->numberformat->decimal = original->numberformat->decimal;
@@ -75,7 +77,7 @@ ERROR4:
 ERROR3:
   psiconv_free_character_layout(result->character);
 ERROR2:
-  free(result);
+  psiconv_tree_free(result);
 ERROR1:
   return NULL;
 }
@@ -356,7 +358,7 @@ int psiconv_parse_sheet_status_section(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet status section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -492,7 +494,7 @@ int psiconv_parse_sheet_status_section(const psiconv_config config,
   return 0;
 
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Status Section failed");
   if (length)
@@ -513,7 +515,7 @@ int psiconv_parse_sheet_workbook_section(const psiconv_config config,
   int len=0;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet workbook section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -617,7 +619,7 @@ ERROR4:
 ERROR3:
   psiconv_free_sheet_info_section((*result)->info);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Workbook Section failed");
   if (length)
@@ -638,7 +640,7 @@ int psiconv_parse_sheet_name_section(const psiconv_config config,
   int len=0,leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet name section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -667,7 +669,7 @@ int psiconv_parse_sheet_name_section(const psiconv_config config,
   return 0;
 
 ERROR2:  
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Name Section failed");
   if (length)
@@ -688,7 +690,7 @@ int psiconv_parse_sheet_info_section(const psiconv_config config,
   int len=0,leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet info section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -734,7 +736,7 @@ int psiconv_parse_sheet_info_section(const psiconv_config config,
   return 0;
 
 ERROR2:  
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Name Section failed");
   if (length)
@@ -758,7 +760,7 @@ int psiconv_parse_sheet_formula_list(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet formula list");
-  if (!(*result = psiconv_list_new(sizeof(struct psiconv_formula_s))))
+  if (!(*result = psiconv_tree_list_new(sizeof(struct psiconv_formula_s))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -788,7 +790,7 @@ int psiconv_parse_sheet_formula_list(const psiconv_config config,
       goto ERROR2;
     if ((res = psiconv_list_add(*result,formula)))
       goto ERROR3;
-    free(formula);
+    psiconv_tree_free(formula);
     len += leng;
   }
 
@@ -813,54 +815,77 @@ ERROR1:
     return res;
 }
 
-int psiconv_parse_sheet_cell(const psiconv_config config,
+/* Warnings that may be given for every cell in a cell list */
+typedef struct psiconv_sheet_cell_repeats_s {
+  psiconv_repeat flags;
+  psiconv_repeat error_code;
+} psiconv_sheet_cell_repeats;
+
+#define PSICONV_SHEET_CELL_REPEATS_INIT \
+    { PSICONV_REPEAT_INIT(PSICONV_REPEAT_CELL), \
+      PSICONV_REPEAT_INIT(PSICONV_REPEAT_CELL) }
+
+static void psiconv_sheet_cell_repeats_summary
+                           (const psiconv_config config,
+                            psiconv_sheet_cell_repeats *repeats)
+{
+  psiconv_repeat_summary(config,&repeats->flags);
+  psiconv_repeat_summary(config,&repeats->error_code);
+}
+
+static int psiconv_parse_sheet_cell_repeated(const psiconv_config config,
                              const psiconv_buffer buf, int lev,
                              psiconv_u32 off, int *length,
                              psiconv_sheet_cell *result,
                              const psiconv_sheet_cell_layout default_layout,
                              const psiconv_sheet_line_list row_default_layouts,
-                             const psiconv_sheet_line_list col_default_layouts)
+                             const psiconv_sheet_line_list col_default_layouts,
+                             psiconv_sheet_cell_repeats *repeats)
 {
   int res=0;
   int len=0;
   psiconv_u32 temp;
+  psiconv_reader reader;
   psiconv_bool_t has_layout;
   int leng;
   char *auxstr;
 
   psiconv_progress(config,lev+1,off,"Going to read a sheet cell structure");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   (*result)->layout = NULL;
   (*result)->type = psiconv_cell_blank;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the cell position");
-  temp = psiconv_read_u8(config,buf,lev+2,off+len,&res);
-  if (res)
+  psiconv_reader_init(&reader,buf,off+len);
+  temp = psiconv_reader_u16(&reader);
+  temp += psiconv_reader_u8(&reader) << 16;
+  if (reader.error) {
+    psiconv_error(config,lev+2,psiconv_reader_offset(&reader),
+                  "Trying byte read past the end of the file");
+    res = reader.error;
     goto ERROR2;
-  len ++;
-  temp += psiconv_read_u8(config,buf,lev+2,off+len,&res) << 8;
-  if (res)
-    goto ERROR2;
-  len ++;
-  temp += psiconv_read_u8(config,buf,lev+2,off+len,&res) << 16;
-  if (res)
-    goto ERROR2;
-  len ++;
+  }
+  len += 3;
   (*result)->column = (temp >> 2) & 0xFF;
   (*result)->row = (temp >> 10) & 0x3FFF;
   psiconv_debug(config,lev+2,off+len,"Cell position is col:%02x row:%04x",
                                       (*result)->column,(*result)->row);
   if (temp & 0x03) {
-    psiconv_warn(config,lev+2,off+len,"Unknown flags in cell position (ignored)");
+    psiconv_warn_repeated(config,&repeats->flags,lev+2,off+len,
+                          "Unknown flags in cell position (ignored)");
     psiconv_debug(config,lev+2,off+len,"Flags: %02x",temp & 0x03);
   }
 
   psiconv_progress(config,lev+2,off+len,"Going to read the cell type");
-  temp = psiconv_read_u8(config,buf,lev+2,off+len,&res);
-  if (res)
+  temp = psiconv_reader_u8(&reader);
+  if (reader.error) {
+    psiconv_error(config,lev+2,off+len,
+                  "Trying byte read past the end of the file");
+    res = reader.error;
     goto ERROR2;
+  }
   len ++;
   (*result)->type = (temp >> 5) & 0x07;
   (*result)->calculated = (temp & 0x08)?psiconv_bool_true:psiconv_bool_false;
@@ -907,7 +932,8 @@ int psiconv_parse_sheet_cell(const psiconv_config config,
     else if (temp == 7)
       (*result)->data.dat_error = psiconv_sheet_error_notavail;
     else {
-      psiconv_warn(config,lev+2,off+len,"Unknown error code (default assumed)");
+      psiconv_warn_repeated(config,&repeats->error_code,lev+2,off+len,
+                            "Unknown error code (default assumed)");
       psiconv_debug(config,lev+2,off+len,"Error code: %04x",temp);
       (*result)->data.dat_error = psiconv_sheet_error_none;
     }
@@ -928,10 +954,13 @@ int psiconv_parse_sheet_cell(const psiconv_config config,
                    psiconv_read_string(config,buf,lev+2,off+len,&leng,&res);
     if (res)
       goto ERROR2;
-    if (!(auxstr = psiconv_make_printable(config,(*result)->data.dat_string)))
-      goto ERROR2;
-    psiconv_debug(config,lev+2,off+len,"Cell contents: `%s'",auxstr);
-    free(auxstr);
+    if (psiconv_verbose(config,PSICONV_VERB_DEBUG)) {
+      if (!(auxstr = psiconv_make_printable(config,
+                                            (*result)->data.dat_string)))
+        goto ERROR2;
+      psiconv_debug(config,lev+2,off+len,"Cell contents: `%s'",auxstr);
+      free(auxstr);
+    }
     len += leng;
   } else {
     psiconv_error(config,lev+2,off+len,"Unknown Sheet Cell type: %02x",(*result)->type);
@@ -982,6 +1011,24 @@ ERROR1:
     return res;
 }
 
+int psiconv_parse_sheet_cell(const psiconv_config config,
+                             const psiconv_buffer buf, int lev,
+                             psiconv_u32 off, int *length,
+                             psiconv_sheet_cell *result,
+                             const psiconv_sheet_cell_layout default_layout,
+                             const psiconv_sheet_line_list row_default_layouts,
+                             const psiconv_sheet_line_list col_default_layouts)
+{
+  psiconv_sheet_cell_repeats repeats = PSICONV_SHEET_CELL_REPEATS_INIT;
+  int res;
+
+  res = psiconv_parse_sheet_cell_repeated(config,buf,lev,off,length,result,
+                                          default_layout,row_default_layouts,
+                                          col_default_layouts,&repeats);
+  psiconv_sheet_cell_repeats_summary(config,&repeats);
+  return res;
+}
+
 int psiconv_parse_sheet_cell_list(const psiconv_config config,
                               const psiconv_buffer buf, int lev,
                               psiconv_u32 off, int *length,
@@ -996,9 +1043,10 @@ int psiconv_parse_sheet_cell_list(const psiconv_config config,
   psiconv_sheet_cell cell;
   psiconv_u32 listlen,i;
   int leng;
+  psiconv_sheet_cell_repeats repeats = PSICONV_SHEET_CELL_REPEATS_INIT;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet cell list");
-  if (!(*result = psiconv_list_new(sizeof(struct psiconv_sheet_cell_s))))
+  if (!(*result = psiconv_tree_list_new(sizeof(struct psiconv_sheet_cell_s))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -1036,15 +1084,17 @@ int psiconv_parse_sheet_cell_list(const psiconv_config config,
   psiconv_progress(config,lev+2,off+len,"Going to read all cells");
   for (i = 0; i < listlen; i++) {
     psiconv_progress(config,lev+3,off+len,"Going to read cell %d",i);
-    if ((res = psiconv_parse_sheet_cell(config,buf,lev+3,off+len,&leng,&cell,
-                                        default_layout,row_default_layouts,
-                                        col_default_layouts)))
+    if ((res = psiconv_parse_sheet_cell_repeated(config,buf,lev+3,off+len,
+                                         &leng,&cell,default_layout,
+                                         row_default_layouts,
+                                         col_default_layouts,&repeats)))
       goto ERROR2;
     if ((res = psiconv_list_add(*result,cell)))
       goto ERROR3;
-    free(cell);
+    psiconv_tree_free(cell);
     len += leng;
   }
+  psiconv_sheet_cell_repeats_summary(config,&repeats);
 
   if (length)
     *length = len;
@@ -1056,6 +1106,7 @@ int psiconv_parse_sheet_cell_list(const psiconv_config config,
 ERROR3:
   psiconv_free_sheet_cell(cell);
 ERROR2:
+  psiconv_sheet_cell_repeats_summary(config,&repeats);
   psiconv_free_sheet_cell_list(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Cells List failed");
@@ -1081,7 +1132,7 @@ int psiconv_parse_sheet_worksheet_list(const psiconv_config config,
   int leng,i,nr;
 
   psiconv_progress(config,lev+1,off,"Going to read the worksheet list");
-  if (!(*result = psiconv_list_new(sizeof(*worksheet))))
+  if (!(*result = psiconv_tree_list_new(sizeof(*worksheet))))
     goto ERROR1;
   
   psiconv_progress(config,lev+2,off+len,
@@ -1130,7 +1181,7 @@ int psiconv_parse_sheet_worksheet_list(const psiconv_config config,
       goto ERROR2;
     if ((res = psiconv_list_add(*result,worksheet)))
       goto ERROR3;
-    free(worksheet);
+    psiconv_tree_free(worksheet);
   }
 
   if (length)
@@ -1239,7 +1290,7 @@ int psiconv_parse_sheet_worksheet(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet worksheet section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -1371,7 +1422,7 @@ ERROR4:
 ERROR3:
   psiconv_free_sheet_cell_layout((*result)->default_layout); 
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Worksheet Section failed");
   if (length)
@@ -1394,7 +1445,7 @@ int psiconv_parse_sheet_line(const psiconv_config config,
 
 
   psiconv_progress(config,lev+1,off,"Going to read a sheet line");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read the line number");
@@ -1421,7 +1472,7 @@ int psiconv_parse_sheet_line(const psiconv_config config,
 ERROR3:
   psiconv_free_sheet_cell_layout((*result)->layout);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of the sheet line failed");
   if (length)
@@ -1447,7 +1498,7 @@ int psiconv_parse_sheet_line_list(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet line list");
-  if (!(*result = psiconv_list_new(sizeof(struct psiconv_sheet_line_s))))
+  if (!(*result = psiconv_tree_list_new(sizeof(struct psiconv_sheet_line_s))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -1478,7 +1529,7 @@ int psiconv_parse_sheet_line_list(const psiconv_config config,
       goto ERROR2;
     if ((res = psiconv_list_add(*result,line)))
       goto ERROR3;
-    free(line);
+    psiconv_tree_free(line);
     len += leng;
   }
 
@@ -1514,7 +1565,7 @@ int psiconv_parse_sheet_variable(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read a sheet variable");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len, "Going to read the variable name");
@@ -1594,11 +1645,11 @@ int psiconv_parse_sheet_variable(const psiconv_config config,
 
 ERROR4:
   if ((*result)->type == psiconv_var_string)
-    free((*result)->data.dat_string);
+    psiconv_tree_free((*result)->data.dat_string);
 ERROR3:
-  free((*result)->name);
+  psiconv_tree_free((*result)->name);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Variable failed");
   if (length)
@@ -1623,7 +1674,7 @@ int psiconv_parse_sheet_variable_list(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet variable list");
-  if (!(*result = psiconv_list_new(sizeof(struct psiconv_sheet_variable_s))))
+  if (!(*result = psiconv_tree_list_new(sizeof(struct psiconv_sheet_variable_s))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -1687,7 +1738,7 @@ int psiconv_parse_sheet_grid_section(const psiconv_config config,
   psiconv_u32 temp;
 
   psiconv_progress(config,lev+1,off,"Going to read the sheet grid section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len, "Going to read the first flags byte");
@@ -1934,7 +1985,7 @@ ERROR4:
 ERROR3:
   psiconv_free_sheet_grid_size_list((*result)->row_heights);
 ERROR2:  
-  free(*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Grid Section failed");
   if (length)
@@ -1957,7 +2008,7 @@ int psiconv_parse_sheet_grid_size_list(const psiconv_config config,
   psiconv_sheet_grid_size size;
 
   psiconv_progress(config,lev+1,off,"Going to read a sheet grid size list");
-  if (!(*result = psiconv_list_new(sizeof(struct psiconv_sheet_grid_size_s))))
+  if (!(*result = psiconv_tree_list_new(sizeof(struct psiconv_sheet_grid_size_s))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -1975,7 +2026,7 @@ int psiconv_parse_sheet_grid_size_list(const psiconv_config config,
       goto ERROR2;
     if ((res = psiconv_list_add(*result,size)))
       goto ERROR3;
-    free(size);
+    psiconv_tree_free(size);
     len += leng;
   }
 
@@ -2011,7 +2062,7 @@ int psiconv_parse_sheet_grid_size(const psiconv_config config,
 
   psiconv_progress(config,lev+1,off,"Going to read a sheet grid size");
 
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len, "Going to read the row or column number");
@@ -2036,7 +2087,7 @@ int psiconv_parse_sheet_grid_size(const psiconv_config config,
   return 0;
 
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Sheet Grid Size failed");
   if (length)
@@ -2059,7 +2110,7 @@ int psiconv_parse_sheet_grid_break_list(const psiconv_config config,
   psiconv_u32 nr;
 
   psiconv_progress(config,lev+1,off,"Going to read a sheet grid break list");
-  if (!(*result = psiconv_list_new(sizeof(psiconv_u32))))
+  if (!(*result = psiconv_tree_list_new(sizeof(psiconv_u32))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
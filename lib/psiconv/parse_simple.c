@@ -21,6 +21,7 @@
 #include "compat.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "parse_routines.h"
@@ -31,6 +32,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 static psiconv_float_t pow2(int n);
 static psiconv_string_t psiconv_read_string_aux(const psiconv_config config,
                                      const psiconv_buffer buf,int lev,
@@ -49,56 +52,65 @@ psiconv_float_t pow2(int n)
 
   return n<0?1/res:res;
 }
+void psiconv_reader_init(psiconv_reader *reader, const psiconv_buffer buf,
+                         psiconv_u32 off)
+{
+  psiconv_u32 buflen = psiconv_buffer_length(buf);
+
+  reader->off = off;
+  reader->error = 0;
+  if (off > buflen) {
+    reader->start = reader->ptr = reader->end = NULL;
+    reader->error = -PSICONV_E_PARSE;
+  } else {
+    reader->start = reader->ptr = psiconv_buffer_span(buf,off,buflen - off);
+    reader->end = reader->start + (buflen - off);
+  }
+}
+
 psiconv_u8 psiconv_read_u8(const psiconv_config config,const psiconv_buffer buf,int lev,psiconv_u32 off,
                            int *status)
 {
-  psiconv_u8 *ptr;
-  ptr = psiconv_buffer_get(buf,off);
-  if (!ptr) {
+  psiconv_reader reader;
+  psiconv_u8 res;
+
+  psiconv_reader_init(&reader,buf,off);
+  res = psiconv_reader_u8(&reader);
+  if (reader.error)
     psiconv_error(config,lev,off,"Trying byte read past the end of the file");
-    if (status)
-      *status = -PSICONV_E_PARSE;
-    return 0;
-  }
   if (status)
-    *status = 0;
-  return *ptr;
+    *status = reader.error;
+  return res;
 }
 
 psiconv_u16 psiconv_read_u16(const psiconv_config config,const psiconv_buffer buf,int lev,psiconv_u32 off,
                              int *status)
 {
-  psiconv_u8 *ptr0,*ptr1;
-  ptr0 = psiconv_buffer_get(buf,off);
-  ptr1 = psiconv_buffer_get(buf,off+1);
-  if (!ptr0 || !ptr1) {
+  psiconv_reader reader;
+  psiconv_u16 res;
+
+  psiconv_reader_init(&reader,buf,off);
+  res = psiconv_reader_u16(&reader);
+  if (reader.error)
     psiconv_error(config,lev,off,"Trying word read past the end of the file");
-    if (status)
-      *status = -PSICONV_E_PARSE;
-    return 0;
-  }
   if (status)
-    *status = 0;
-  return *ptr0 + (*ptr1 << 8);
+    *status = reader.error;
+  return res;
 }
 
 psiconv_u32 psiconv_read_u32(const psiconv_config config,const psiconv_buffer buf,int lev,psiconv_u32 off,
                              int *status)
 {
-  psiconv_u8 *ptr0,*ptr1,*ptr2,*ptr3;
-  ptr0 = psiconv_buffer_get(buf,off);
-  ptr1 = psiconv_buffer_get(buf,off+1);
-  ptr2 = psiconv_buffer_get(buf,off+2);
-  ptr3 = psiconv_buffer_get(buf,off+3);
-  if (!ptr0 || !ptr1 || !ptr2 || !ptr3) {
+  psiconv_reader reader;
+  psiconv_u32 res;
+
+  psiconv_reader_init(&reader,buf,off);
+  res = psiconv_reader_u32(&reader);
+  if (reader.error)
     psiconv_error(config,lev,off,"Trying long read past the end of the file");
-    if (status)
-      *status = -PSICONV_E_PARSE;
-    return 0;
-  }
   if (status)
-    *status = 0;
-  return *ptr0 + (*ptr1 << 8) + (*ptr2 << 16) + (*ptr3 << 24);
+    *status = reader.error;
+  return res;
 }
 
 psiconv_s32 psiconv_read_sint(const psiconv_config config,const psiconv_buffer buf,int lev,psiconv_u32 off,
@@ -119,31 +131,20 @@ psiconv_s32 psiconv_read_sint(const psiconv_config config,const psiconv_buffer b
 psiconv_u32 psiconv_read_S(const psiconv_config config,const psiconv_buffer buf, int lev, psiconv_u32 off,
                            int *length,int *status)
 {
-  psiconv_u8 temp;
+  psiconv_reader reader;
   psiconv_u32 res;
-  int len,localstatus;
+  int len;
 
   psiconv_progress(config,lev+1,off,"Going to read a S length indicator");
-  temp = psiconv_read_u8(config,buf,lev+2,off,&localstatus);
-  if (localstatus)
+  psiconv_reader_init(&reader,buf,off);
+  res = psiconv_reader_S(&reader);
+  if (reader.error)
     goto ERROR;
-  if ((temp & 0x03) == 0x02) {
-    res = psiconv_read_u8(config,buf,lev+2,off,&localstatus) >> 2;
-    if (localstatus)
-      goto ERROR;
-    len = 1;
+  len = reader.ptr - reader.start;
+  if (len == 1)
     psiconv_debug(config,lev+2,off,"Indicator (1 byte): %02x",res);
-  } else if ((temp & 0x07) == 0x05) {
-    res = psiconv_read_u16(config,buf,lev+2,off,&localstatus) >> 3;
-    if (localstatus)
-      goto ERROR;
-    len = 2;
+  else
     psiconv_debug(config,lev+2,off,"Indicator (2 bytes): %04x",res);
-  } else {
-    psiconv_error(config,lev+2,off,"S indicator: unknown encoding!");
-    psiconv_debug(config,lev+2,off,"Raw data first byte: %02x",temp);
-    goto ERROR;
-  }
 
   if (length)
     *length = len;
@@ -156,9 +157,17 @@ psiconv_u32 psiconv_read_S(const psiconv_config config,const psiconv_buffer buf,
   return res;
 
 ERROR:
+  if (!psiconv_buffer_span(buf,off,1))
+    psiconv_error(config,lev+2,off,"Trying byte read past the end of the file");
+  else if ((reader.ptr[0] & 0x07) == 0x05)
+    psiconv_error(config,lev+2,off,"Trying word read past the end of the file");
+  else {
+    psiconv_error(config,lev+2,off,"S indicator: unknown encoding!");
+    psiconv_debug(config,lev+2,off,"Raw data first byte: %02x",reader.ptr[0]);
+  }
   psiconv_error(config,lev+1,off,"Reading of S indicator failed");
   if (status)
-    *status = localstatus;
+    *status = reader.error;
   if (length)
      *length = 0;
   return 0;
@@ -167,37 +176,22 @@ ERROR:
 psiconv_u32 psiconv_read_X(const psiconv_config config,const psiconv_buffer buf, int lev, psiconv_u32 off,
                            int *length, int *status)
 {
-  psiconv_u8 temp;
+  psiconv_reader reader;
   psiconv_u32 res;
-  int len,localstatus;
+  int len;
 
   psiconv_progress(config,lev+1,off,"Going to read a X length indicator");
-  temp = psiconv_read_u8(config,buf,lev+2,off,&localstatus);
-  if (localstatus)
+  psiconv_reader_init(&reader,buf,off);
+  res = psiconv_reader_X(&reader);
+  if (reader.error)
     goto ERROR;
-  if ((temp & 0x01) == 0x00) {
-    res = psiconv_read_u8(config,buf,lev+2,off,&localstatus) >> 1;
-    if (localstatus)
-      goto ERROR;
-    len = 1;
+  len = reader.ptr - reader.start;
+  if (len == 1)
     psiconv_debug(config,lev+2,off,"Indicator (1 byte): %02x",res);
-  } else if ((temp & 0x03) == 0x01) {
-    res = psiconv_read_u16(config,buf,lev+2,off,&localstatus) >> 2;
-    if (localstatus)
-      goto ERROR;
-    len = 2;
+  else if (len == 2)
     psiconv_debug(config,lev+2,off,"Indicator (2 bytes): %04x",res);
-  } else if ((temp & 0x07) == 0x03) {
-    res = psiconv_read_u32(config,buf,lev+2,off,&localstatus) >> 3;
-    if (localstatus)
-      goto ERROR;
-    len = 4;
+  else
     psiconv_debug(config,lev+2,off,"Indicator (4 bytes): %08x",res);
-  } else {
-    psiconv_error(config,lev+2,off,"X indicator: unknown encoding!");
-    psiconv_debug(config,lev+2,off,"Raw data first byte: %02x",temp);
-    goto ERROR;
-  }
 
   if (length)
     *length = len;
@@ -210,9 +204,19 @@ psiconv_u32 psiconv_read_X(const psiconv_config config,const psiconv_buffer buf,
   return res;
 
 ERROR:
+  if (!psiconv_buffer_span(buf,off,1))
+    psiconv_error(config,lev+2,off,"Trying byte read past the end of the file");
+  else if ((reader.ptr[0] & 0x03) == 0x01)
+    psiconv_error(config,lev+2,off,"Trying word read past the end of the file");
+  else if ((reader.ptr[0] & 0x07) == 0x03)
+    psiconv_error(config,lev+2,off,"Trying long read past the end of the file");
+  else {
+    psiconv_error(config,lev+2,off,"X indicator: unknown encoding!");
+    psiconv_debug(config,lev+2,off,"Raw data first byte: %02x",reader.ptr[0]);
+  }
   psiconv_error(config,lev+1,off,"Reading of X indicator failed");
   if (status)
-    *status = localstatus;
+    *status = reader.error;
   if (length)
      *length = 0;
   return 0;
@@ -327,12 +331,10 @@ psiconv_string_t psiconv_read_string_aux(const psiconv_config config,
                                      psiconv_u32 off,int *length, int *status,
 				     int kind)
 {
-  int bytecount,i,leng,len,localstatus;
+  int bytecount,leng,len,nrchars,localstatus;
   psiconv_string_t result;
   char *res_copy;
-  psiconv_list string;
-  psiconv_ucs2 nextchar;
-  psiconv_ucs2 *nextcharptr;
+  const psiconv_u8 *data;
 
   psiconv_progress(config,lev+1,off,"Going to read a string");
 
@@ -351,46 +353,35 @@ psiconv_string_t psiconv_read_string_aux(const psiconv_config config,
   psiconv_debug(config,lev+2,off,"Length: %i",bytecount);
   len = leng;
 
-  if (!(string = psiconv_list_new(sizeof(*result))))
+  if (!(data = psiconv_buffer_span(buf,off+len,bytecount))) {
+    psiconv_error(config,lev,off+len,
+                  "Trying string read past the end of the file");
+    localstatus = -PSICONV_E_PARSE;
     goto ERROR1;
+  }
 
-  /* Read the string into a temporary list */
-  i = 0;
-  while (i < bytecount) {
-    nextchar = psiconv_unicode_read_char(config,buf,lev,off+i+len,
-	                                  &leng,&localstatus);
-    if (localstatus)
-      goto ERROR2;
-    if ((localstatus = psiconv_list_add(string,&nextchar)))
-      goto ERROR2;
-    i += leng;
+  /* Each character takes at least one byte */
+  if (!(result = psiconv_tree_malloc(sizeof(*result) * (bytecount + 1)))) {
+    localstatus = -PSICONV_E_NOMEM;
+    goto ERROR1;
   }
-  if (i > bytecount) {
-    psiconv_error(config,lev,off+i+len,"Malformed string");
-    localstatus = PSICONV_E_PARSE;
+  if ((nrchars = psiconv_unicode_decode(config,data,bytecount,result)) < 0) {
+    psiconv_error(config,lev,off+len,"Malformed string");
+    localstatus = nrchars;
     goto ERROR2;
   }
+  result[nrchars] = 0;
   len += bytecount;
 
-  /* Copy the list to the actual string */
-  if (!(result = malloc(sizeof(*result) * (psiconv_list_length(string) + 1))))
-    goto ERROR2;
-  for (i = 0; i < psiconv_list_length(string); i++) {
-    if (!(nextcharptr = psiconv_list_get(string,i))) {
-      psiconv_error(config,lev,off+i+len,"Data structure corruption");
-      goto ERROR3;
+  if (psiconv_verbose(config,PSICONV_VERB_DEBUG)) {
+    res_copy = psiconv_make_printable(config,result);
+    if (!res_copy) {
+      localstatus = -PSICONV_E_NOMEM;
+      goto ERROR2;
     }
-    result[i] = *nextcharptr;
+    psiconv_debug(config,lev+2,off,"Contents: `%s'",res_copy);
+    free(res_copy);
   }
-  result[i] = 0;
-
-  res_copy = psiconv_make_printable(config,result);
-  if (!res_copy)
-    goto ERROR3;
-  psiconv_debug(config,lev+2,off,"Contents: `%s'",res_copy);
-  free(res_copy);
-
-  psiconv_list_free(string);
 
   if (length)
     *length = len;
@@ -402,10 +393,8 @@ psiconv_string_t psiconv_read_string_aux(const psiconv_config config,
 
   return result;
 
-ERROR3:
-  free(result);
 ERROR2:
-  psiconv_list_free(string);
+  psiconv_tree_free(result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of string failed");
   if (status)
@@ -421,23 +410,25 @@ psiconv_float_t psiconv_read_float(const psiconv_config config,const psiconv_buf
   psiconv_float_t result,bitvalue;
   int res,bit;
   psiconv_u32 temp=0;
+  const psiconv_u8 *ptr;
 
   psiconv_progress(config,lev+1,off,"Going to read a float");
 
+  if (!(ptr = psiconv_buffer_span(buf,off,8))) {
+    psiconv_error(config,lev+2,off,"Trying float read past the end of the file");
+    res = -PSICONV_E_PARSE;
+    goto ERROR;
+  }
+  res = 0;
+
   bitvalue = 0.5;
   result = 1.0;
   for (bit = 0x33; bit > 0; bit--) {
-    if ((bit == 0x33) || ((bit & 0x07) == 0x07))
-      temp = psiconv_read_u8(config,buf,lev+2,off+ (bit >> 3),&res);
-    if (res)
-      goto ERROR;
-    if (temp & (0x01 << (bit & 0x07)))
+    if (ptr[bit >> 3] & (0x01 << (bit & 0x07)))
       result += bitvalue;
     bitvalue /= 2.0;
   }
-  temp = psiconv_read_u16(config,buf,lev+2,off+6,&res);
-  if (res)
-    goto ERROR;
+  temp = ptr[6] + (ptr[7] << 8);
   if (temp & 0x8000)
     result = -result;
   temp = (temp & 0x7ff0) >> 4;
@@ -456,4 +447,3 @@ ERROR:
     *status = res;
   return 0.0;
 }
-
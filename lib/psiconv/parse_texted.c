@@ -29,6 +29,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 int psiconv_parse_texted_section(const psiconv_config config,
                                  const psiconv_buffer buf,int lev,
                                  psiconv_u32 off, int *length,
@@ -45,7 +47,7 @@ int psiconv_parse_texted_section(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read a texted section");
-  if (!((*result) = malloc(sizeof(**result))))
+  if (!((*result) = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read section id");
@@ -132,7 +134,7 @@ int psiconv_parse_texted_section(const psiconv_config config,
 ERROR3:
   psiconv_free_text_and_layout((*result)->paragraphs);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of TextEd Section failed");
   if (length)
@@ -29,6 +29,8 @@
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 int psiconv_parse_word_status_section(const psiconv_config config,
                                       const psiconv_buffer buf, int lev,
                                       psiconv_u32 off, int *length, 
@@ -40,7 +42,7 @@ int psiconv_parse_word_status_section(const psiconv_config config,
   int leng;
 
   psiconv_progress(config,lev+1,off,"Going to read the word status section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,
@@ -159,7 +161,7 @@ int psiconv_parse_word_status_section(const psiconv_config config,
   return 0;
 
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Word Status Section failed");
   if (length)
@@ -182,11 +184,11 @@ int psiconv_parse_word_styles_section(const psiconv_config config,
   psiconv_u32 temp;
 
   psiconv_progress(config,lev+1,off,"Going to read the word styles section");
-  if (!(*result = malloc(sizeof(**result))))
+  if (!(*result = psiconv_tree_malloc(sizeof(**result))))
     goto ERROR1;
 
   psiconv_progress(config,lev+2,off+len,"Going to read style normal");
-  if (!(style = malloc(sizeof(*style))))
+  if (!(style = psiconv_tree_malloc(sizeof(*style))))
     goto ERROR2;
   style->name = NULL;
   if (!(style->paragraph = psiconv_basic_paragraph_layout()))
@@ -213,9 +215,9 @@ int psiconv_parse_word_styles_section(const psiconv_config config,
   (*result)->normal = style;
 
   psiconv_progress(config,lev+2,off+len,"Going to read hotkeys list");
-  if (!((*result)->styles = psiconv_list_new(sizeof(*style))))
+  if (!((*result)->styles = psiconv_tree_list_new(sizeof(*style))))
     goto ERROR3;
-  if (!(style = malloc(sizeof(*style)))) {
+  if (!(style = psiconv_tree_malloc(sizeof(*style)))) {
     goto ERROR3_1;
   }
     
@@ -234,7 +236,7 @@ int psiconv_parse_word_styles_section(const psiconv_config config,
     if ((res = psiconv_list_add((*result)->styles,style)))
       goto ERROR3_2;
   }
-  free(style);
+  psiconv_tree_free(style);
 
   psiconv_progress(config,lev+2,off+len,"Going to read all other styles");
   psiconv_progress(config,lev+2,off+len,"Going to read the number of styles");
@@ -251,15 +253,15 @@ int psiconv_parse_word_styles_section(const psiconv_config config,
   for (i = 0; i < nr; i++) {
     psiconv_progress(config,lev+2,off+len,"Next style: %d",i);
     if (i >= psiconv_list_length((*result)->styles)) {
-      if (!(style = malloc(sizeof(*style))))
+      if (!(style = psiconv_tree_malloc(sizeof(*style))))
         goto ERROR5;
       style->hotkey = 0;
       if (psiconv_list_add((*result)->styles,style)) {
-        free(style);
+        psiconv_tree_free(style);
         goto ERROR5;
       }
       psiconv_debug(config,lev+3,off+len,"New entry added in list");
-      free(style);
+      psiconv_tree_free(style);
     }
     if (!(style = psiconv_list_get((*result)->styles,i))) 
       goto ERROR5;
@@ -333,7 +335,7 @@ int psiconv_parse_word_styles_section(const psiconv_config config,
 
 
 ERROR3_2:
-  free(style);
+  psiconv_tree_free(style);
 ERROR3_1:
   psiconv_list_free((*result)->styles);
 goto ERROR3;
@@ -343,7 +345,7 @@ ERROR2_3:
 ERROR2_2:
   psiconv_free_paragraph_layout(style->paragraph);
 ERROR2_1:
-  free (style);
+  psiconv_tree_free(style);
 goto ERROR2;
 
 ERROR8:
@@ -351,7 +353,7 @@ ERROR8:
 ERROR7:
   psiconv_free_character_layout(style->character);
 ERROR6:
-  free(style->name);
+  psiconv_tree_free(style->name);
 ERROR5:
   for (j = 0; j < i ;j++) {
     if (!(style = psiconv_list_get((*result)->styles,j))) {
@@ -360,14 +362,14 @@ ERROR5:
     }
     psiconv_free_character_layout(style->character);
     psiconv_free_paragraph_layout(style->paragraph);
-    free(style->name);
+    psiconv_tree_free(style->name);
   }
 ERROR4:
   psiconv_list_free((*result)->styles);
 ERROR3:
   psiconv_free_word_style((*result)->normal);
 ERROR2:
-  free (*result);
+  psiconv_tree_free(*result);
 ERROR1:
   psiconv_error(config,lev+1,off,"Reading of Word Status Section failed");
   if (length)
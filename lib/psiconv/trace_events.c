@@ -0,0 +1,814 @@
+/*
+    trace_events.c - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* Generated by trace_events.sh; do not edit. */
+
+#include "config.h"
+#include "compat.h"
+
+#include "error.h"
+
+/* Event 0 is used for format strings that are not in this table */
+const char *const psiconv_trace_events[] = {
+  0,
+  "%d hotkeys, %d styles",
+  "%d text paragraphs, %d paragraph elements",
+  "Application ID section at offset %08x",
+  "Auto recalculation: %02x",
+  "Bits per pixel: %d",
+  "Bits: %02x (%02x expected)",
+  "Boolean value: %02x",
+  "Bottom cut: raw %08x, real: %f",
+  "Bottom margin: %6.3f",
+  "Built-in style",
+  "Byte %d: read %02x, expected %02x",
+  "Can't read element!",
+  "Cell contents: %01x",
+  "Cell contents: %04x",
+  "Cell contents: %f",
+  "Cell contents: %ld",
+  "Cell contents: `%s'",
+  "Cell formula reference: %d",
+  "Cell position is col:%02x row:%04x",
+  "Cell type is blank: no value given.",
+  "Character: %02x",
+  "Checking UID4",
+  "Checksum %08x is correct",
+  "Clipart ID: %08x",
+  "Code: %02x",
+  "Color: %08x (%s picture)",
+  "Color: read %08x, expected %08x or %08x",
+  "Color: red %02x, green %02x, blue %02x",
+  "Compression: %s",
+  "Configuration file %s, line %d: Set variable %s to %d",
+  "Contents: `%s'",
+  "Converting bytes to pixels completed",
+  "Cursor column: %08x",
+  "Cursor position: %08x",
+  "Cursor row: %08x",
+  "Data hor. offset: %04x",
+  "Data offset: read %08x, expected %08x",
+  "Data ver. offset: %04x",
+  "Data word at %04x: %04x",
+  "Decimals: %d",
+  "Decoded %d bytes, expected %d",
+  "Default column width: %f",
+  "Default row height: %f",
+  "Display length: %f cm",
+  "Display size: %08x",
+  "Display width: %f cm",
+  "Displayed as full document",
+  "Displayed as icon",
+  "Displayed hor. offset: %04x",
+  "Displayed hor. size: %04x",
+  "Displayed ver. offset: %04x",
+  "Displayed ver. size: %04x",
+  "Element %d",
+  "Element %d: Paragraph %d, element %d",
+  "Elements: %08x",
+  "Encoded word: %04x",
+  "End of Embedded Object Section (total length: %08x)",
+  "End of Header Section (total length: %08x)",
+  "End of Object Display Section (total length: %08x",
+  "End of Object Icon Section(total length: %08x",
+  "End of Paint Data Section (total length: %08x)",
+  "End of RLE%d decoding process",
+  "End of RLE12 decoding process",
+  "End of S length indicator (total length: %08x)",
+  "End of S",
+  "End of Sheet file",
+  "End of TextEd file",
+  "End of TextEd section (total length: %08x",
+  "End of X length indicator (total length: %08x)",
+  "End of X",
+  "End of application id section (total length: %08x",
+  "End of application id section",
+  "End of bool",
+  "End of border (total length: %08x)",
+  "End of border",
+  "End of bullet data (total length: %08x)",
+  "End of bullet",
+  "End of cell block (total length: %08x)",
+  "End of cell reference (total length: %08x)",
+  "End of character layout list (total length: %08x)",
+  "End of character layout list",
+  "End of charlist",
+  "End of clipart file",
+  "End of clipart section (total length: %08x)",
+  "End of clipart section",
+  "End of color (total length: %08x)",
+  "End of color",
+  "End of embedded object section",
+  "End of font (total length: %08x)",
+  "End of font",
+  "End of formula (total length: %08x)",
+  "End of formula element list (total length: %08x)",
+  "End of header section",
+  "End of jumptable section (total length: %08x)",
+  "End of jumptable section",
+  "End of layout section (total length: %08x)",
+  "End of layout section",
+  "End of length",
+  "End of mbm file",
+  "End of object display section",
+  "End of object icon section",
+  "End of page header",
+  "End of page header(total length: %08x",
+  "End of page layout section",
+  "End of page section (total length: %08x)",
+  "End of paint data section",
+  "End of paragraph layout list (total length: %08x)",
+  "End of paragraph layout list",
+  "End of section table section (total length: %08x)",
+  "End of section table section",
+  "End of sheet cell block reference (total length: %08x)",
+  "End of sheet cell layout (total length: %08x)",
+  "End of sheet cell list (total length: %08x)",
+  "End of sheet cell structure (total length: %08x)",
+  "End of sheet column reference (total length: %08x)",
+  "End of sheet formula list (total length: %08x)",
+  "End of sheet grid break list (total length: %08x)",
+  "End of sheet grid section (total length: %08x)",
+  "End of sheet grid size list (total length: %08x)",
+  "End of sheet grid size(total length: %08x)",
+  "End of sheet info section (total length: %08x)",
+  "End of sheet line list (total length: %08x)",
+  "End of sheet name section (total length: %08x)",
+  "End of sheet number format (total length: %08x)",
+  "End of sheet status section (total length: %08x)",
+  "End of sheet variabels list (total length: %08x)",
+  "End of sheet variable (total length: %08x)",
+  "End of sheet workbook section (total length: %08x)",
+  "End of sheet worksheet section (total length: %08x)",
+  "End of short string",
+  "End of size",
+  "End of sketch file",
+  "End of sketch section (total length: %08x)",
+  "End of sketch section",
+  "End of string (total length: %08x)",
+  "End of string",
+  "End of styled layout section",
+  "End of styleless layout section",
+  "End of tab (total length: %08x)",
+  "End of tab",
+  "End of text section (total length: %08x",
+  "End of text section",
+  "End of texted file",
+  "End of texted section",
+  "End of the sheet line (total length: %08x)",
+  "End of this formula list",
+  "End of word file",
+  "End of word status section (total length: %08x)",
+  "End of word status section",
+  "End of word styles section (total length: %08x)",
+  "End of word styles section",
+  "End of worksheet list (total length: %08x)",
+  "Entry %d: ID = %08x",
+  "Entry %d: Offset = %08x",
+  "Error code: %04x",
+  "Expected checksum %08x, found %08x",
+  "Expected end: %04x, found end: %04x",
+  "Expected marker %02x, found %02x",
+  "Expected marker: %02x, found byte: %02x",
+  "Extracting object: add %08x to all following offsets",
+  "File is a Clipart file",
+  "File is a MBM file",
+  "File is a Sheet file",
+  "File is a Sketch file",
+  "File is a TextEd file",
+  "File is a Word file",
+  "Finished converting pixels to floats",
+  "Finished converting pixels to packed RGB",
+  "First column: %d",
+  "First page: %d",
+  "First row: %d",
+  "First unknown long: %08x",
+  "Fit lines to screen: %02x",
+  "Flag: %02x",
+  "Flags byte: %02x",
+  "Flags: %02x",
+  "Float value: %f",
+  "Footer distance: %6.3f",
+  "Form hor. magnification: %f",
+  "Form hor. size: %04x",
+  "Form ver. magnification: %f",
+  "Form ver. size: %04x",
+  "Formula byte length: %d",
+  "Found %d bytes, expected %d",
+  "Found ID %08x",
+  "Found Layout section at %08x",
+  "Found Replacement section at %08x",
+  "Found Unknown section at %08x",
+  "Found a Sheet file",
+  "Found a Sketch file",
+  "Found a TextEd file",
+  "Found a Word file",
+  "Found an embedded object",
+  "Found font `%s', displayed with screen font %02x",
+  "Found the Application ID Section at offset %08x",
+  "Found the Application ID section at %08x",
+  "Found the Layout section at %08x",
+  "Found the Object Display Section at %08x",
+  "Found the Object Icon Section at %08x",
+  "Found the Object Section Table Section at %08x",
+  "Found the Page Layout section at %08x",
+  "Found the Password section at %08x",
+  "Found the Sheet Status section at %08x",
+  "Found the Sheet Workbook section at %08x",
+  "Found the Sketch section at %08x",
+  "Found the Text section at %08x",
+  "Found the TextEd section at %08x",
+  "Found the Word Status section at %08x",
+  "Found the Word Styles section at %08x",
+  "Found unexpected marker %02x",
+  "Fourth unknown long: %08x",
+  "Freeze columns: %s",
+  "Freeze rows: %s",
+  "Going read the to right margin",
+  "Going to access configuration file %s",
+  "Going to allocate a new element",
+  "Going to an unknown byte (%02x expected)",
+  "Going to convert pixels to floats",
+  "Going to convert pixels to packed RGB",
+  "Going to convert the bytes to pixels",
+  "Going to decode the RLE%d encoding",
+  "Going to decode the RLE12 encoding",
+  "Going to determine embedded object file type",
+  "Going to determine the base style",
+  "Going to parse a vararg function",
+  "Going to parse border data",
+  "Going to parse bullet data",
+  "Going to parse color",
+  "Going to parse configuration file %s: ",
+  "Going to parse font",
+  "Going to parse line %d: %s",
+  "Going to parse tab",
+  "Going to parse the Embedded Object Section",
+  "Going to parse the paragraph element list",
+  "Going to parse the text section",
+  "Going to read 22 unknown bytes (%02x expected)",
+  "Going to read 3 unknown bytes (%02x expected)",
+  "Going to read UID1 to UID3",
+  "Going to read a S length indicator",
+  "Going to read a X length indicator",
+  "Going to read a boolean",
+  "Going to read a cell block reference",
+  "Going to read a cell reference",
+  "Going to read a clipart file",
+  "Going to read a float",
+  "Going to read a floating point number",
+  "Going to read a formula element list",
+  "Going to read a formula item marker",
+  "Going to read a formula",
+  "Going to read a fourth unknown long",
+  "Going to read a long of the 3rd ??? Section (%08x expected)",
+  "Going to read a mbm file",
+  "Going to read a page header (or footer)",
+  "Going to read a paint data section",
+  "Going to read a second unknown long",
+  "Going to read a sheet cell block reference",
+  "Going to read a sheet cell block",
+  "Going to read a sheet cell layout",
+  "Going to read a sheet cell reference",
+  "Going to read a sheet cell structure",
+  "Going to read a sheet file",
+  "Going to read a sheet grid break list",
+  "Going to read a sheet grid size list",
+  "Going to read a sheet grid size",
+  "Going to read a sheet line",
+  "Going to read a sheet numberformat",
+  "Going to read a sheet ref",
+  "Going to read a sheet variable",
+  "Going to read a signed integer",
+  "Going to read a sketch file",
+  "Going to read a string",
+  "Going to read a texted file",
+  "Going to read a texted section",
+  "Going to read a third unknown long",
+  "Going to read a word file",
+  "Going to read all cells",
+  "Going to read all elements",
+  "Going to read all formulas",
+  "Going to read all lines",
+  "Going to read all other styles",
+  "Going to read all variables",
+  "Going to read an Embedded Object",
+  "Going to read an integer",
+  "Going to read an unknown Xint",
+  "Going to read an unknown byte (%02x expected)",
+  "Going to read an unknown long",
+  "Going to read an unknown word (%04x expected)",
+  "Going to read background color (?)",
+  "Going to read background color",
+  "Going to read base character layout",
+  "Going to read base paragraph layout",
+  "Going to read bold",
+  "Going to read border distance to text",
+  "Going to read border kind",
+  "Going to read border thickness",
+  "Going to read bottom border",
+  "Going to read bottom space",
+  "Going to read bullet character",
+  "Going to read bullet color",
+  "Going to read bullet font size",
+  "Going to read bullet font",
+  "Going to read bullet length",
+  "Going to read bullet",
+  "Going to read cell %d",
+  "Going to read character layout codes",
+  "Going to read clipart section %i",
+  "Going to read cursor position",
+  "Going to read display size",
+  "Going to read displayed ver. size",
+  "Going to read displayed-on-first-page flag",
+  "Going to read element %d",
+  "Going to read entry %d",
+  "Going to read extra tab",
+  "Going to read first page number",
+  "Going to read first unfrozen column",
+  "Going to read first unfrozen row",
+  "Going to read font size",
+  "Going to read font",
+  "Going to read footer distance",
+  "Going to read form ver. size",
+  "Going to read formula %d",
+  "Going to read graph display size",
+  "Going to read header distance",
+  "Going to read horizontal justify",
+  "Going to read hotkeys list",
+  "Going to read indent left first line",
+  "Going to read indent left",
+  "Going to read indent on/off",
+  "Going to read indent right",
+  "Going to read initially display graph",
+  "Going to read italic",
+  "Going to read left border",
+  "Going to read line %d",
+  "Going to read linespacing distance",
+  "Going to read linespacing exact",
+  "Going to read no widow protection",
+  "Going to read number of frozen columns",
+  "Going to read number of frozen rows",
+  "Going to read number of in-line layout elements",
+  "Going to read on next page",
+  "Going to read on one page",
+  "Going to read operational flags",
+  "Going to read outline level",
+  "Going to read page dimensions id",
+  "Going to read page portrait/landscape",
+  "Going to read paragraph layout list",
+  "Going to read paragraph layout",
+  "Going to read paragraph type list length",
+  "Going to read paragraph type list",
+  "Going to read picture X size",
+  "Going to read picture Y size",
+  "Going to read picture section %i",
+  "Going to read pixel data offset",
+  "Going to read right border",
+  "Going to read second byte of display flags",
+  "Going to read section id",
+  "Going to read section size",
+  "Going to read sheet display size",
+  "Going to read side toolbar setting",
+  "Going to read standard tabs",
+  "Going to read strikethrough",
+  "Going to read style normal",
+  "Going to read super_sub",
+  "Going to read tab location",
+  "Going to read text color",
+  "Going to read the Application ID Section",
+  "Going to read the Embedded Object Section offset",
+  "Going to read the Embedded Object Section",
+  "Going to read the MBM jumptable",
+  "Going to read the Object Display Section",
+  "Going to read the Object Icon Section",
+  "Going to read the Paint Data Section",
+  "Going to read the Section Table Offset Section",
+  "Going to read the Section Table Section",
+  "Going to read the TextEd section",
+  "Going to read the application id section",
+  "Going to read the application id string",
+  "Going to read the border color",
+  "Going to read the bottom cut",
+  "Going to read the bottom margin",
+  "Going to read the cell formula reference",
+  "Going to read the cell position",
+  "Going to read the cell type",
+  "Going to read the cell value",
+  "Going to read the cells list",
+  "Going to read the character codes",
+  "Going to read the character layout",
+  "Going to read the clipart section",
+  "Going to read the clipart sections",
+  "Going to read the code byte",
+  "Going to read the column breaks list",
+  "Going to read the column defaults",
+  "Going to read the column heights list",
+  "Going to read the column reference",
+  "Going to read the cursor column",
+  "Going to read the cursor row",
+  "Going to read the data hor. offset",
+  "Going to read the data ver. offset",
+  "Going to read the default cell layout",
+  "Going to read the default character codes",
+  "Going to read the default column height",
+  "Going to read the default formats flag",
+  "Going to read the default number format",
+  "Going to read the default paragraph codes",
+  "Going to read the default row height",
+  "Going to read the display as icon flag (expecting 0x00 or 0x01)",
+  "Going to read the display height",
+  "Going to read the display width",
+  "Going to read the displayed hor. offset",
+  "Going to read the displayed hor. size",
+  "Going to read the displayed ver. offset",
+  "Going to read the element id",
+  "Going to read the element type",
+  "Going to read the eof marker",
+  "Going to read the error code",
+  "Going to read the final unknown byte (0x00 or 0x01 expected)",
+  "Going to read the first byte (%02x expected)",
+  "Going to read the first byte of display flags",
+  "Going to read the first cell",
+  "Going to read the first flags byte",
+  "Going to read the first visible column",
+  "Going to read the first visible row",
+  "Going to read the flags byte",
+  "Going to read the footer",
+  "Going to read the form hor. size",
+  "Going to read the formula byte length",
+  "Going to read the formula elements list",
+  "Going to read the formulas list",
+  "Going to read the fourth flags byte",
+  "Going to read the grid section",
+  "Going to read the has_content flag",
+  "Going to read the header section",
+  "Going to read the header",
+  "Going to read the hor. magnification",
+  "Going to read the hotkey",
+  "Going to read the icon height",
+  "Going to read the icon name",
+  "Going to read the icon width",
+  "Going to read the info section",
+  "Going to read the initial byte (%02x expected)",
+  "Going to read the initial byte (%02x or %02x expected)",
+  "Going to read the initial bytes (%02x expected)",
+  "Going to read the jumptable section",
+  "Going to read the last cell",
+  "Going to read the last visible column",
+  "Going to read the last visible row",
+  "Going to read the layout section",
+  "Going to read the layout",
+  "Going to read the left cut",
+  "Going to read the left margin",
+  "Going to read the line number",
+  "Going to read the list length",
+  "Going to read the list",
+  "Going to read the name section",
+  "Going to read the next marker",
+  "Going to read the number of arguments (%d expected)",
+  "Going to read the number of bits per pixel",
+  "Going to read the number of characters it applies to",
+  "Going to read the number of decimals",
+  "Going to read the number of defined cells",
+  "Going to read the number of defined lines",
+  "Going to read the number of elements",
+  "Going to read the number of entries",
+  "Going to read the number of formulas",
+  "Going to read the number of paragraphs",
+  "Going to read the number of styles",
+  "Going to read the number of variables",
+  "Going to read the object height",
+  "Going to read the object marker (0x%08x expected)",
+  "Going to read the object width",
+  "Going to read the offset encoding",
+  "Going to read the offset of the 3rd ??? Section",
+  "Going to read the offset of the Cells List",
+  "Going to read the offset of the Formulas List",
+  "Going to read the offset of the Grid Section",
+  "Going to read the offset of the MBM jumptable",
+  "Going to read the offset of the Name Section",
+  "Going to read the offset of the Variable List",
+  "Going to read the offset of the Worksheet List",
+  "Going to read the offset of the column defaults Section",
+  "Going to read the offset of the row defaults Section",
+  "Going to read the offset of the section table section",
+  "Going to read the offset of the sheet info Section",
+  "Going to read the page height",
+  "Going to read the page layout section",
+  "Going to read the page width",
+  "Going to read the paragraph codes",
+  "Going to read the paragraph element base style",
+  "Going to read the paragraph elements",
+  "Going to read the paragraph layout",
+  "Going to read the paragraph length",
+  "Going to read the paragraph type list elements",
+  "Going to read the paragraph type",
+  "Going to read the picture data",
+  "Going to read the picture sections",
+  "Going to read the pixel data",
+  "Going to read the real picture x size",
+  "Going to read the real picture y size",
+  "Going to read the repeated marker %02x",
+  "Going to read the replacements",
+  "Going to read the right cut",
+  "Going to read the row breaks list",
+  "Going to read the row defaults",
+  "Going to read the row heights list",
+  "Going to read the row or column height",
+  "Going to read the row or column number",
+  "Going to read the row reference",
+  "Going to read the scrollbar status byte",
+  "Going to read the second flags byte",
+  "Going to read the section ID",
+  "Going to read the section jumptable",
+  "Going to read the section table entries",
+  "Going to read the section table length",
+  "Going to read the section table section",
+  "Going to read the section type",
+  "Going to read the sheet cell list",
+  "Going to read the sheet formula list",
+  "Going to read the sheet grid section",
+  "Going to read the sheet info section",
+  "Going to read the sheet line list",
+  "Going to read the sheet name section",
+  "Going to read the sheet name",
+  "Going to read the sheet status section",
+  "Going to read the sheet variable list",
+  "Going to read the sheet workbook section",
+  "Going to read the sheet worksheet section",
+  "Going to read the sketch section",
+  "Going to read the style name",
+  "Going to read the tab kind",
+  "Going to read the text layout inline elements",
+  "Going to read the text layout inline list",
+  "Going to read the text",
+  "Going to read the toolbar status byte",
+  "Going to read the top cut",
+  "Going to read the top margin",
+  "Going to read the trailing byte (%02x expected)",
+  "Going to read the type identifier",
+  "Going to read the type marker",
+  "Going to read the variable name",
+  "Going to read the variable number",
+  "Going to read the variables list",
+  "Going to read the ver. magnification",
+  "Going to read the word status section",
+  "Going to read the word styles section",
+  "Going to read the worksheet list",
+  "Going to read the worksheet offset",
+  "Going to read three zero bytes",
+  "Going to read together with",
+  "Going to read top border",
+  "Going to read top space",
+  "Going to read top toolbar setting",
+  "Going to read underline",
+  "Going to read unknown code 0x24 (%02x expected)",
+  "Going to read unknown long (%08x expected)",
+  "Going to read vararg argument %d",
+  "Going to read variable %d",
+  "Going to read vertical justify",
+  "Going to read whether RLE compression is used",
+  "Going to read whether this is a colour or greyscale picture",
+  "Going to read whether this style is built-in",
+  "Going to read wrap to fit cell limits",
+  "Going to search the Section Table Section for the Application ID Section",
+  "Going to skip 1 word of zeros",
+  "Going to skip an unknown setting",
+  "Graph display size: %08x",
+  "Handling pixel %04x (%04x)",
+  "Has_content flag: %02x",
+  "Header distance: %6.3f",
+  "Hotkey %d value %08x",
+  "ID: %08x expected, %08x found",
+  "ID: %08x",
+  "Icon flag found: %02x",
+  "Icon length: %f cm",
+  "Icon width: %f cm",
+  "Id: %02x",
+  "Identifier: %08x",
+  "Indent on: %02x",
+  "Indicator (1 byte): %02x",
+  "Indicator (2 bytes): %04x",
+  "Indicator (4 bytes): %08x",
+  "Initial byte: %02x",
+  "Justify: %02x",
+  "Kind found: %02x (defaulted to left tab)",
+  "Kind: %02x",
+  "Landscape: %d",
+  "Last byte: read %02x, expected %02x or %02x",
+  "Last column: %d",
+  "Last row: %d",
+  "Layout section at offset %08x",
+  "Left cut: raw %08x, real: %f",
+  "Left margin: %6.3f",
+  "Length in bytes: %08x",
+  "Length: %02x",
+  "Length: %08x",
+  "Length: %f",
+  "Length: %i",
+  "Length: specified %02x, found %02x",
+  "Line %d: %d characters",
+  "Line %d: `%s'",
+  "Line number: %d\n",
+  "List length: %08x",
+  "Long read: %08x",
+  "Looking for the Application ID section",
+  "Looking for the Layout section",
+  "Looking for the Object Display Section",
+  "Looking for the Object Icon Section",
+  "Looking for the Page layout section",
+  "Looking for the Section Table Offset Section",
+  "Looking for the Sheet Workbook section",
+  "Looking for the Sketch section",
+  "Looking for the Status section",
+  "Looking for the Text section",
+  "Looking for the TextEd section",
+  "Looking for the Word Style section",
+  "Marker byte at %04x: %02x",
+  "Marker: %02x (%s)",
+  "Marker: %02x",
+  "Marker: read %08x, expected %08x",
+  "More than one item left on the stack (%d)",
+  "Name: `%s' expected, `%s' found",
+  "New entry added in list",
+  "Next item: a cell block",
+  "Next item: a cell reference",
+  "Next item: a float",
+  "Next item: a string",
+  "Next item: a variable reference",
+  "Next item: an integer",
+  "Next style: %d",
+  "No layout section today",
+  "Normal Hotkey value %08x",
+  "Nr: %08x",
+  "Number of defined cells: %d",
+  "Number of defined lines: %d",
+  "Number of elements: %d",
+  "Number of formulas: %d",
+  "Number of frozen columns: %d",
+  "Number of frozen rows: %d",
+  "Number of paragraphs: %d",
+  "Number of variables: %d",
+  "Number: %08x",
+  "Nummer of hotkeys: %02x",
+  "Object Display Section at offset %08x",
+  "Object Icon Section at offset %08x",
+  "Object height: %f cm",
+  "Object width: %f cm",
+  "Offset: %04x",
+  "Offset: %08x",
+  "Outline Level: %08x",
+  "Page body id: read %08x, expected %08x",
+  "Page dimensions marker: read %08x, expected %08x or %08x",
+  "Page height: %6.3f",
+  "Page layout section at offset %08x",
+  "Page width: %6.3f",
+  "Paragraph length: %d",
+  "Paragraph length: layout section says %d, counted %d",
+  "Picture X size: %08x:",
+  "Picture Y size: %08x:",
+  "Picture x size: %f",
+  "Picture y size: %f",
+  "Pixel byte %04x of %04x has value %02x",
+  "Pixel: Red (%f), green (%f), blue (%f)",
+  "Raw data first byte: %02x",
+  "Read %04x, expected %04x",
+  "Read %08x, expected %08x or %08x",
+  "Read %08x, expected %08x",
+  "Read %d arguments, but formula says there are %d",
+  "Read %d characters instead of %d",
+  "Read compression type %d",
+  "Read trailing byte 0xff",
+  "Reading the text length",
+  "Reading trailing bytes",
+  "Reference: %s offset %d",
+  "Removable style",
+  "Right cut: raw %08x, real: %f",
+  "Right margin: %6.3f",
+  "Second unknown long: %08x",
+  "Section ID %08x at offset %08x",
+  "Section ID %08x, offset %08x",
+  "Section size: %08x",
+  "Sheet display size: %08x",
+  "Sheet workbook section at offset %08x",
+  "Show column titles: %s",
+  "Show full graphs: %02x",
+  "Show full pictures: %02x",
+  "Show hard minus: %02x",
+  "Show hard space: %02x",
+  "Show horizontal grid: %s",
+  "Show horizontal scrollbar: %02x",
+  "Show line breaks: %02x",
+  "Show page breaks: %s",
+  "Show paragraph ends: %02x",
+  "Show row titles: %s",
+  "Show side graph toolbar: %02x",
+  "Show side sheet toolbar: %02x",
+  "Show spaces: %02x",
+  "Show tabs: %02x",
+  "Show top graph toolbar: %02x",
+  "Show top sheet toolbar: %02x",
+  "Show vertical grid: %s",
+  "Show vertical scrollbar: %02x",
+  "Size: %d x %d pixels, %d bits per pixel",
+  "Size: %f",
+  "Size: %f\n",
+  "Sketch section at offset %08x",
+  "Starting a new line",
+  "Status section at offset %08x",
+  "Style indicator: %02x",
+  "Style: %02x",
+  "Super_sub: %02x",
+  "Text section at offset %08x",
+  "TextEd section at offset %08x",
+  "Thickness: %f",
+  "Third unknown long: %08x",
+  "Top cut: raw %08x, real: %f",
+  "Top margin: %6.3f",
+  "Trailing byte: %02x expected, read %02x",
+  "Trailing byte: %02x",
+  "Trying to determine the file type",
+  "Type: %02x (not based on a paragraph type)",
+  "Type: %02x",
+  "UID1: %08x",
+  "UID2: %08x",
+  "UID3: %08x",
+  "Unknown byte: %02x",
+  "Unknown flag: %02x",
+  "Unknown flags: %02x",
+  "Unknown id: %08x",
+  "Unknown type - using base styles instead",
+  "Value: %02x",
+  "Value: %04x",
+  "Value: %08x",
+  "Value: %d",
+  "Value: %d\n",
+  "Value: %f",
+  "Value: %s",
+  "Word styles section at offset %08x",
+  "Writing %d bytes of pixel data",
+  "Writing S",
+  "Writing X",
+  "Writing application id section",
+  "Writing bool",
+  "Writing border",
+  "Writing bullet",
+  "Writing character layout list",
+  "Writing charlist",
+  "Writing clipart file",
+  "Writing clipart section",
+  "Writing color",
+  "Writing embedded object section",
+  "Writing font",
+  "Writing header section",
+  "Writing jumptable section",
+  "Writing layout section",
+  "Writing length",
+  "Writing mbm file",
+  "Writing object display section",
+  "Writing object icon section",
+  "Writing offset",
+  "Writing page header",
+  "Writing page layout section",
+  "Writing paint data section",
+  "Writing paragraph layout list",
+  "Writing section table section",
+  "Writing short string",
+  "Writing size",
+  "Writing sketch file",
+  "Writing sketch section",
+  "Writing string",
+  "Writing styled layout section",
+  "Writing styleless layout section",
+  "Writing tab",
+  "Writing text section",
+  "Writing texted file",
+  "Writing texted section",
+  "Writing u16",
+  "Writing u32",
+  "Writing u8",
+  "Writing word file",
+  "Writing word status section",
+  "Writing word styles section",
+  "read %08x, expected %08x",
+};
+
+const psiconv_u32 psiconv_trace_nr_events =
+  sizeof(psiconv_trace_events) / sizeof(psiconv_trace_events[0]);
@@ -0,0 +1,101 @@
+#! /bin/sh
+
+# Generate trace_events.c: the table of all progress and debug format
+# strings in the library. A trace record refers to its format through an
+# index into this table, so records can be decoded by other processes.
+# Run it from the source directory whenever messages change:
+#   ./trace_events.sh > trace_events.c
+
+srcdir=${1:-.}
+
+cat << 'EOF'
+/*
+    trace_events.c - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* Generated by trace_events.sh; do not edit. */
+
+#include "config.h"
+#include "compat.h"
+
+#include "error.h"
+
+/* Event 0 is used for format strings that are not in this table */
+const char *const psiconv_trace_events[] = {
+  0,
+EOF
+
+for file in "$srcdir"/*.c; do
+  case "$file" in
+    */trace_events.c) continue ;;
+  esac
+  awk '
+    { text = text $0 "\n" }
+    END {
+      # Find every call, skip its first three arguments and print the
+      # string literal(s) that make up the format
+      while (match(text,/psiconv_(progress|debug)[ \t\n]*\(/)) {
+        text = substr(text,RSTART + RLENGTH)
+        depth = 0
+        commas = 0
+        i = 1
+        while ((commas < 3) && (i <= length(text))) {
+          c = substr(text,i,1)
+          if ((c == "(") || (c == "["))
+            depth++
+          else if ((c == ")") || (c == "]")) {
+            if (!depth)
+              break
+            depth--
+          } else if ((c == ",") && !depth)
+            commas++
+          i++
+        }
+        if (commas < 3)
+          continue
+        format = ""
+        for (;;) {
+          while (substr(text,i,1) ~ /[ \t\n]/)
+            i++
+          if (substr(text,i,1) != "\"")
+            break
+          i++
+          while ((c = substr(text,i,1)) != "\"") {
+            if (c == "\\") {
+              format = format c
+              i++
+              c = substr(text,i,1)
+            }
+            format = format c
+            i++
+          }
+          i++
+        }
+        if (format != "")
+          print "  \"" format "\","
+        text = substr(text,i)
+      }
+    }' "$file"
+done | LC_ALL=C sort -u
+
+cat << 'EOF'
+};
+
+const psiconv_u32 psiconv_trace_nr_events =
+  sizeof(psiconv_trace_events) / sizeof(psiconv_trace_events[0]);
+EOF
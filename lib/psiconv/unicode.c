@@ -27,11 +27,16 @@
 
 #include <string.h>
 #include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #ifdef DMALLOC
 #include <dmalloc.h>
 #endif
 
+#include "arena_alloc.h"
+
 
 
 psiconv_ucs2 table_cp1252[0x100] =
@@ -72,6 +77,17 @@ psiconv_ucs2 table_cp1252[0x100] =
 
 
 
+/* The inverse of a character table. It is split in pages of 256
+   characters, indexed by the high byte; pages without any characters are
+   not allocated. Entries are the EPOC character plus one, or 0 if there
+   is no EPOC character for it. */
+struct psiconv_unicode_inverse_s {
+  psiconv_u16 *pages[0x100];
+};
+
+static psiconv_u8 psiconv_unicode_epoc_char(const psiconv_config config,
+                                            psiconv_ucs2 value);
+
 /* TODO: Check the charset number, select the correct one */
 extern int psiconv_unicode_select_characterset(const psiconv_config config,
                                                int charset)
@@ -85,7 +101,66 @@ extern int psiconv_unicode_select_characterset(const psiconv_config config,
 	    break;
     default: return -1;
   }
+  return psiconv_unicode_build_inverse(config);
+}
+
+int psiconv_unicode_build_inverse(const psiconv_config config)
+{
+  struct psiconv_unicode_inverse_s *inverse;
+  psiconv_u16 **page;
+  int i;
+
+  psiconv_unicode_free_inverse(config);
+  if (!(inverse = malloc(sizeof(*inverse))))
+    goto ERROR1;
+  memset(inverse->pages,0,sizeof(inverse->pages));
+  /* Going backwards, so the lowest EPOC character wins, like it does
+     when scanning the table */
+  for (i = 0xff; i >= 0; i--) {
+    page = inverse->pages + (config->unicode_table[i] >> 8);
+    if (!*page && !(*page = calloc(0x100,sizeof(**page))))
+      goto ERROR2;
+    (*page)[config->unicode_table[i] & 0xff] = i + 1;
+  }
+  config->unicode_inverse = inverse;
   return 0;
+
+ERROR2:
+  for (i = 0; i < 0x100; i++)
+    free(inverse->pages[i]);
+  free(inverse);
+ERROR1:
+  return -PSICONV_E_NOMEM;
+}
+
+void psiconv_unicode_free_inverse(const psiconv_config config)
+{
+  int i;
+
+  if (!config->unicode_inverse)
+    return;
+  for (i = 0; i < 0x100; i++)
+    free(config->unicode_inverse->pages[i]);
+  free(config->unicode_inverse);
+  config->unicode_inverse = NULL;
+}
+
+psiconv_u8 psiconv_unicode_epoc_char(const psiconv_config config,
+                                     psiconv_ucs2 value)
+{
+  const psiconv_u16 *page;
+  int i;
+
+  if (config->unicode_inverse) {
+    page = config->unicode_inverse->pages[value >> 8];
+    if (page && page[value & 0xff])
+      return page[value & 0xff] - 1;
+    return config->unknown_epoc_char;
+  }
+  for (i = 0; i < 256; i++) 
+    if (config->unicode_table[i] == value)
+      return i;
+  return config->unknown_epoc_char;
 }
 
 
@@ -94,14 +169,18 @@ psiconv_ucs2 psiconv_unicode_read_char(const psiconv_config config,
 				       int lev,psiconv_u32 off,
 				       int *length,int *status)
 {
+  const psiconv_u8 *ptr;
   psiconv_u8 char1,char2,char3;
   psiconv_ucs2 result=0;
-  int res;
+  int res=0;
   int len=0;
 
-  char1 = psiconv_read_u8(config,buf,lev,off+len,&res);
-  if (res)
+  if (!(ptr = psiconv_buffer_span(buf,off,1))) {
+    psiconv_error(config,lev,off,"Trying byte read past the end of the file");
+    res = -PSICONV_E_PARSE;
     goto ERROR;
+  }
+  char1 = ptr[0];
   len ++;
 
   if (config->unicode) {
@@ -111,8 +190,14 @@ psiconv_ucs2 psiconv_unicode_read_char(const psiconv_config config,
     } else if (char1 < 0x80)
       result = char1;
     else {
-      char2 = psiconv_read_u8(config,buf,lev,off+len,&res);
-      len ++;
+      len += char1 < 0xe0?1:2;
+      if (!(ptr = psiconv_buffer_span(buf,off,len))) {
+        psiconv_error(config,lev,off,
+                      "Trying character read past the end of the file");
+        res = PSICONV_E_PARSE;
+        goto ERROR;
+      }
+      char2 = ptr[1];
       if ((char2 & 0xc0) != 0x80) {
         res = PSICONV_E_PARSE;
         goto ERROR;
@@ -120,8 +205,7 @@ psiconv_ucs2 psiconv_unicode_read_char(const psiconv_config config,
       if (char1 < 0xe0) 
 	result = ((char1 & 0x1f) << 6) | (char2 & 0x3f);
       else {
-        char3 = psiconv_read_u8(config,buf,lev,off+len,&res);
-	len ++;
+        char3 = ptr[2];
 	if ((char3 & 0xc0) != 0x80) {
 	  res = PSICONV_E_PARSE;
 	  goto ERROR;
@@ -141,11 +225,68 @@ ERROR:
   return result;
 }
 
+int psiconv_unicode_decode(const psiconv_config config,
+                           const psiconv_u8 *data, psiconv_u32 len,
+                           psiconv_ucs2 *result)
+{
+  const psiconv_u8 *end = data + len;
+  psiconv_ucs2 *dest = result;
+  psiconv_u8 char1,char2,char3;
+
+  if (!config->unicode) {
+    while (data < end) {
+      char1 = *data++;
+      *dest++ = config->unicode_table[char1]?config->unicode_table[char1]:
+                                             config->unknown_unicode_char;
+    }
+    return dest - result;
+  }
+
+  while (data < end) {
+    /* Most text is plain ASCII, which needs no decoding at all */
+#ifdef __SSE2__
+    {
+      __m128i bytes,zero = _mm_setzero_si128();
+      while ((end - data >= 16) &&
+             !_mm_movemask_epi8(bytes = _mm_loadu_si128((const __m128i *) data))) {
+        _mm_storeu_si128((__m128i *) dest,_mm_unpacklo_epi8(bytes,zero));
+        _mm_storeu_si128((__m128i *) (dest + 8),_mm_unpackhi_epi8(bytes,zero));
+        data += 16;
+        dest += 16;
+      }
+    }
+#endif
+    while ((data < end) && (*data < 0x80))
+      *dest++ = *data++;
+    if (data == end)
+      break;
+    char1 = data[0];
+    if (char1 >= 0xf0)
+      return -PSICONV_E_PARSE;
+    if (end - data < (char1 < 0xe0?2:3))
+      return -PSICONV_E_PARSE;
+    char2 = data[1];
+    if ((char2 & 0xc0) != 0x80)
+      return -PSICONV_E_PARSE;
+    if (char1 < 0xe0) {
+      *dest++ = ((char1 & 0x1f) << 6) | (char2 & 0x3f);
+      data += 2;
+    } else {
+      char3 = data[2];
+      if ((char3 & 0xc0) != 0x80)
+        return -PSICONV_E_PARSE;
+      *dest++ = ((char1 & 0x0f) << 12) | ((char2 & 0x3f) << 6) | 
+                (char3 & 0x3f);
+      data += 3;
+    }
+  }
+  return dest - result;
+}
+
 int psiconv_unicode_write_char(const psiconv_config config,
                                psiconv_buffer buf,
 			       int lev, psiconv_ucs2 value)
 {
-  int i;
   int res=0;
 
   if (config->unicode) {
@@ -166,17 +307,66 @@ int psiconv_unicode_write_char(const psiconv_config config,
 	goto ERROR;
     }
   } else {
-    for (i = 0; i < 256; i++) 
-      if (config->unicode_table[i] == value)
-	break;
     if ((res = psiconv_write_u8(config,buf,lev,
-	                        i == 256?config->unknown_epoc_char:i)))
+                                psiconv_unicode_epoc_char(config,value))))
       goto ERROR;
   }
 ERROR:
   return res;
 }
 
+psiconv_u32 psiconv_unicode_encode_string(const psiconv_config config,
+                                          const psiconv_ucs2 *input,
+                                          psiconv_u32 nr, psiconv_u8 *output)
+{
+  const psiconv_ucs2 *end = input + nr;
+  psiconv_u8 *dest = output;
+  psiconv_ucs2 value;
+
+  if (!config->unicode) {
+    while (input < end)
+      *dest++ = psiconv_unicode_epoc_char(config,*input++);
+    return dest - output;
+  }
+
+  while (input < end) {
+    value = *input++;
+    if (value < 0x80)
+      *dest++ = value;
+    else if (value < 0x800) {
+      *dest++ = 0xc0 | (value >> 6);
+      *dest++ = 0x80 | (value & 0x3f);
+    } else {
+      *dest++ = 0xe0 | (value >> 12);
+      *dest++ = 0x80 | ((value >> 6) & 0x3f);
+      *dest++ = 0x80 | (value & 0x3f);
+    }
+  }
+  return dest - output;
+}
+
+int psiconv_unicode_write_string(const psiconv_config config,
+                                 psiconv_buffer buf, int lev,
+                                 const psiconv_ucs2 *input, psiconv_u32 nr)
+{
+#define ENCODE_CHUNK 256
+  psiconv_u8 output[3 * ENCODE_CHUNK];
+  psiconv_u32 chunk,len;
+  int res;
+
+  while (nr) {
+    chunk = nr < ENCODE_CHUNK?nr:ENCODE_CHUNK;
+    len = psiconv_unicode_encode_string(config,input,chunk,output);
+    if ((res = psiconv_buffer_add_n(buf,output,len))) {
+      psiconv_error(config,lev,0,"Out of memory error");
+      return res;
+    }
+    input += chunk;
+    nr -= chunk;
+  }
+  return 0;
+}
+
 int psiconv_unicode_strlen(const psiconv_ucs2 *input)
 {
   int i = 0;
@@ -190,7 +380,7 @@ psiconv_ucs2 *psiconv_unicode_strdup(const psiconv_ucs2 *input)
   psiconv_ucs2 *output;
   int i = 0;
 
-  if (!(output = malloc(sizeof(*output) * 
+  if (!(output = psiconv_tree_malloc(sizeof(*output) * 
 	                 (1 + psiconv_unicode_strlen(input)))))
      return NULL;
   while ((output[i] = input[i]))
@@ -220,7 +410,7 @@ int psiconv_unicode_strcmp(const psiconv_ucs2 *str1, const psiconv_ucs2 *str2)
 psiconv_ucs2 *psiconv_unicode_empty_string(void)
 {
   psiconv_ucs2 *result;
-  result = malloc(sizeof(psiconv_ucs2));
+  result = psiconv_tree_malloc(sizeof(psiconv_ucs2));
   if (result)
     result[0] = 0;
   return result;
@@ -230,41 +420,329 @@ psiconv_ucs2 *psiconv_unicode_empty_string(void)
 psiconv_ucs2 *psiconv_unicode_from_list(psiconv_list input)
 {
   psiconv_ucs2 *result;
-  int i;
-  psiconv_ucs2 *character;
+  psiconv_u32 len = psiconv_list_length(input);
 
-  if (!(result = malloc(sizeof(psiconv_ucs2) * (psiconv_list_length(input)+1))))
-    goto ERROR1;
-  for (i = 0; i < psiconv_list_length(input); i++) {
-    if (!(character = psiconv_list_get(input,i)))
-      goto ERROR2;
-    result[i] = *character;
-  }
-  result[i] = 0;
+  if (!(result = psiconv_tree_malloc(sizeof(psiconv_ucs2) * (len+1))))
+    return NULL;
+  memcpy(result,psiconv_list_ucs2_data(input),sizeof(psiconv_ucs2) * len);
+  result[len] = 0;
   return result;
-
-ERROR2:
-  free(result);
-ERROR1:
-  return NULL;
 }
 
 
+/* Two-Way string matching (Crochemore and Perrin), with a skip on the last
+   character of the window. The skip table is indexed by the low byte of
+   each character; characters sharing a low byte share the smallest skip,
+   which is always safe. Runs in linear time and constant space. */
 psiconv_ucs2 *psiconv_unicode_strstr(const psiconv_ucs2 *haystack, 
                                      const psiconv_ucs2 *needle)
 {
-  int i,j,haystack_len,needle_len;
+  int haystack_len,needle_len,i,ip,jp,k,p,p0,ms,mem,mem0;
+  int shift[0x100];
+  const psiconv_ucs2 *h,*z;
+
   haystack_len = psiconv_unicode_strlen(haystack);
   needle_len = psiconv_unicode_strlen(needle);
+  if (needle_len == 0)
+    return (psiconv_ucs2 *) haystack;
+  if (needle_len > haystack_len)
+    return NULL;
+
+  /* shift[c] is one more than the last position of c in the needle,
+     or 0 if it does not occur at all */
+  memset(shift,0,sizeof(shift));
+  for (i = 0; i < needle_len; i++)
+    shift[needle[i] & 0xff] = i+1;
+
+  /* Compute the maximal suffix for both orderings; the longest one gives
+     the critical factorization */
+  ip = -1; jp = 0; k = p = 1;
+  while (jp+k < needle_len) {
+    if (needle[ip+k] == needle[jp+k]) {
+      if (k == p) {
+        jp += p;
+        k = 1;
+      } else
+        k++;
+    } else if (needle[ip+k] > needle[jp+k]) {
+      jp += k;
+      k = 1;
+      p = jp - ip;
+    } else {
+      ip = jp++;
+      k = p = 1;
+    }
+  }
+  ms = ip;
+  p0 = p;
+
+  ip = -1; jp = 0; k = p = 1;
+  while (jp+k < needle_len) {
+    if (needle[ip+k] == needle[jp+k]) {
+      if (k == p) {
+        jp += p;
+        k = 1;
+      } else
+        k++;
+    } else if (needle[ip+k] < needle[jp+k]) {
+      jp += k;
+      k = 1;
+      p = jp - ip;
+    } else {
+      ip = jp++;
+      k = p = 1;
+    }
+  }
+  if (ip > ms)
+    ms = ip;
+  else
+    p = p0;
+
+  /* If the needle is not periodic, we can not remember a matched prefix
+     between windows, but we can shift further */
+  if (memcmp(needle,needle+p,sizeof(*needle) * (ms+1))) {
+    mem0 = 0;
+    p = (ms > needle_len-ms-1 ? ms : needle_len-ms-1) + 1;
+  } else
+    mem0 = needle_len - p;
+  mem = 0;
+
+  z = haystack + haystack_len;
+  for (h = haystack; z - h >= needle_len; ) {
+    k = shift[h[needle_len-1] & 0xff];
+    if (!k) {
+      h += needle_len;
+      mem = 0;
+      continue;
+    }
+    k = needle_len - k;
+    if (k) {
+      if (k < mem)
+        k = mem;
+      h += k;
+      mem = 0;
+      continue;
+    }
+    /* Compare the right half */
+    for (k = ms+1 > mem ? ms+1 : mem; k < needle_len && needle[k] == h[k]; k++);
+    if (k < needle_len) {
+      h += k - ms;
+      mem = 0;
+      continue;
+    }
+    /* Compare the left half */
+    for (k = ms+1; k > mem && needle[k-1] == h[k-1]; k--);
+    if (k <= mem)
+      return (psiconv_ucs2 *) h;
+    h += p;
+    mem = mem0;
+  }
+  return NULL;
+}
+
+/* The matcher is an Aho-Corasick automaton. The outgoing edges of each state
+   are stored together in the edges array, sorted on character, so we can
+   use a binary search to follow them. */
+typedef struct psiconv_unicode_matcher_edge_s {
+  psiconv_ucs2 character;
+  int target;
+} psiconv_unicode_matcher_edge;
+
+typedef struct psiconv_unicode_matcher_state_s {
+  int first_edge;
+  int nr_edges;
+  int fail;     /* State for the longest proper suffix in the trie */
+  int needle;   /* First needle ending in this state, or -1 */
+  int output;   /* Nearest non-root state on the fail chain with a needle,
+                   or -1 */
+  int depth;
+} psiconv_unicode_matcher_state;
+
+struct psiconv_unicode_matcher_s {
+  int nr_needles;
+  int *next_needle;     /* Next needle equal to this one, or -1 */
+  psiconv_unicode_matcher_state *states;
+  psiconv_unicode_matcher_edge *edges;
+};
+
+static int psiconv_unicode_matcher_goto(const psiconv_unicode_matcher matcher,
+                                        int state, psiconv_ucs2 character)
+{
+  const psiconv_unicode_matcher_edge *edges;
+  int low,high,mid;
+
+  edges = matcher->edges + matcher->states[state].first_edge;
+  low = 0;
+  high = matcher->states[state].nr_edges;
+  while (low < high) {
+    mid = (low + high) / 2;
+    if (edges[mid].character < character)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if ((low < matcher->states[state].nr_edges) &&
+      (edges[low].character == character))
+    return edges[low].target;
+  return -1;
+}
 
+psiconv_unicode_matcher psiconv_unicode_matcher_new
+                                     (const psiconv_ucs2 * const *needles,
+                                      int nr_needles)
+{
+  psiconv_unicode_matcher matcher;
+  int nr_chars,nr_states,nr_edges,i,j,state,f,g,head,tail;
+  int *child,*sibling,*queue,*prev;
+  psiconv_ucs2 *label;
 
+  nr_chars = 0;
+  for (i = 0; i < nr_needles; i++)
+    nr_chars += psiconv_unicode_strlen(needles[i]);
 
-  for (i = 0; i < haystack_len - needle_len + 1; i++) {
-    for (j = 0; j < needle_len; j++) 
-      if (haystack[i+j] != needle[j])
-	break;
-    if (j == needle_len)
-      return (psiconv_ucs2 *) haystack+i;
+  if (!(matcher = malloc(sizeof(*matcher))))
+    goto ERROR1;
+  matcher->nr_needles = nr_needles;
+  if (!(matcher->next_needle = malloc(sizeof(*matcher->next_needle) *
+                                      (nr_needles + 1))))
+    goto ERROR2;
+  if (!(matcher->states = malloc(sizeof(*matcher->states) * (nr_chars + 1))))
+    goto ERROR3;
+  if (!(matcher->edges = malloc(sizeof(*matcher->edges) * (nr_chars + 1))))
+    goto ERROR4;
+  /* Temporary trie: children are kept in sibling lists sorted on label */
+  if (!(child = malloc(sizeof(*child) * 3 * (nr_chars + 1))))
+    goto ERROR5;
+  sibling = child + nr_chars + 1;
+  queue = sibling + nr_chars + 1;
+  if (!(label = malloc(sizeof(*label) * (nr_chars + 1))))
+    goto ERROR6;
+
+  nr_states = 1;
+  child[0] = -1;
+  matcher->states[0].needle = -1;
+  matcher->states[0].depth = 0;
+  for (i = 0; i < nr_needles; i++) {
+    state = 0;
+    for (j = 0; needles[i][j]; j++) {
+      prev = &child[state];
+      while ((*prev >= 0) && (label[*prev] < needles[i][j]))
+        prev = &sibling[*prev];
+      if ((*prev < 0) || (label[*prev] != needles[i][j])) {
+        label[nr_states] = needles[i][j];
+        child[nr_states] = -1;
+        sibling[nr_states] = *prev;
+        matcher->states[nr_states].needle = -1;
+        matcher->states[nr_states].depth = j + 1;
+        *prev = nr_states++;
+      }
+      state = *prev;
+    }
+    /* Equal needles are chained, in order */
+    matcher->next_needle[i] = -1;
+    if (matcher->states[state].needle < 0)
+      matcher->states[state].needle = i;
+    else {
+      for (f = matcher->states[state].needle; matcher->next_needle[f] >= 0;
+           f = matcher->next_needle[f]);
+      matcher->next_needle[f] = i;
+    }
+  }
+
+  nr_edges = 0;
+  for (state = 0; state < nr_states; state++) {
+    matcher->states[state].first_edge = nr_edges;
+    for (f = child[state]; f >= 0; f = sibling[f]) {
+      matcher->edges[nr_edges].character = label[f];
+      matcher->edges[nr_edges].target = f;
+      nr_edges++;
+    }
+    matcher->states[state].nr_edges = nr_edges -
+                                      matcher->states[state].first_edge;
   }
+
+  /* Breadth-first, so all fail links we need are already known */
+  matcher->states[0].fail = 0;
+  matcher->states[0].output = -1;
+  head = tail = 0;
+  queue[tail++] = 0;
+  while (head < tail) {
+    state = queue[head++];
+    for (i = 0; i < matcher->states[state].nr_edges; i++) {
+      j = matcher->edges[matcher->states[state].first_edge + i].target;
+      queue[tail++] = j;
+      g = -1;
+      if (state) {
+        for (f = matcher->states[state].fail;
+             ((g = psiconv_unicode_matcher_goto(matcher,f,label[j])) < 0) && f;
+             f = matcher->states[f].fail);
+      }
+      matcher->states[j].fail = g < 0 ? 0 : g;
+      f = matcher->states[j].fail;
+      if (f && (matcher->states[f].needle >= 0))
+        matcher->states[j].output = f;
+      else
+        matcher->states[j].output = matcher->states[f].output;
+    }
+  }
+
+  free(label);
+  free(child);
+  return matcher;
+
+ERROR6:
+  free(child);
+ERROR5:
+  free(matcher->edges);
+ERROR4:
+  free(matcher->states);
+ERROR3:
+  free(matcher->next_needle);
+ERROR2:
+  free(matcher);
+ERROR1:
   return NULL;
 }
+
+void psiconv_unicode_matcher_free(psiconv_unicode_matcher matcher)
+{
+  if (matcher) {
+    free(matcher->edges);
+    free(matcher->states);
+    free(matcher->next_needle);
+    free(matcher);
+  }
+}
+
+int psiconv_unicode_matcher_search(const psiconv_unicode_matcher matcher,
+                                   const psiconv_ucs2 *haystack,
+                                   int *positions)
+{
+  int i,n,state,next,out,found = 0;
+
+  for (n = 0; n < matcher->nr_needles; n++)
+    positions[n] = -1;
+  /* Empty needles match at the start */
+  for (n = matcher->states[0].needle; n >= 0; n = matcher->next_needle[n]) {
+    positions[n] = 0;
+    found++;
+  }
+
+  state = 0;
+  for (i = 0; haystack[i] && (found < matcher->nr_needles); i++) {
+    while (((next = psiconv_unicode_matcher_goto(matcher,state,
+                                                 haystack[i])) < 0) && state)
+      state = matcher->states[state].fail;
+    state = next < 0 ? 0 : next;
+    out = matcher->states[state].needle >= 0 ? state :
+                                              matcher->states[state].output;
+    for ( ; out > 0; out = matcher->states[out].output)
+      for (n = matcher->states[out].needle; n >= 0;
+           n = matcher->next_needle[n])
+        if (positions[n] < 0) {
+          positions[n] = i + 1 - matcher->states[out].depth;
+          found++;
+        }
+  }
+  return found;
+}
@@ -34,9 +34,22 @@ extern "C" {
    we assume a single Unicode codepoint corresponds with a single character.
    For EPOC, that should be enough */
 
+/* Select one of the built-in character sets: 0 for unicode (UTF-8),
+   1 for IBM codepage 1252. Returns 0 on success. */
 extern int psiconv_unicode_select_characterset(const psiconv_config config,
                                                int charset);
 
+/* Rebuild the table that translates unicode characters back to EPOC
+   characters. psiconv_unicode_select_characterset and psiconv_config_read
+   do this for you; if you change config->unicode_table yourself, call it
+   afterwards. Without it, every character is looked up by scanning
+   unicode_table. Returns 0 on success. */
+extern int psiconv_unicode_build_inverse(const psiconv_config config);
+
+/* Free the table built by psiconv_unicode_build_inverse. This is done by
+   psiconv_config_free. */
+extern void psiconv_unicode_free_inverse(const psiconv_config config);
+
 /* Translate a single character to a unicode character, using the
    translation tables in config */
 extern psiconv_ucs2 psiconv_unicode_read_char(const psiconv_config config,
@@ -45,11 +58,35 @@ extern psiconv_ucs2 psiconv_unicode_read_char(const psiconv_config config,
 					      int *length,
                                               int *status);
 
+/* Translate the len bytes at data to unicode characters in result, using
+   the translation tables in config. result must have room for len
+   characters; no terminating zero is added. Returns the number of
+   characters, or a negative error code if the bytes are not valid (for
+   example, if the last character is cut off). */
+extern int psiconv_unicode_decode(const psiconv_config config,
+                                  const psiconv_u8 *data, psiconv_u32 len,
+                                  psiconv_ucs2 *result);
+
 extern int psiconv_unicode_write_char(const psiconv_config config,
                                                psiconv_buffer buf,
 					       int lev,
 					       psiconv_ucs2 value);
 
+/* Translate the nr unicode characters at input to EPOC characters in
+   output, using the translation tables in config. output must have room
+   for 3 * nr bytes (or just nr bytes if config->unicode is not set).
+   Returns the number of bytes written. */
+extern psiconv_u32 psiconv_unicode_encode_string(const psiconv_config config,
+                                                 const psiconv_ucs2 *input,
+                                                 psiconv_u32 nr,
+                                                 psiconv_u8 *output);
+
+/* Translate the nr unicode characters at input and add them to buf */
+extern int psiconv_unicode_write_string(const psiconv_config config,
+                                        psiconv_buffer buf, int lev,
+                                        const psiconv_ucs2 *input,
+                                        psiconv_u32 nr);
+
 
 /* Compute the length of a unicode string */
 extern int psiconv_unicode_strlen(const psiconv_ucs2 *input);
@@ -66,10 +103,33 @@ extern psiconv_ucs2 *psiconv_unicode_empty_string(void);
 /* Convert a psiconv_list of psiconv_ucs2 characters to a string */
 extern psiconv_ucs2 *psiconv_unicode_from_list(psiconv_list input);
 
-/* Look for needle in haystack, return pointer to found location */
+/* Look for needle in haystack, return pointer to found location.
+   Runs in time linear in the length of both strings. */
 extern psiconv_ucs2 *psiconv_unicode_strstr(const psiconv_ucs2 *haystack,
                                             const psiconv_ucs2 *needle);
 
+/* A psiconv_unicode_matcher looks for a whole set of needles at once,
+   in a single pass over the haystack. */
+typedef struct psiconv_unicode_matcher_s *psiconv_unicode_matcher;
+
+/* Create a matcher for nr_needles needles. The needles are copied and
+   may be freed afterwards. Returns NULL when not enough memory is
+   available. */
+extern psiconv_unicode_matcher psiconv_unicode_matcher_new
+                                     (const psiconv_ucs2 * const *needles,
+                                      int nr_needles);
+
+/* Free a matcher */
+extern void psiconv_unicode_matcher_free(psiconv_unicode_matcher matcher);
+
+/* Search haystack for all needles of the matcher. positions must have
+   room for one int per needle; it is filled with the offset of the first
+   occurrence of each needle, or -1 if it does not occur. Returns the
+   number of needles found. */
+extern int psiconv_unicode_matcher_search(const psiconv_unicode_matcher matcher,
+                                          const psiconv_ucs2 *haystack,
+                                          int *positions);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,164 @@
+/*
+    resolvebench.c - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* Time psiconv_buffer_resolve on buffers with more and more targets and
+   references, and compare it with walking all targets for each reference,
+   which is how references used to be resolved. Each reference refers to a
+   random target, in front of or behind it. All resolved references are
+   checked as well. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <psiconv/buffer.h>
+
+#define DEFAULT_MAX 32000
+
+typedef struct bench_reloc_s {
+  psiconv_u32 offset;
+  psiconv_u32 id;
+} bench_reloc;
+
+static double seconds(clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* Returns 0 if all references point to their target */
+static int check(const psiconv_buffer buf, const bench_reloc *targets,
+                 const bench_reloc *refs, const int *ref_target, int nr)
+{
+  const psiconv_u8 *data;
+  psiconv_u32 value;
+  int i;
+
+  for (i = 0; i < nr; i++) {
+    if (!(data = psiconv_buffer_span(buf,refs[i].offset,4)))
+      return 1;
+    value = data[0] | (data[1] << 8) | (data[2] << 16) |
+            ((psiconv_u32) data[3] << 24);
+    if (value != targets[ref_target[i]].offset)
+      return 1;
+  }
+  return 0;
+}
+
+/* The old way: walk the targets until the id matches */
+static psiconv_u32 naive(const bench_reloc *targets,
+                         const bench_reloc *refs, int nr)
+{
+  psiconv_u32 sum = 0;
+  int i,j;
+
+  for (i = 0; i < nr; i++)
+    for (j = 0; j < nr; j++)
+      if (targets[j].id == refs[i].id) {
+        sum += targets[j].offset;
+        break;
+      }
+  return sum;
+}
+
+/* Returns 0 on success */
+static int bench(int nr, int with_naive)
+{
+  psiconv_buffer buf;
+  bench_reloc *targets,*refs;
+  int *ref_target;
+  int i,res;
+  clock_t start;
+  double resolve_time,naive_time = 0.0;
+  psiconv_u32 sum = 0;
+
+  targets = malloc(nr * sizeof(*targets));
+  refs = malloc(nr * sizeof(*refs));
+  ref_target = malloc(nr * sizeof(*ref_target));
+  if (!targets || !refs || !ref_target || !(buf = psiconv_buffer_new())) {
+    fprintf(stderr,"Out of memory\n");
+    exit(1);
+  }
+
+  for (i = 0; i < nr; i++)
+    targets[i].id = psiconv_buffer_unique_id();
+  for (i = 0; i < nr; i++) {
+    ref_target[i] = rand() % nr;
+    refs[i].id = targets[ref_target[i]].id;
+  }
+  /* Alternate targets and references, with some data in between */
+  for (i = 0; i < nr; i++) {
+    targets[i].offset = psiconv_buffer_length(buf);
+    refs[i].offset = targets[i].offset + 1;
+    if (psiconv_buffer_add_target(buf,targets[i].id) ||
+        psiconv_buffer_add(buf,i & 0xff) ||
+        psiconv_buffer_add_reference(buf,refs[i].id) ||
+        psiconv_buffer_add(buf,0x55)) {
+      fprintf(stderr,"Out of memory\n");
+      exit(1);
+    }
+  }
+
+  start = clock();
+  res = psiconv_buffer_resolve(buf);
+  resolve_time = seconds(start);
+  if (res)
+    fprintf(stderr,"%d targets: resolve failed\n",nr);
+  else if ((res = check(buf,targets,refs,ref_target,nr)))
+    fprintf(stderr,"%d targets: wrong reference\n",nr);
+
+  if (with_naive) {
+    for (i = 0; i < nr; i++)
+      sum += targets[ref_target[i]].offset;
+    start = clock();
+    if (naive(targets,refs,nr) != sum) {
+      fprintf(stderr,"%d targets: naive walk failed\n",nr);
+      res = 1;
+    }
+    naive_time = seconds(start);
+    printf("%8d %12.3f %12.3f %10.1f\n",nr,resolve_time * 1000,
+           naive_time * 1000,resolve_time * 1e9 / nr);
+  } else
+    printf("%8d %12.3f %12s %10.1f\n",nr,resolve_time * 1000,"-",
+           resolve_time * 1e9 / nr);
+
+  psiconv_buffer_free(buf);
+  free(ref_target);
+  free(refs);
+  free(targets);
+  return res;
+}
+
+int main(int argc, char *argv[])
+{
+  int max = DEFAULT_MAX;
+  int nr,failed = 0;
+
+  if ((argc > 2) || ((argc == 2) && ((max = atoi(argv[1])) < 1))) {
+    fprintf(stderr,"Syntax: [MAX_TARGETS]\n");
+    exit(1);
+  }
+
+  srand(1);
+  printf("%8s %12s %12s %10s\n","targets","resolve (ms)","naive (ms)",
+         "ns/ref");
+  /* The naive walk gets slow quickly; only time it for smaller sizes */
+  for (nr = 1000; nr <= max; nr *= 2)
+    failed |= bench(nr,nr <= DEFAULT_MAX);
+  exit(failed?1:0);
+}
@@ -42,19 +42,10 @@ int main(int argc, char *argv[])
   config = psiconv_config_default();
   psiconv_config_read(NULL,&config);
 
-  if (!(fp = fopen(argv[1],"r"))) {
-    perror("Can't open file");
-    exit(1);
-  }
-  if (!(buf=psiconv_buffer_new())) {
-    perror("Can't allocate buf");
+  if (!(buf = psiconv_buffer_map_file(argv[1]))) {
+    perror("Can't read file");
     exit(1);
   }
-  if ((psiconv_buffer_fread_all(buf,fp))) {
-    perror("Can't fread file");
-    exit(1);
-  }
-  fclose(fp);
   if ((psiconv_parse(config,buf,&psionfile))) {
     fprintf(stderr,"Parse error\n");
     exit(1);
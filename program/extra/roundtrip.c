@@ -0,0 +1,506 @@
+/*
+    roundtrip.c - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* Write pictures at the direct color depths and check that they read back
+   unchanged. The colors are chosen so every depth can store them exactly;
+   both long runs and single pixels are used, so the RLE encoders as well
+   as the uncompressed layout are tried.
+   The palet depths are tried with random colors: without dither, every
+   pixel must read back as its nearest palet color; with dither, every
+   pixel must still read back as some palet color.
+   Finally, every depth is decoded, in greyscale and in color, both
+   through the lookup tables and pixel by pixel, and the results are
+   compared with psiconv_pixel_to_floats. */
+
+#include <psiconv/parse.h>
+#include <psiconv/generate.h>
+#include <psiconv/configuration.h>
+#include <psiconv/image.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static const struct {
+  int colordepth,redbits,greenbits,bluebits;
+} depths[] = { {12,4,4,4}, {16,6,6,4}, {24,8,8,8} };
+
+static const int palet_depths[] = { 4, 8 };
+
+static const struct {
+  int colordepth,color;
+} decode_depths[] = { {2,0}, {4,0}, {8,0}, {12,0}, {16,0}, {24,0},
+                      {2,1}, {4,1}, {8,1}, {12,1}, {16,1}, {24,1} };
+
+/* The number of pixels in the small pictures, which are decoded pixel by
+   pixel; and in the large pictures for depths that never get a table */
+#define DECODE_SMALL 37
+#define DECODE_LARGE 4096
+
+/* Odd widths leave padding at the end of each line */
+static const int widths[] = { 37, 40 };
+
+#define HEIGHT 9
+
+#define CLOSE(a,b) (((a) - (b) < 0.001) && ((b) - (a) < 0.001))
+
+static float channel(int x, int y, int offset, int bits)
+{
+  int max = (1 << bits) - 1;
+
+  /* The first line is a single run */
+  if (y == 0)
+    return (float) (offset % (max + 1)) / max;
+  return (float) ((x / 3 + 7 * y + offset) % (max + 1)) / max;
+}
+
+/* Use redbits 0 for random colors */
+static psiconv_file make_picture(int xsize, int redbits, int greenbits,
+                                 int bluebits)
+{
+  psiconv_file file;
+  struct psiconv_paint_data_section_s picture;
+  int x,y;
+
+  if (!(file = psiconv_empty_file(psiconv_mbm_file)))
+    return NULL;
+  picture.xsize = xsize;
+  picture.ysize = HEIGHT;
+  picture.pic_xsize = 0;
+  picture.pic_ysize = 0;
+  picture.rgb = NULL;
+  picture.red = malloc(xsize * HEIGHT * sizeof(float));
+  picture.green = malloc(xsize * HEIGHT * sizeof(float));
+  picture.blue = malloc(xsize * HEIGHT * sizeof(float));
+  if (!picture.red || !picture.green || !picture.blue)
+    return NULL;
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < xsize; x++)
+      if (!redbits) {
+        picture.red[y*xsize+x] = (float) rand() / RAND_MAX;
+        picture.green[y*xsize+x] = (float) rand() / RAND_MAX;
+        picture.blue[y*xsize+x] = (float) rand() / RAND_MAX;
+      } else {
+        picture.red[y*xsize+x] = channel(x,y,1,redbits);
+        picture.green[y*xsize+x] = channel(x,y,5,greenbits);
+        picture.blue[y*xsize+x] = channel(x,y,11,bluebits);
+      }
+  if (psiconv_list_add(((psiconv_mbm_f) file->file)->sections,&picture))
+    return NULL;
+  return file;
+}
+
+static int same_picture(const psiconv_paint_data_section a,
+                        const psiconv_paint_data_section b)
+{
+  int i;
+
+  if ((a->xsize != b->xsize) || (a->ysize != b->ysize))
+    return 0;
+  for (i = 0; i < a->xsize * a->ysize; i++)
+    if (!CLOSE(a->red[i],b->red[i]) || !CLOSE(a->green[i],b->green[i]) ||
+        !CLOSE(a->blue[i],b->blue[i]))
+      return 0;
+  return 1;
+}
+
+/* Returns 1 if pixel i of b is the palet color nearest to pixel i of a,
+   which is found by searching the whole palet */
+static int nearest_color(const psiconv_paint_data_section a,
+                         const psiconv_paint_data_section b, int i,
+                         const psiconv_pixel_floats_t palet)
+{
+  float dist,new_dist;
+  int j,nearest = 0;
+
+  dist = 4;
+  for (j = 0; j < palet.length; j++) {
+    new_dist = (a->red[i] - palet.red[j]) * (a->red[i] - palet.red[j]) +
+               (a->green[i] - palet.green[j]) * (a->green[i] - palet.green[j]) +
+               (a->blue[i] - palet.blue[j]) * (a->blue[i] - palet.blue[j]);
+    if (new_dist < dist) {
+      nearest = j;
+      dist = new_dist;
+    }
+  }
+  return CLOSE(b->red[i],palet.red[nearest]) &&
+         CLOSE(b->green[i],palet.green[nearest]) &&
+         CLOSE(b->blue[i],palet.blue[nearest]);
+}
+
+/* Returns 1 if pixel i of b is a palet color */
+static int in_palet(const psiconv_paint_data_section b, int i,
+                    const psiconv_pixel_floats_t palet)
+{
+  int j;
+
+  for (j = 0; j < palet.length; j++)
+    if (CLOSE(b->red[i],palet.red[j]) && CLOSE(b->green[i],palet.green[j]) &&
+        CLOSE(b->blue[i],palet.blue[j]))
+      return 1;
+  return 0;
+}
+
+/* Without dither, every pixel of b must be the palet color nearest to
+   that pixel of a; with dither, it must just be a palet color */
+static int palet_picture(const psiconv_paint_data_section a,
+                         const psiconv_paint_data_section b,
+                         const psiconv_pixel_floats_t palet,
+                         psiconv_bool_t dither)
+{
+  int i;
+
+  if ((a->xsize != b->xsize) || (a->ysize != b->ysize))
+    return 0;
+  for (i = 0; i < a->xsize * a->ysize; i++)
+    if (dither?!in_palet(b,i,palet):!nearest_color(a,b,i,palet))
+      return 0;
+  return 1;
+}
+
+/* Without a palet, the pictures must be the same */
+static int same_file(const psiconv_file a, const psiconv_file b,
+                     const psiconv_pixel_floats_t palet, psiconv_bool_t dither)
+{
+  psiconv_pictures a_sections,b_sections;
+  int i;
+
+  if ((a->type != psiconv_mbm_file) || (b->type != psiconv_mbm_file))
+    return 0;
+  a_sections = ((psiconv_mbm_f) a->file)->sections;
+  b_sections = ((psiconv_mbm_f) b->file)->sections;
+  if (psiconv_list_length(a_sections) != psiconv_list_length(b_sections))
+    return 0;
+  for (i = 0; i < psiconv_list_length(a_sections); i++)
+    if (palet.length?
+        !palet_picture(psiconv_list_get(a_sections,i),
+                       psiconv_list_get(b_sections,i),palet,dither):
+        !same_picture(psiconv_list_get(a_sections,i),
+                      psiconv_list_get(b_sections,i)))
+      return 0;
+  return 1;
+}
+
+/* Returns 0 if the picture reads back unchanged, or for palet depths,
+   as the right palet colors */
+static int roundtrip(psiconv_config config, int xsize)
+{
+  psiconv_file file,reread = NULL;
+  psiconv_buffer buf = NULL;
+  psiconv_pixel_floats_t palet = psiconv_palet_none;
+  int res = 1;
+
+  if (!config->redbits)
+    palet = config->colordepth == 4?psiconv_palet_color_4:
+                                    psiconv_palet_color_8;
+  if (!(file = make_picture(xsize,config->redbits,config->greenbits,
+                            config->bluebits))) {
+    fprintf(stderr,"Out of memory\n");
+    exit(1);
+  }
+  if (psiconv_write(config,&buf,file))
+    fprintf(stderr,"%d bits, %d pixels wide: generate error\n",
+            config->colordepth,xsize);
+  else if (psiconv_parse(config,buf,&reread)) {
+    fprintf(stderr,"%d bits, %d pixels wide: parse error\n",
+            config->colordepth,xsize);
+    reread = NULL;
+  }
+  else if (!same_file(file,reread,palet,config->dither))
+    fprintf(stderr,"%d bits, %d pixels wide, dither %d: picture changed\n",
+            config->colordepth,xsize,config->dither);
+  else
+    res = 0;
+
+  if (reread)
+    psiconv_free_file(reread);
+  if (buf)
+    psiconv_buffer_free(buf);
+  psiconv_free_file(file);
+  return res;
+}
+
+/* The pixel value the generator gives a grey level; see
+   psiconv_collect_pixel_data */
+static psiconv_u32 grey_pixel(float grey, int colordepth)
+{
+  return (0.212671 * grey + 0.715160 * grey + 0.072169 * grey) *
+         ((1 << colordepth) * 0.999);
+}
+
+/* The last picture of an MBM file; the first one is the empty picture
+   every new MBM file starts with */
+static psiconv_paint_data_section last_picture(const psiconv_file file)
+{
+  psiconv_pictures sections = ((psiconv_mbm_f) file->file)->sections;
+
+  return psiconv_list_get(sections,psiconv_list_length(sections) - 1);
+}
+
+/* Make a picture of nr pixels, and store the pixel value the generator
+   gives each of them. If there is room for all pixel values, they are all
+   used in order; otherwise they are chosen at random. */
+static psiconv_file make_pixels(const psiconv_config config, int nr,
+                                const psiconv_pixel_floats_t palet,
+                                psiconv_u32 *pixels)
+{
+  psiconv_file file;
+  struct psiconv_paint_data_section_s picture;
+  psiconv_u32 max = (psiconv_u32) 1 << config->colordepth;
+  float grey;
+  int i;
+
+  if (!(file = psiconv_empty_file(psiconv_mbm_file)))
+    return NULL;
+  picture.xsize = nr < 64 ? nr : 64;
+  picture.ysize = nr / picture.xsize;
+  picture.pic_xsize = 0;
+  picture.pic_ysize = 0;
+  picture.rgb = NULL;
+  picture.red = malloc(nr * sizeof(float));
+  picture.green = malloc(nr * sizeof(float));
+  picture.blue = malloc(nr * sizeof(float));
+  if (!picture.red || !picture.green || !picture.blue)
+    return NULL;
+  for (i = 0; i < nr; i++) {
+    pixels[i] = nr >= max ? i : rand() % max;
+    if (palet.length)
+      pixels[i] %= palet.length;
+    if (config->color)
+      psiconv_pixel_to_floats(pixels[i],config->colordepth,1,
+                              config->redbits,config->bluebits,
+                              config->greenbits,&palet,&picture.red[i],
+                              &picture.green[i],&picture.blue[i]);
+    else {
+      grey = (float) pixels[i] / (max - 1);
+      pixels[i] = grey_pixel(grey,config->colordepth);
+      picture.red[i] = picture.green[i] = picture.blue[i] = grey;
+    }
+  }
+  if (psiconv_list_add(((psiconv_mbm_f) file->file)->sections,&picture))
+    return NULL;
+  return file;
+}
+
+/* Returns 1 if every pixel of picture, either as floats or packed, is
+   what psiconv_pixel_to_floats makes of its pixel value */
+static int decoded(const psiconv_config config,
+                   const psiconv_paint_data_section picture,
+                   const psiconv_u32 *pixels, int nr,
+                   const psiconv_pixel_floats_t palet)
+{
+  float red,green,blue;
+  int i;
+
+  if (picture->xsize * picture->ysize != nr)
+    return 0;
+  for (i = 0; i < nr; i++) {
+    psiconv_pixel_to_floats(pixels[i],config->colordepth,config->color,
+                            config->redbits,config->bluebits,
+                            config->greenbits,&palet,&red,&green,&blue);
+    if (picture->rgb) {
+      if ((picture->rgb[3*i] != (psiconv_u8) (red * 255 + 0.5)) ||
+          (picture->rgb[3*i+1] != (psiconv_u8) (green * 255 + 0.5)) ||
+          (picture->rgb[3*i+2] != (psiconv_u8) (blue * 255 + 0.5)))
+        return 0;
+    } else if ((picture->red[i] != red) || (picture->green[i] != green) ||
+               (picture->blue[i] != blue))
+      return 0;
+  }
+  return 1;
+}
+
+/* A new file with the colors of a packed picture, as floats */
+static psiconv_file unpacked_copy(const psiconv_paint_data_section packed)
+{
+  psiconv_file file;
+  struct psiconv_paint_data_section_s picture;
+  int i,nr = packed->xsize * packed->ysize;
+
+  if (!(file = psiconv_empty_file(psiconv_mbm_file)))
+    return NULL;
+  picture = *packed;
+  picture.rgb = NULL;
+  picture.red = malloc(nr * sizeof(float));
+  picture.green = malloc(nr * sizeof(float));
+  picture.blue = malloc(nr * sizeof(float));
+  if (!picture.red || !picture.green || !picture.blue)
+    return NULL;
+  for (i = 0; i < nr; i++)
+    psiconv_paint_data_get_floats(packed,i,&picture.red[i],&picture.green[i],
+                                  &picture.blue[i]);
+  if (psiconv_list_add(((psiconv_mbm_f) file->file)->sections,&picture))
+    return NULL;
+  return file;
+}
+
+/* Returns 1 if writing the packed picture of file, which is done with a
+   table for each color channel, gives buf; buf holds the same colors,
+   written as floats */
+static int same_packed_write(const psiconv_config config,
+                             const psiconv_file file,
+                             const psiconv_buffer buf)
+{
+  psiconv_buffer packed_buf;
+  psiconv_u32 len;
+  int res;
+
+  if (psiconv_write(config,&packed_buf,file))
+    return 0;
+  len = psiconv_buffer_length(buf);
+  res = (psiconv_buffer_length(packed_buf) == len) &&
+        !memcmp(psiconv_buffer_span(packed_buf,0,len),
+                psiconv_buffer_span(buf,0,len),len);
+  psiconv_buffer_free(packed_buf);
+  return res;
+}
+
+/* Write a picture of nr pixels and read it back, as floats and packed.
+   Pictures with at least as many pixels as there are pixel values are
+   decoded through a lookup table, smaller ones pixel by pixel. Returns 0
+   if every pixel is decoded right. */
+static int decode(psiconv_config config, int nr)
+{
+  psiconv_file file,floats = NULL,packed = NULL,repacked = NULL;
+  psiconv_buffer buf = NULL,rebuf = NULL;
+  psiconv_pixel_floats_t palet = psiconv_palet_none;
+  psiconv_u32 *pixels;
+  int res = 1;
+
+  if (config->color && !config->redbits)
+    palet = config->colordepth == 4?psiconv_palet_color_4:
+                                    psiconv_palet_color_8;
+  if (!(pixels = malloc(nr * sizeof(*pixels))) ||
+      !(file = make_pixels(config,nr,palet,pixels))) {
+    fprintf(stderr,"Out of memory\n");
+    exit(1);
+  }
+
+  config->packed_pixels = psiconv_bool_false;
+  if (psiconv_write(config,&buf,file)) {
+    fprintf(stderr,"%d bits, color %d, %d pixels: generate error\n",
+            config->colordepth,config->color,nr);
+    buf = NULL;
+    goto DONE;
+  }
+  if (psiconv_parse(config,buf,&floats)) {
+    fprintf(stderr,"%d bits, color %d, %d pixels: parse error\n",
+            config->colordepth,config->color,nr);
+    floats = NULL;
+    goto DONE;
+  }
+  config->packed_pixels = psiconv_bool_true;
+  if (psiconv_parse(config,buf,&packed)) {
+    fprintf(stderr,"%d bits, color %d, %d pixels: packed parse error\n",
+            config->colordepth,config->color,nr);
+    packed = NULL;
+    goto DONE;
+  }
+  if (!decoded(config,last_picture(floats),pixels,nr,palet) ||
+      !decoded(config,last_picture(packed),pixels,nr,palet)) {
+    fprintf(stderr,"%d bits, color %d, %d pixels: decoded wrong\n",
+            config->colordepth,config->color,nr);
+    goto DONE;
+  }
+
+  if (!(repacked = unpacked_copy(last_picture(packed)))) {
+    fprintf(stderr,"Out of memory\n");
+    exit(1);
+  }
+  if (psiconv_write(config,&rebuf,repacked)) {
+    fprintf(stderr,"%d bits, color %d, %d pixels: generate error\n",
+            config->colordepth,config->color,nr);
+    rebuf = NULL;
+    goto DONE;
+  }
+  if (!same_packed_write(config,packed,rebuf)) {
+    fprintf(stderr,"%d bits, color %d, %d pixels: packed picture written "
+            "differently\n",config->colordepth,config->color,nr);
+    goto DONE;
+  }
+  res = 0;
+
+DONE:
+  if (rebuf)
+    psiconv_buffer_free(rebuf);
+  if (repacked)
+    psiconv_free_file(repacked);
+  if (packed)
+    psiconv_free_file(packed);
+  if (floats)
+    psiconv_free_file(floats);
+  if (buf)
+    psiconv_buffer_free(buf);
+  psiconv_free_file(file);
+  free(pixels);
+  return res;
+}
+
+int main(int argc, char *argv[])
+{
+  psiconv_config config;
+  int d,w,failed = 0;
+  psiconv_bool_t dither;
+
+  config = psiconv_config_default();
+  config->verbosity = PSICONV_VERB_ERROR;
+  config->color = 1;
+  config->dither = psiconv_bool_false;
+
+  for (d = 0; d < sizeof(depths) / sizeof(depths[0]); d++)
+    for (w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+      config->colordepth = depths[d].colordepth;
+      config->redbits = depths[d].redbits;
+      config->greenbits = depths[d].greenbits;
+      config->bluebits = depths[d].bluebits;
+      failed += roundtrip(config,widths[w]);
+    }
+
+  config->redbits = config->greenbits = config->bluebits = 0;
+  srand(1);
+  for (d = 0; d < sizeof(palet_depths) / sizeof(palet_depths[0]); d++)
+    for (dither = psiconv_bool_false; dither <= psiconv_bool_true; dither++)
+      for (w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        config->colordepth = palet_depths[d];
+        config->dither = dither;
+        failed += roundtrip(config,widths[w]);
+      }
+
+  config->dither = psiconv_bool_false;
+  for (d = 0; d < sizeof(decode_depths) / sizeof(decode_depths[0]); d++) {
+    config->colordepth = decode_depths[d].colordepth;
+    config->color = decode_depths[d].color;
+    /* The parser always uses these bits, or a palet at 4 and 8 bits */
+    config->redbits = config->greenbits = config->bluebits = 0;
+    if (config->color && (config->colordepth != 4) &&
+        (config->colordepth != 8)) {
+      config->redbits = config->greenbits = (config->colordepth + 2) / 3;
+      config->bluebits = config->colordepth - 2 * config->redbits;
+    }
+    if (config->colordepth <= PSICONV_PIXEL_LUT_MAX_DEPTH) {
+      failed += decode(config,1 << config->colordepth);
+      failed += decode(config,DECODE_SMALL < (1 << config->colordepth)?
+                              DECODE_SMALL:(1 << config->colordepth) - 1);
+    } else
+      failed += decode(config,DECODE_LARGE);
+  }
+
+  psiconv_config_free(config);
+  exit(failed?1:0);
+}
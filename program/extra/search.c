@@ -0,0 +1,158 @@
+/*
+    search.c - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* Compare psiconv_unicode_strstr and psiconv_unicode_matcher_search with
+   a naive search on random strings. The alphabets are small, so there are
+   many partial matches and periodic needles; some characters only differ
+   in their high byte, so they share a slot in the skip table. */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <psiconv/unicode.h>
+
+#define ROUNDS 20000
+#define MAX_HAYSTACK 300
+#define MAX_NEEDLE 12
+#define MAX_NEEDLES 8
+
+static const psiconv_ucs2 alphabet[] = { 'a', 'b', 0x161, 'c', 0x263, 'd' };
+
+/* The naive search, which is how psiconv_unicode_strstr used to work */
+static int naive(const psiconv_ucs2 *haystack, const psiconv_ucs2 *needle)
+{
+  int i,j;
+
+  for (i = 0; !i || haystack[i-1]; i++) {
+    for (j = 0; needle[j] && (haystack[i+j] == needle[j]); j++);
+    if (!needle[j])
+      return i;
+  }
+  return -1;
+}
+
+static void random_string(psiconv_ucs2 *str, int len, int nr_letters)
+{
+  int i;
+
+  for (i = 0; i < len; i++)
+    str[i] = alphabet[rand() % nr_letters];
+  str[len] = 0;
+}
+
+/* Make a needle: random, a piece of the haystack, or periodic */
+static void random_needle(psiconv_ucs2 *needle, const psiconv_ucs2 *haystack,
+                          int haystack_len, int nr_letters)
+{
+  int len,start,period,i;
+
+  len = rand() % (MAX_NEEDLE + 1);
+  switch (rand() % 3) {
+    case 0:
+      random_string(needle,len,nr_letters);
+      break;
+    case 1:
+      if (len > haystack_len)
+        len = haystack_len;
+      start = rand() % (haystack_len - len + 1);
+      for (i = 0; i < len; i++)
+        needle[i] = haystack[start + i];
+      needle[len] = 0;
+      /* Sometimes change the last character, for a near miss */
+      if (len && !(rand() % 3))
+        needle[len - 1] = alphabet[rand() % nr_letters];
+      break;
+    default:
+      period = 1 + rand() % 3;
+      random_string(needle,period,nr_letters);
+      for (i = period; i < len; i++)
+        needle[i] = needle[i - period];
+      needle[len] = 0;
+  }
+}
+
+static void print_string(const char *name, const psiconv_ucs2 *str)
+{
+  fprintf(stderr,"  %s:",name);
+  while (*str)
+    fprintf(stderr," %x",*str++);
+  fprintf(stderr,"\n");
+}
+
+int main(int argc, char *argv[])
+{
+  psiconv_ucs2 haystack[MAX_HAYSTACK + 1];
+  psiconv_ucs2 needles[MAX_NEEDLES][MAX_NEEDLE + 1];
+  const psiconv_ucs2 *needle_ptrs[MAX_NEEDLES];
+  int positions[MAX_NEEDLES];
+  psiconv_unicode_matcher matcher;
+  const psiconv_ucs2 *result;
+  int round,len,nr_letters,nr_needles,expected,found,i,failed = 0;
+
+  srand(1);
+  for (round = 0; (round < ROUNDS) && !failed; round++) {
+    nr_letters = 2 + rand() % (sizeof(alphabet) / sizeof(alphabet[0]) - 1);
+    len = rand() % (MAX_HAYSTACK + 1);
+    random_string(haystack,len,nr_letters);
+    nr_needles = 1 + rand() % MAX_NEEDLES;
+    for (i = 0; i < nr_needles; i++) {
+      random_needle(needles[i],haystack,len,nr_letters);
+      needle_ptrs[i] = needles[i];
+    }
+
+    for (i = 0; i < nr_needles; i++) {
+      result = psiconv_unicode_strstr(haystack,needles[i]);
+      expected = naive(haystack,needles[i]);
+      if ((result ? result - haystack : -1) != expected) {
+        fprintf(stderr,"psiconv_unicode_strstr: found %d, expected %d\n",
+                result ? (int) (result - haystack) : -1,expected);
+        print_string("haystack",haystack);
+        print_string("needle",needles[i]);
+        failed = 1;
+      }
+    }
+
+    if (!(matcher = psiconv_unicode_matcher_new(needle_ptrs,nr_needles))) {
+      fprintf(stderr,"Out of memory\n");
+      exit(1);
+    }
+    found = psiconv_unicode_matcher_search(matcher,haystack,positions);
+    expected = 0;
+    for (i = 0; i < nr_needles; i++) {
+      if (positions[i] != naive(haystack,needles[i])) {
+        fprintf(stderr,"psiconv_unicode_matcher_search: needle %d found "
+                "at %d, expected %d\n",i,positions[i],
+                naive(haystack,needles[i]));
+        print_string("haystack",haystack);
+        print_string("needle",needles[i]);
+        failed = 1;
+      }
+      if (positions[i] >= 0)
+        expected++;
+    }
+    if (found != expected) {
+      fprintf(stderr,"psiconv_unicode_matcher_search: found %d needles, "
+              "expected %d\n",found,expected);
+      failed = 1;
+    }
+    psiconv_unicode_matcher_free(matcher);
+  }
+
+  exit(failed?1:0);
+}
@@ -0,0 +1,194 @@
+/*
+    searchbench.c - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* Time searches in long paragraphs. For each paragraph length, three
+   cases are timed:
+     text:    a paragraph of random words, and a word that is probably
+              not in it;
+     repeat:  a paragraph of one repeated character, and a needle that
+              almost matches everywhere (the worst case for a naive
+              search);
+     needles: a paragraph of random words and NR_NEEDLES words, about
+              half of which occur in it, searched with one matcher or
+              with a psiconv_unicode_strstr per needle.
+   The first column of times is the old way: a naive search (which is how
+   psiconv_unicode_strstr used to work), or one psiconv_unicode_strstr per
+   needle. The second column is psiconv_unicode_strstr or the matcher. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <psiconv/unicode.h>
+
+#define DEFAULT_MAX 1000000
+#define NR_WORDS 200
+#define NR_NEEDLES 16
+#define REPEAT_NEEDLE 64
+
+/* Each measurement is repeated until it took at least this long */
+#define MIN_TIME 0.2
+
+static psiconv_ucs2 words[NR_WORDS][10];
+
+static const psiconv_ucs2 *naive(const psiconv_ucs2 *haystack,
+                                 const psiconv_ucs2 *needle)
+{
+  int i,j,haystack_len,needle_len;
+
+  haystack_len = psiconv_unicode_strlen(haystack);
+  needle_len = psiconv_unicode_strlen(needle);
+  for (i = 0; i < haystack_len - needle_len + 1; i++) {
+    for (j = 0; j < needle_len; j++)
+      if (haystack[i+j] != needle[j])
+        break;
+    if (j == needle_len)
+      return haystack + i;
+  }
+  return NULL;
+}
+
+static void make_words(void)
+{
+  int i,j,len;
+
+  for (i = 0; i < NR_WORDS; i++) {
+    len = 2 + rand() % 8;
+    for (j = 0; j < len; j++)
+      words[i][j] = 'a' + rand() % 26;
+    words[i][len] = 0;
+  }
+}
+
+/* A paragraph of len characters, made of words [0,nr_words) */
+static void make_text(psiconv_ucs2 *text, int len, int nr_words)
+{
+  const psiconv_ucs2 *word;
+  int pos = 0;
+
+  while (pos < len) {
+    for (word = words[rand() % nr_words]; *word && (pos < len); word++)
+      text[pos++] = *word;
+    if (pos < len)
+      text[pos++] = ' ';
+  }
+  text[len] = 0;
+}
+
+/* Seconds per search: the search is done until MIN_TIME has passed */
+#define TIME(result,search) do {                                   \
+    clock_t start = clock();                                      \
+    int reps = 0;                                                 \
+    do {                                                          \
+      search;                                                     \
+      reps++;                                                     \
+    } while ((clock() - start) < MIN_TIME * CLOCKS_PER_SEC);      \
+    result = (double) (clock() - start) / CLOCKS_PER_SEC / reps;  \
+  } while (0)
+
+/* Returns 0 if both searches agree */
+static int bench_one(const char *name, int len, const psiconv_ucs2 *haystack,
+                     const psiconv_ucs2 *needle)
+{
+  const psiconv_ucs2 *fast,*slow;
+  double fast_time,slow_time;
+
+  TIME(slow_time,slow = naive(haystack,needle));
+  TIME(fast_time,fast = psiconv_unicode_strstr(haystack,needle));
+  printf("%8d %-8s %12.3f %12.3f\n",len,name,slow_time * 1000,
+         fast_time * 1000);
+  if (fast != slow) {
+    fprintf(stderr,"%d characters, %s: results differ\n",len,name);
+    return 1;
+  }
+  return 0;
+}
+
+static int bench_needles(int len, const psiconv_ucs2 *haystack)
+{
+  const psiconv_ucs2 *needles[NR_NEEDLES];
+  int positions[NR_NEEDLES];
+  psiconv_unicode_matcher matcher;
+  const psiconv_ucs2 *found;
+  double strstr_time,matcher_time;
+  int i,res = 0;
+
+  /* The text only uses the first half of the words */
+  for (i = 0; i < NR_NEEDLES; i++)
+    needles[i] = words[i * (NR_WORDS / NR_NEEDLES)];
+  if (!(matcher = psiconv_unicode_matcher_new(needles,NR_NEEDLES))) {
+    fprintf(stderr,"Out of memory\n");
+    exit(1);
+  }
+  TIME(strstr_time,for (i = 0; i < NR_NEEDLES; i++)
+                     found = psiconv_unicode_strstr(haystack,needles[i]));
+  TIME(matcher_time,psiconv_unicode_matcher_search(matcher,haystack,
+                                                   positions));
+  printf("%8d %-8s %12.3f %12.3f\n",len,"needles",strstr_time * 1000,
+         matcher_time * 1000);
+  for (i = 0; i < NR_NEEDLES; i++) {
+    found = psiconv_unicode_strstr(haystack,needles[i]);
+    if ((found ? found - haystack : -1) != positions[i]) {
+      fprintf(stderr,"%d characters, needles: results differ\n",len);
+      res = 1;
+    }
+  }
+  psiconv_unicode_matcher_free(matcher);
+  return res;
+}
+
+int main(int argc, char *argv[])
+{
+  psiconv_ucs2 *haystack;
+  psiconv_ucs2 needle[REPEAT_NEEDLE + 1];
+  int max = DEFAULT_MAX;
+  int len,i,failed = 0;
+
+  if ((argc > 2) || ((argc == 2) && ((max = atoi(argv[1])) < 1))) {
+    fprintf(stderr,"Syntax: [MAX_LENGTH]\n");
+    exit(1);
+  }
+  if (!(haystack = malloc((max + 1) * sizeof(*haystack)))) {
+    fprintf(stderr,"Out of memory\n");
+    exit(1);
+  }
+
+  srand(1);
+  make_words();
+  printf("%8s %-8s %12s %12s\n","length","case","old (ms)","new (ms)");
+  for (len = 1000; len <= max; len *= 10) {
+    make_text(haystack,len,NR_WORDS / 2);
+    /* A word from the second half, which probably does not occur */
+    failed |= bench_one("text",len,haystack,words[NR_WORDS - 1]);
+
+    for (i = 0; i < len; i++)
+      haystack[i] = 'a';
+    for (i = 0; i < REPEAT_NEEDLE; i++)
+      needle[i] = 'a';
+    needle[REPEAT_NEEDLE - 1] = 'b';
+    needle[REPEAT_NEEDLE] = 0;
+    failed |= bench_one("repeat",len,haystack,needle);
+
+    make_text(haystack,len,NR_WORDS / 2);
+    failed |= bench_needles(len,haystack);
+  }
+
+  free(haystack);
+  exit(failed?1:0);
+}
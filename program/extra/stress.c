@@ -0,0 +1,196 @@
+/*
+    stress.c - Part of psiconv, a PSION 5 file formats converter
+    Copyright (c) 2014  Frodo Looijaard <frodo@frodo.looijaard.name>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/* Parse and write every Psion file in a directory from several threads at
+   once, all sharing one configuration, and check that each thread gets
+   the same results as a single thread does. Files that can not be parsed
+   at all are skipped; files that can be parsed but not written (like
+   Sheet files) must fail to write in every thread. */
+
+#include <psiconv/parse.h>
+#include <psiconv/generate.h>
+#include <psiconv/configuration.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#define DEFAULT_THREADS 8
+#define ROUNDS 4
+
+typedef struct stress_file_s {
+  char *path;
+  psiconv_buffer written; /* What a single thread writes; NULL if it fails */
+} stress_file;
+
+typedef struct stress_thread_s {
+  pthread_t thread;
+  int nr;
+  int failed;
+} stress_thread;
+
+static psiconv_config config;
+static stress_file *files;
+static int nr_files;
+
+/* Parse path and write it again. Returns 0 on success, 1 if the file can
+   not be parsed and 2 if it can not be written. */
+static int convert(const char *path, psiconv_buffer *written)
+{
+  psiconv_buffer buf;
+  psiconv_file file;
+  int res;
+
+  *written = NULL;
+  if (!(buf = psiconv_buffer_map_file(path)))
+    return 1;
+  res = psiconv_parse(config,buf,&file);
+  psiconv_buffer_free(buf);
+  if (res)
+    return 1;
+  /* On failure, *written is left undefined and unallocated */
+  res = psiconv_write(config,written,file)?2:0;
+  psiconv_free_file(file);
+  if (res)
+    *written = NULL;
+  return res;
+}
+
+static int same_buffer(const psiconv_buffer a, const psiconv_buffer b)
+{
+  psiconv_u32 len;
+
+  if (!a || !b)
+    return a == b;
+  if ((len = psiconv_buffer_length(a)) != psiconv_buffer_length(b))
+    return 0;
+  return !len || !memcmp(psiconv_buffer_span(a,0,len),
+                         psiconv_buffer_span(b,0,len),len);
+}
+
+static void *stress(void *arg)
+{
+  stress_thread *thread = arg;
+  psiconv_buffer written;
+  int round,i;
+  stress_file *file;
+
+  for (round = 0; round < ROUNDS; round++)
+    /* Each thread starts at another file, so different files are
+       converted at the same time as well */
+    for (i = 0; i < nr_files; i++) {
+      file = files + (i + thread->nr) % nr_files;
+      if (convert(file->path,&written) == 1) {
+        fprintf(stderr,"Thread %d: %s: parse error\n",thread->nr,
+                file->path);
+        thread->failed = 1;
+      } else if (!same_buffer(written,file->written)) {
+        fprintf(stderr,"Thread %d: %s: written file differs\n",thread->nr,
+                file->path);
+        thread->failed = 1;
+      }
+      if (written)
+        psiconv_buffer_free(written);
+    }
+  return NULL;
+}
+
+static int read_directory(const char *dirname)
+{
+  DIR *dir;
+  struct dirent *entry;
+  stress_file file;
+
+  if (!(dir = opendir(dirname))) {
+    perror(dirname);
+    return 1;
+  }
+  while ((entry = readdir(dir))) {
+    if (entry->d_name[0] == '.')
+      continue;
+    if (!(file.path = malloc(strlen(dirname) + strlen(entry->d_name) + 2)))
+      return 1;
+    sprintf(file.path,"%s/%s",dirname,entry->d_name);
+    if (convert(file.path,&file.written) == 1) {
+      free(file.path);
+      continue;
+    }
+    if (!(files = realloc(files,(nr_files + 1) * sizeof(*files))))
+      return 1;
+    files[nr_files++] = file;
+  }
+  closedir(dir);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  stress_thread *threads;
+  int nr_threads = DEFAULT_THREADS;
+  int i,failed = 0;
+
+  if ((argc < 2) || (argc > 3) ||
+      ((argc == 3) && ((nr_threads = atoi(argv[2])) < 1))) {
+    fprintf(stderr,"Syntax: DIRECTORY [THREADS]\n");
+    exit(1);
+  }
+
+  /* Not every file in the directory is a Psion file; those errors are
+     expected, and all others are reported below */
+  config = psiconv_config_default();
+  config->verbosity = PSICONV_VERB_FATAL;
+
+  if (read_directory(argv[1])) {
+    fprintf(stderr,"Can't read the files to convert\n");
+    exit(1);
+  }
+  if (!nr_files) {
+    fprintf(stderr,"No Psion files found in %s\n",argv[1]);
+    exit(1);
+  }
+
+  if (!(threads = malloc(nr_threads * sizeof(*threads)))) {
+    fprintf(stderr,"Out of memory\n");
+    exit(1);
+  }
+  for (i = 0; i < nr_threads; i++) {
+    threads[i].nr = i;
+    threads[i].failed = 0;
+    if (pthread_create(&threads[i].thread,NULL,stress,threads + i)) {
+      fprintf(stderr,"Can't create thread %d\n",i);
+      exit(1);
+    }
+  }
+  for (i = 0; i < nr_threads; i++) {
+    pthread_join(threads[i].thread,NULL);
+    failed |= threads[i].failed;
+  }
+
+  for (i = 0; i < nr_files; i++) {
+    if (files[i].written)
+      psiconv_buffer_free(files[i].written);
+    free(files[i].path);
+  }
+  free(files);
+  free(threads);
+  psiconv_config_free(config);
+  exit(failed?1:0);
+}
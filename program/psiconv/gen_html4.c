@@ -58,7 +58,7 @@ void text(const psiconv_config config,psiconv_list list,
           psiconv_string_t data,const encoding enc)
 {
   int i;
-  for (i = 0; i < psiconv_unicode_strlen(data); i++) {
+  for (i = 0; data[i]; i++) {
     if ((data[i] == 0x06) || (data[i] == 0x07) || (data[i] == 0x08))
       output_simple_chars(config,list,"<BR>",enc);
     else if ((data[i] == 0x0b) || (data[i] == 0x0c))
@@ -200,7 +200,8 @@ void paragraph(const psiconv_config config, psiconv_list list,
 {
   int i,charnr,start,len;
   psiconv_string_t text;
-  psiconv_in_line_layout layout,next_layout;
+  psiconv_in_line_layout layouts,layout,next_layout;
+  int nr_layouts;
 
 
   output_simple_chars(config,list,
@@ -221,21 +222,13 @@ void paragraph(const psiconv_config config, psiconv_list list,
   } else {
     charnr = 0;
     start = -1;
-    for (i = 0; i < psiconv_list_length(para->in_lines); i++) {
+    layouts = psiconv_list_data(para->in_lines);
+    nr_layouts = psiconv_list_length(para->in_lines);
+    for (i = 0; i < nr_layouts; i++) {
       if (start < 0)
 	start = charnr;
-      if (!(layout = psiconv_list_get(para->in_lines,i))) {
-	fputs("Internal data structures corruption\n",stderr);
-	exit(1);
-      }
-      if (i+1 < psiconv_list_length(para->in_lines)) {
-        if (!(next_layout = psiconv_list_get(para->in_lines,i+1))) {
-          fputs("Internal data structures corruption\n",stderr);
-          exit(1);
-        }
-      } else {
-        next_layout = NULL;
-      }
+      layout = layouts + i;
+      next_layout = i+1 < nr_layouts ? layouts + i + 1 : NULL;
       if (next_layout &&
           character_layout_equal(layout->layout,next_layout->layout)) {
         charnr += layout->length;
@@ -263,15 +256,9 @@ void paragraph(const psiconv_config config, psiconv_list list,
 void paragraphs(const psiconv_config config, psiconv_list list,
                 psiconv_text_and_layout paragraphs, const encoding enc)
 {
-  int i;
   psiconv_paragraph para;
-  for (i = 0; i < psiconv_list_length(paragraphs); i++) {
-    if (!(para = psiconv_list_get(paragraphs,i))) {
-      fputs("Internal datastructure corruption\n",stderr);
-      exit(1);
-    }
+  PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,paragraphs)
     paragraph(config,list,para,enc);
-  }
 }
 
 void gen_word(const psiconv_config config, psiconv_list list,
@@ -91,7 +91,7 @@ void text(const psiconv_config config,psiconv_list list,
           psiconv_string_t data,const encoding enc)
 {
   int i;
-  for (i = 0; i < psiconv_unicode_strlen(data); i++) {
+  for (i = 0; data[i]; i++) {
     if ((data[i] == 0x06) || (data[i] == 0x07) || (data[i] == 0x08))
       output_simple_chars(config,list,"<br/>",enc);
     else if ((data[i] == 0x0b) || (data[i] == 0x0c))
@@ -147,7 +147,7 @@ void style_name(const psiconv_config config, psiconv_list list,
     fputs("Out of memory error\n",stderr);
     exit(1);
   }
-  for (i = 0; i < psiconv_unicode_strlen(name_copy); i++) {
+  for (i = 0; name_copy[i]; i++) {
     if ((name_copy[i] < 0x21) ||
 	((name_copy[i] >= 0x7f) && name_copy[i] <= 0xa0))
       name_copy[i] = '_';
@@ -170,7 +170,7 @@ char style_heading(const psiconv_config config, psiconv_list list,
     exit(1);
   }
   // replace special chars
-  for (i = 0; i < psiconv_unicode_strlen(name_copy); i++) {
+  for (i = 0; name_copy[i]; i++) {
     if ((name_copy[i] < 0x21) ||
 	((name_copy[i] >= 0x7f) && name_copy[i] <= 0xa0))
       name_copy[i] = '_';
@@ -179,7 +179,7 @@ char style_heading(const psiconv_config config, psiconv_list list,
   // look for heading
   char heading[] = "Heading";
   int found = 0;
-  for (i = 0; i < psiconv_unicode_strlen(name_copy); i++) {
+  for (i = 0; name_copy[i]; i++) {
     if (name_copy[i] == heading[0]) {
       found = 1;
       for (j = 0; j < strlen(heading); j++) {
@@ -486,7 +486,6 @@ void style(const psiconv_config config, psiconv_list list,
 void styles(const psiconv_config config, psiconv_list list,
             const psiconv_word_styles_section styles_sec,const encoding enc)
 {
-  int i;
   psiconv_word_style styl;
   psiconv_character_layout base_char;
   psiconv_paragraph_layout base_para;
@@ -511,13 +510,8 @@ void styles(const psiconv_config config, psiconv_list list,
   if (styles_sec) {
     style(config,list,styles_sec->normal,base_para,base_char,enc);
 
-    for (i = 0; i < psiconv_list_length(styles_sec->styles); i++) {
-      if (!(styl = psiconv_list_get(styles_sec->styles,i))) {
-	fputs("Internal datastructure corruption\n",stderr);
-	exit(1);
-      }
+    PSICONV_LIST_FOREACH(struct psiconv_word_style_s,styl,styles_sec->styles)
       style(config,list,styl,base_para,base_char,enc);
-    }
   }
 
 /*  output_simple_chars(config,list,"]]>\n",enc); */
@@ -590,7 +584,8 @@ void paragraph(const psiconv_config config, psiconv_list list,
 {
   int i,charnr,start,len;
   psiconv_string_t text;
-  psiconv_in_line_layout layout,next_layout;
+  psiconv_in_line_layout layouts,layout,next_layout;
+  int nr_layouts;
   psiconv_word_style style = NULL;
   psiconv_paragraph_layout base_para;
   psiconv_character_layout base_char;
@@ -679,21 +674,13 @@ void paragraph(const psiconv_config config, psiconv_list list,
   } else {
     charnr = 0;
     start = -1;
-    for (i = 0; i < psiconv_list_length(para->in_lines); i++) {
+    layouts = psiconv_list_data(para->in_lines);
+    nr_layouts = psiconv_list_length(para->in_lines);
+    for (i = 0; i < nr_layouts; i++) {
       if (start < 0)
 	start = charnr;
-      if (!(layout = psiconv_list_get(para->in_lines,i))) {
-	fputs("Internal data structures corruption\n",stderr);
-	exit(1);
-      }
-      if (i+1 < psiconv_list_length(para->in_lines)) {
-        if (!(next_layout = psiconv_list_get(para->in_lines,i+1))) {
-	  fputs("Internal data structures corruption\n",stderr);
-	  exit(1);
-	}
-      } else {
-	next_layout = NULL;
-      }
+      layout = layouts + i;
+      next_layout = i+1 < nr_layouts ? layouts + i + 1 : NULL;
       if (next_layout &&
 	  character_layout_equal(layout->layout,next_layout->layout)) {
         charnr += layout->length;
@@ -727,15 +714,9 @@ void paragraphs(const psiconv_config config, psiconv_list list,
 	        const psiconv_word_styles_section styles,
 		const encoding enc)
 {
-  int i;
   psiconv_paragraph para;
-  for (i = 0; i < psiconv_list_length(paragraphs); i++) {
-    if (!(para = psiconv_list_get(paragraphs,i))) {
-      fputs("Internal datastructure corruption\n",stderr);
-      exit(1);
-    }
+  PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,paragraphs)
     paragraph(config,list,para,styles,enc);
-  }
 }
 
 void gen_word(const psiconv_config config, psiconv_list list,
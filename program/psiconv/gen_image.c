@@ -59,24 +59,30 @@ Image *get_paint_data_section(psiconv_paint_data_section sec)
   ExceptionInfo exc;
 
   GetExceptionInfo(&exc);
-  red = sec->red;
-  green = sec->green;
-  blue = sec->blue;
-  p = pixel = malloc(sec->xsize * sec->ysize * 3 * sizeof(float));
-  for (y = 0; y < sec->ysize; y++) {
-    for (x = 0; x < sec->xsize; x++) {
-      *p++ = *red++;
-      *p++ = *green++;
-      *p++ = *blue++;
+  if (sec->rgb) {
+    /* Packed pixels are already in the right order */
+    image = ConstituteImage(sec->xsize,sec->ysize,"RGB",CharPixel,sec->rgb,
+                            &exc);
+  } else {
+    red = sec->red;
+    green = sec->green;
+    blue = sec->blue;
+    p = pixel = malloc(sec->xsize * sec->ysize * 3 * sizeof(float));
+    for (y = 0; y < sec->ysize; y++) {
+      for (x = 0; x < sec->xsize; x++) {
+        *p++ = *red++;
+        *p++ = *green++;
+        *p++ = *blue++;
+      }
     }
+    image = ConstituteImage(sec->xsize,sec->ysize,"RGB",FloatPixel,pixel,
+                            &exc);
+    free(pixel);
   }
-
-  image = ConstituteImage(sec->xsize,sec->ysize,"RGB",FloatPixel,pixel,&exc);
   if (! image || (exc.severity != UndefinedException)) {
     MagickError(exc.severity,exc.reason,exc.description);
     exit(1);
   }
-  free(pixel);
 
   DestroyExceptionInfo(&exc);
 
@@ -90,7 +96,6 @@ void image_to_list(psiconv_list list,Image *image,const char *dest)
   ExceptionInfo exc;
   size_t length;
   unsigned char *data;
-  int i;
 
   strcpy(image->magick,dest);
   image_info = CloneImageInfo(NULL);
@@ -100,11 +105,9 @@ void image_to_list(psiconv_list list,Image *image,const char *dest)
     MagickError(exc.severity,exc.reason,exc.description);
     exit(1);
   }
-  for (i = 0; i < length; i++) {
-    if (psiconv_list_add(list,data+i)) {
-      fprintf(stderr,"Out of memory error");
-      exit(1);
-    }
+  if (psiconv_list_add_n(list,data,length)) {
+    fprintf(stderr,"Out of memory error");
+    exit(1);
   }
   DestroyExceptionInfo(&exc);
   DestroyImageInfo(image_info);
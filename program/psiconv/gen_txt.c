@@ -64,7 +64,7 @@ void output_para(const psiconv_config config,psiconv_list list,
     output_char(config,list,' ', encoding_type);
   }
   if (para && para->text) {
-    for (i = 0; i < psiconv_unicode_strlen(para->text); i++) 
+    for (i = 0; para->text[i]; i++) 
       switch (para->text[i]) {
 	case 0x06: 
 	case 0x07:
@@ -116,74 +116,55 @@ void output_para(const psiconv_config config,psiconv_list list,
 void gen_word(const psiconv_config config, psiconv_list list, 
                          psiconv_word_f wf, encoding encoding_type)
 {
-  int i;
   psiconv_paragraph para;
 
   if (wf && wf->page_sec && wf->page_sec->header &&
       wf->page_sec->header->text && wf->page_sec->header->text->paragraphs) {
-    for (i=0; 
-	 i < psiconv_list_length(wf->page_sec->header->
-					   text->paragraphs); i++) {
-      para = psiconv_list_get(wf->page_sec->header->text->paragraphs,
-				      i);
+    PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,
+                         wf->page_sec->header->text->paragraphs)
       output_para(config,list,para,encoding_type);
-    }
   }
   output_char(config,list,'\n',encoding_type);
     
   if (wf && wf->paragraphs) 
-    for (i=0; i < psiconv_list_length(wf->paragraphs); i++) {
-	  para = psiconv_list_get(wf->paragraphs, i);
-	  output_para(config, list,para,encoding_type);
-  }
+    PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,wf->paragraphs)
+      output_para(config, list,para,encoding_type);
     
   output_char(config,list,'\n',encoding_type);
 
   if (wf && wf->page_sec && wf->page_sec->footer &&
       wf->page_sec->footer->text && wf->page_sec->footer->text->paragraphs) {
-    for (i=0; 
-	 i < psiconv_list_length(wf->page_sec->footer->
-					 text->paragraphs); i++) {
-      para = psiconv_list_get(wf->page_sec->footer->text->paragraphs, i);
+    PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,
+                         wf->page_sec->footer->text->paragraphs)
       output_para(config,list,para,encoding_type);
-    }
   }
 }
 
 void gen_texted(const psiconv_config config, psiconv_list list, 
                            psiconv_texted_f tf, encoding encoding_type)
 {
-  int i;
   psiconv_paragraph para;
 
   if (tf && tf->page_sec && tf->page_sec->header &&
       tf->page_sec->header->text && tf->page_sec->header->text->paragraphs) {
-    for (i=0; 
-	 i < psiconv_list_length(tf->page_sec->header->
-				       text->paragraphs); i++) {
-      para = psiconv_list_get(tf->page_sec->header->text->paragraphs,
-				  i);
+    PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,
+                         tf->page_sec->header->text->paragraphs)
       output_para(config,list,para,encoding_type);
-    }
   }
   output_char(config,list,'\n',encoding_type);
     
   if (tf && tf->texted_sec && tf->texted_sec->paragraphs) 
-    for (i=0; i < psiconv_list_length(tf->texted_sec->paragraphs); i++) {
-	  para = psiconv_list_get(tf->texted_sec->paragraphs, i);
-	  output_para(config, list,para,encoding_type);
-  }
+    PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,
+                         tf->texted_sec->paragraphs)
+      output_para(config, list,para,encoding_type);
     
   output_char(config,list,'\n',encoding_type);
 
   if (tf && tf->page_sec && tf->page_sec->footer &&
       tf->page_sec->footer->text && tf->page_sec->footer->text->paragraphs) {
-    for (i=0; 
-	 i < psiconv_list_length(tf->page_sec->footer->
-					   text->paragraphs); i++) {
-      para = psiconv_list_get(tf->page_sec->footer->text->paragraphs, i);
+    PSICONV_LIST_FOREACH(struct psiconv_paragraph_s,para,
+                         tf->page_sec->footer->text->paragraphs)
       output_para(config,list,para,encoding_type);
-    }
   }
 }
 
@@ -33,54 +33,54 @@ void output_char(psiconv_config config, psiconv_list list,
                 psiconv_ucs2 character, encoding enc)
 {
   psiconv_u8 temp;
-  psiconv_u8 *byteptr;
-  int res,i;
-  psiconv_buffer buf;
+  psiconv_u8 bytes[3];
+  psiconv_u32 len;
+  int res;
 #define TEMPSTR_LEN 80
   char tempstr[TEMPSTR_LEN];
 
   if (enc == ENCODING_UCS2) {
     temp = character >> 8;
-    if ((res = psiconv_list_add(list,&temp))) {
+    if ((res = psiconv_list_u8_add(list,temp))) {
       fputs("Out of memory error\n",stderr);
       exit(1);
     }
     temp = character & 0xff;
-    if ((res = psiconv_list_add(list,&temp))) {
+    if ((res = psiconv_list_u8_add(list,temp))) {
       fputs("Out of memory error\n",stderr);
       exit(1);
     }
   } else if (enc == ENCODING_UTF8) {
     if (character < 0x80) {
       temp = character;
-      if ((res = psiconv_list_add(list,&temp))) {
+      if ((res = psiconv_list_u8_add(list,temp))) {
 	fputs("Out of memory error\n",stderr);
 	exit(1);
       }
     } else if (character < 0x800) {
       temp = 0xc0 + (character >> 6);
-      if ((res = psiconv_list_add(list,&temp))) {
+      if ((res = psiconv_list_u8_add(list,temp))) {
 	fputs("Out of memory error\n",stderr);
 	exit(1);
       }
       temp = 0x80 + (character & 0x3f);
-      if ((res = psiconv_list_add(list,&temp))) {
+      if ((res = psiconv_list_u8_add(list,temp))) {
 	fputs("Out of memory error\n",stderr);
 	exit(1);
       }
     } else {
       temp = 0xe0 + (character >> 12);
-      if ((res = psiconv_list_add(list,&temp))) {
+      if ((res = psiconv_list_u8_add(list,temp))) {
 	fputs("Out of memory error\n",stderr);
 	exit(1);
       }
       temp = 0x80 + ((character >> 6) & 0x3f);
-      if ((res = psiconv_list_add(list,&temp))) {
+      if ((res = psiconv_list_u8_add(list,temp))) {
 	fputs("Out of memory error\n",stderr);
 	exit(1);
       }
       temp = 0x80 + (character  & 0x3f);
-      if ((res = psiconv_list_add(list,&temp))) {
+      if ((res = psiconv_list_u8_add(list,temp))) {
 	fputs("Out of memory error\n",stderr);
 	exit(1);
       }
@@ -92,7 +92,7 @@ void output_char(psiconv_config config, psiconv_list list,
       temp = '?';
     else
       temp = character;
-    if ((res = psiconv_list_add(list,&temp))) {
+    if ((res = psiconv_list_u8_add(list,temp))) {
       fputs("Out of memory error\n",stderr);
       exit(1);
     }
@@ -102,28 +102,17 @@ void output_char(psiconv_config config, psiconv_list list,
       output_simple_chars(config,list,tempstr,enc);
     } else {
       temp = character;
-      if ((res = psiconv_list_add(list,&temp))) {
+      if ((res = psiconv_list_u8_add(list,temp))) {
 	fputs("Out of memory error\n",stderr);
 	exit(1);
       }
     }
   } else if (enc == ENCODING_PSION) {
-    if (!(buf = psiconv_buffer_new())) {
+    len = psiconv_unicode_encode_string(config,&character,1,bytes);
+    if ((res = psiconv_list_add_n(list,bytes,len))) {
       fputs("Out of memory error\n",stderr);
       exit(1);
     }
-    psiconv_unicode_write_char(config,buf,0,character);
-    for (i = 0; i < psiconv_buffer_length(buf); i++) {
-      if (!(byteptr = psiconv_buffer_get(buf,i))) {
-        fputs("Internal memory corruption\n",stderr);
-        exit(1);
-      }
-      if ((res = psiconv_list_add(list,byteptr))) {
-	fputs("Out of memory error\n",stderr);
-	exit(1);
-      }
-    }
-    psiconv_buffer_free(buf);
   }
 }
 
@@ -231,35 +231,27 @@ int main(int argc, char *argv[])
   if (verbosity)
     config->verbosity = verbosity;
 
-  /* Open inputfile for reading */
+  /* Read inputfile; named files are mapped into memory when possible */
 
   if (strlen(inputfilename) != 0) {
     if(stat(inputfilename,&fbuf) < 0) {
       perror(inputfilename);
       exit(1);
     }
-    f = fopen(inputfilename,"r");
-    if (! f) {
+    if (!(buf = psiconv_buffer_map_file(inputfilename))) {
       perror(inputfilename);
       exit(1);
     }
-  } else
-    f = stdin;
-
-  if (!(buf = psiconv_buffer_new())) {
-    fputs("Out of memory error",stderr);
-    exit(1);
-  }
-  if (psiconv_buffer_fread_all(buf,f)) {
-    fprintf(stderr,"Failure reading file");
-    exit(1);
-  }
-
-  if (strlen(inputfilename) != 0)
-    if (fclose(f)) {
-      perror(inputfilename);
+  } else {
+    if (!(buf = psiconv_buffer_new())) {
+      fputs("Out of memory error",stderr);
       exit(1);
     }
+    if (psiconv_buffer_fread_all(buf,stdin)) {
+      fprintf(stderr,"Failure reading file");
+      exit(1);
+    }
+  }
 
   if (psiconv_parse(config,buf,&file) || (file->type == psiconv_unknown_file))
   {